@@ -1,8 +1,11 @@
 #include "Beamline.h"
 
 #include <array>
+#include <span>
 
+#include "Beamline/SourceCache.h"
 #include "Debug/Instrumentor.h"
+#include "Random.h"
 
 namespace RAYX {
 Beamline::Beamline() = default;
@@ -15,30 +18,48 @@ std::vector<Ray> Beamline::getInputRays(int thread_count) const {
         return {};
     }
 
-    // count number of rays.
-    uint32_t raycount = 0;
-
-    for (DesignSource dSource : m_DesignSources) {
-        raycount += (uint32_t)dSource.getNumberOfRays();
+    // every light source writes its rays directly into its own slice of `list`, hence nothing has to be copied or re-tagged afterwards.
+    std::vector<size_t> offsets(m_DesignSources.size() + 1, 0);
+    for (size_t i = 0; i < m_DesignSources.size(); i++) {
+        offsets[i + 1] = offsets[i] + static_cast<size_t>(m_DesignSources[i].getNumberOfRays());
     }
+    std::vector<Ray> list(offsets.back());
+
+    std::optional<SourceCache> cache;
+    if (m_sourceCacheDirectory) cache.emplace(*m_sourceCacheDirectory);
+    std::optional<Element> importanceTarget;
+    if (m_importanceSampleSources && !m_DesignElements.empty()) importanceTarget = m_DesignElements[0].compile();
+    const Element* target = importanceTarget ? &*importanceTarget : nullptr;
+
+    // the light source with index i has ID i.
+    auto compile = [&](size_t i, int threads) {
+        auto out = std::span(list).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+        const int sourceID = static_cast<int>(i);
+        if (cache) {
+            cache->getRays(out, m_DesignSources[i], threads, sourceID, target);
+        } else {
+            m_DesignSources[i].compile(out, threads, sourceID, target);
+        }
+    };
 
-    // We add all remaining rays into the rays of the first light source.
-    // This is efficient because in most cases there is just one light source, and hence copying them again is unnecessary.
-    std::vector<Ray> list = m_DesignSources[0].compile(thread_count);
-    for (Ray& r : list) {
-        r.m_sourceID = 0;  // the first light source has ID 0.
+    // In most cases there is just one light source, which draws from the global RNG as usual.
+    if (m_DesignSources.size() == 1) {
+        compile(0, thread_count);
+        return list;
     }
 
-    if (m_DesignSources.size() > 1) {
-        list.reserve(raycount);
+    // Multiple light sources are generated concurrently. In order to stay deterministic, each source draws from its own RNG,
+    // seeded in order from the global RNG. Each source runs single-threaded, as OpenMP workers would not see the per-source RNG.
+    std::vector<uint32_t> seeds(m_DesignSources.size());
+    for (auto& seed : seeds) {
+        seed = randomUint();
+    }
 
-        for (size_t i = 1; i < m_DesignSources.size(); i++) {
-            std::vector<Ray> sub = m_DesignSources[i].compile(thread_count);
-            for (Ray& r : sub) {
-                r.m_sourceID = static_cast<double>(i);
-            }
-            list.insert(list.end(), sub.begin(), sub.end());
-        }
+    const auto numSources = static_cast<int64_t>(m_DesignSources.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t i = 0; i < numSources; i++) {
+        ScopedRandomEngine rng(seeds[i]);
+        compile(static_cast<size_t>(i), 1);
     }
     return list;
 }
@@ -54,7 +75,7 @@ MaterialTables Beamline::calcMinimalMaterialTables() const {
         }
     }
 
-    return loadMaterialTables(relevantMaterials);
+    return loadMaterialTables(relevantMaterials, m_materialLookup);
 }
 
 }  // namespace RAYX
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <filesystem>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "Beamline/LightSource.h"
@@ -22,7 +24,9 @@ class RAYX_API Beamline {
     Beamline();
     ~Beamline();
 
-    // iterates over the m_LightSources, and collects the rays they emit.
+    // iterates over the m_LightSources, and collects the rays they emit. The rays of source i are tagged with m_sourceID i.
+    // Multiple light sources are generated concurrently, each from its own RNG stream (seeded in order from the global RNG).
+    // If m_sourceCacheDirectory is set, the rays are loaded from (or stored into) the SourceCache in this directory.
     std::vector<Ray> getInputRays(int thread_count = 1) const;
 
     /**
@@ -35,6 +39,36 @@ class RAYX_API Beamline {
 
     std::vector<DesignElement> m_DesignElements;
     std::vector<DesignSource> m_DesignSources;
+
+    // directory of the on-disk source ray cache, disabled if empty. See SourceCache.h
+    std::optional<std::filesystem::path> m_sourceCacheDirectory;
+
+    // if set, sequential tracing rejects all source rays which miss the first element before tracing them. See SourceAcceptance.h
+    bool m_cullSourceRays = false;
+
+    // if set, the sources importance sample their divergence towards the first element, see LightSource::setImportanceTarget.
+    bool m_importanceSampleSources = false;
+
+    // how the tracer looks up the refractive index of the materials, see MaterialLookup.
+    MaterialLookup m_materialLookup = MaterialLookup::Grid;
+
+    // if set, the refractive indices of the mirrors are tabulated before tracing (only for monochromatic or narrow-band beams), and the mirrors
+    // evaluate the Fresnel equations in closed form. Near the critical angle, the reflection amplitudes differ from the exact ones by up to
+    // about 1e-8 (see testFresnelTable).
+    // See Shader/FresnelTable.h
+    bool m_cacheFresnelCoefficients = false;
+
+    // if set, slits sample their diffraction angles from precomputed inverse CDFs in constant time, instead of by rejection sampling.
+    // See Shader/Diffraction.h
+    bool m_tabulateDiffraction = false;
+
+    // if set, the CPU tracer traces packets of rays, whose collisions with planes are computed in SIMD lanes. Ignored by the GPU tracer.
+    // See Shader/RayPacket.h
+    bool m_traceRayPackets = false;
+
+    // if set, the rays of each batch are traced in the Morton order of their position and direction, which groups rays that take the same path
+    // through the beamline. The results are identical. See Tracer/RayOrder.h
+    bool m_sortRays = false;
 };
 
 }  // namespace RAYX
@@ -1,11 +1,60 @@
 #include "LightSource.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "Beamline/EnergyDistribution.h"
 #include "Design/DesignSource.h"
+#include "Element/Element.h"
+#include "Element/ElementRecord.h"
+#include "Shader/Collision.h"
+#include "Shader/Constants.h"
+#include "Shader/CutoutFns.h"
 
 namespace RAYX {
+
+namespace {
+
+// number of grid points per axis, at which the height of a curved surface is probed.
+constexpr int SURFACE_PROBES = 17;
+
+// Bounds the height (the y coordinate in element coordinates) of the surface of `target` over the bounding box `size` of its cutout.
+// Curved surfaces are probed on a grid, and the range is widened by the largest height difference between neighbouring probes, which bounds
+// the sag in between. Returns nothing if a probe misses the surface.
+std::optional<glm::dvec2> surfaceHeightRange(const Element& target, glm::dvec2 size) {
+    if (int(target.m_surface.m_type) == STYPE_PLANE_XZ) return glm::dvec2(0.0, 0.0);
+
+    const DecodedSurface surface = decodeSurface(target.m_surface);
+    DecodedCutout unlimited;
+    unlimited.m_cutout = serializeUnlimited();
+    unlimited.m_min = glm::dvec2(-INFINITY);
+    unlimited.m_max = glm::dvec2(INFINITY);
+    const double probeHeight = 10.0 * std::max(size.x, size.y);
+
+    double heights[SURFACE_PROBES][SURFACE_PROBES];
+    double minHeight = INFINITY;
+    double maxHeight = -INFINITY;
+    double maxStep = 0.0;
+    for (int i = 0; i < SURFACE_PROBES; i++) {
+        for (int j = 0; j < SURFACE_PROBES; j++) {
+            Ray probe{};
+            probe.m_position = {(double(i) / (SURFACE_PROBES - 1) - 0.5) * size.x, probeHeight, (double(j) / (SURFACE_PROBES - 1) - 0.5) * size.y};
+            probe.m_direction = {0.0, -1.0, 0.0};
+            const Collision col = findCollisionInElementCoords(probe, surface, unlimited, false);
+            if (!col.found) return std::nullopt;
+
+            heights[i][j] = col.hitpoint.y;
+            minHeight = std::min(minHeight, heights[i][j]);
+            maxHeight = std::max(maxHeight, heights[i][j]);
+            if (i > 0) maxStep = std::max(maxStep, std::abs(heights[i][j] - heights[i - 1][j]));
+            if (j > 0) maxStep = std::max(maxStep, std::abs(heights[i][j] - heights[i][j - 1]));
+        }
+    }
+    return glm::dvec2(minHeight - maxStep, maxHeight + maxStep);
+}
+
+}  // unnamed namespace
+
 LightSource::LightSource(const DesignSource& dSource)
     : m_name(dSource.getName()),
       m_EnergyDistribution(dSource.getEnergyDistribution()),
@@ -25,6 +74,47 @@ glm::dvec3 LightSource::getDirectionFromAngles(const double phi, const double ps
     return {al, am, an};
 }
 
+std::optional<DivergenceWindow> LightSource::divergenceWindow(const Element& target, glm::dvec3 center, glm::dvec3 maxOffset) const {
+    if (target.m_cutout.m_type == CTYPE_UNLIMITED) return std::nullopt;
+
+    const glm::dvec2 size = cutoutBoundingBox(target.m_cutout);
+    const auto height = surfaceHeightRange(target, size);
+    if (!height) return std::nullopt;
+
+    // The element lies within the box size.x * height * size.y (in element coordinates), and the ray origins within the box center +- maxOffset
+    // (in world coordinates). Hence all directions from an origin to the element lie in the convex hull of the differences of their corners.
+    const glm::dmat3 toSource = glm::transpose(glm::dmat3(m_orientation));
+    double xzMin = INFINITY;
+    double xzMax = -INFINITY;
+    double yMin = INFINITY;
+    double yMax = -INFINITY;
+    double zMin = INFINITY;
+    double horizontalMax = 0.0;
+    for (int c = 0; c < 8; c++) {
+        const glm::dvec3 local = {(c & 1 ? 0.5 : -0.5) * size.x, c & 2 ? height->y : height->x, (c & 4 ? 0.5 : -0.5) * size.y};
+        const glm::dvec3 world = glm::dvec3(target.m_outTrans * glm::dvec4(local, 1.0));
+        for (int o = 0; o < 8; o++) {
+            const glm::dvec3 offset = {o & 1 ? maxOffset.x : -maxOffset.x, o & 2 ? maxOffset.y : -maxOffset.y, o & 4 ? maxOffset.z : -maxOffset.z};
+            const glm::dvec3 d = toSource * (world - center - offset);
+            if (d.z <= 0.0) return std::nullopt;
+
+            xzMin = std::min(xzMin, d.x / d.z);
+            xzMax = std::max(xzMax, d.x / d.z);
+            yMin = std::min(yMin, d.y);
+            yMax = std::max(yMax, d.y);
+            zMin = std::min(zMin, d.z);
+            horizontalMax = std::max(horizontalMax, std::sqrt(d.x * d.x + d.z * d.z));
+        }
+    }
+
+    // phi = atan(d.x / d.z), and d.x / d.z takes its extrema over the hull at the corners, as d.z > 0.
+    // tan(psi) = -d.y / h with the horizontal distance h = sqrt(d.x^2 + d.z^2), which is bounded by interval arithmetic: d.y is linear, and
+    // zMin <= h <= horizontalMax, as h >= d.z and h is convex.
+    const double tanPsiMin = -yMax >= 0.0 ? -yMax / horizontalMax : -yMax / zMin;
+    const double tanPsiMax = -yMin >= 0.0 ? -yMin / zMin : -yMin / horizontalMax;
+    return DivergenceWindow{atan(xzMin), atan(xzMax), atan(tanPsiMin), atan(tanPsiMax)};
+}
+
 //  (see RAYX.FOR select_energy)
 double LightSource::selectEnergy() const { return m_EnergyDistribution.selectEnergy(); }
 
@@ -3,6 +3,8 @@
 #include <glm.h>
 
 #include <array>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -21,6 +23,15 @@ enum class EnergySpreadUnit { EU_PERCENT, EU_eV };
 enum class SigmaType { ST_STANDARD, ST_ACCURATE };
 
 struct DesignSource;
+struct Element;
+
+// A range of divergence angles in rad, see LightSource::divergenceWindow.
+struct DivergenceWindow {
+    double m_phiMin;
+    double m_phiMax;
+    double m_psiMin;
+    double m_psiMax;
+};
 
 class RAYX_API LightSource {
   public:
@@ -38,8 +49,20 @@ class RAYX_API LightSource {
     double selectEnergy() const;
     static glm::dvec3 getDirectionFromAngles(double phi, double psi);
     // get the rays according to specific light source, has to be implemented in
-    // each class that inherits from LightSource
-    virtual std::vector<Ray> getRays(int thread_count = 0) const = 0;
+    // each class that inherits from LightSource.
+    // Writes exactly m_numberOfRays rays to `out`, tagged with m_sourceID.
+    virtual void getRays(std::span<Ray> out, int thread_count = 0) const = 0;
+
+    // the ID with which the generated rays are tagged (see Ray::m_sourceID).
+    void setSourceID(int id) { m_sourceID = static_cast<double>(id); }
+
+    /**
+     * Enables importance sampling of the divergence: instead of emitting rays into all directions, the source only samples the directions under
+     * which `target` (typically the first element of the beamline) can be hit. Each ray then carries the probability of the restricted directions
+     * as statistical weight, which is stored in the intensity of its electric field.
+     * `target` has to outlive the call to getRays. Only PointSource and SimpleUndulatorSource support this, all other sources ignore it.
+     */
+    void setImportanceTarget(const Element* target) { m_importanceTarget = target; }
 
     std::string m_name;
 
@@ -61,6 +84,14 @@ class RAYX_API LightSource {
     glm::dmat4x4 m_orientation = glm::dmat4x4();
     glm::dvec4 m_position = glm::dvec4();
 
+    const Element* m_importanceTarget = nullptr;
+    double m_sourceID = -1.0;
+
+    // Computes a range of the angles phi and psi (see getDirectionFromAngles), which contains all directions under which the element `target`
+    // is seen from a ray origin within the box `center` +- `maxOffset` (in world coordinates).
+    // Returns nothing if no useful restriction is possible (e.g. for unlimited cutouts, or elements behind the source).
+    std::optional<DivergenceWindow> divergenceWindow(const Element& target, glm::dvec3 center, glm::dvec3 maxOffset) const;
+
   private:
     // User/Design Parameter
     Misalignment m_misalignmentParams;  // x, y, psi, phi
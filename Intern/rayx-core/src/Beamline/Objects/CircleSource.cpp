@@ -29,15 +29,13 @@ CircleSource::CircleSource(const DesignSource& dSource) : LightSource(dSource) {
  * spread angles
  * origins are distributed uniformly, the pattern shows on the next element
  * through the directions
- * @returns list of rays
+ * writes the rays to `out`
  */
-std::vector<Ray> CircleSource::getRays([[maybe_unused]] int thread_count) const {
+void CircleSource::getRays(std::span<Ray> out, [[maybe_unused]] int thread_count) const {
     RAYX_PROFILE_FUNCTION_STDOUT();
     double x, y, z, en;  // x,y,z pos, psi,phi direction cosines, en=energy
 
     int n = m_numberOfRays;
-    std::vector<Ray> rayList;
-    rayList.reserve(m_numberOfRays);
 
     // create n rays with random position and divergence within the given span
     // for width, height, depth
@@ -60,11 +58,8 @@ std::vector<Ray> CircleSource::getRays([[maybe_unused]] int thread_count) const
         const auto rotation = glm::dmat3(m_orientation);
         const auto field = rotation * stokesToElectricField(m_stokes);
 
-        Ray r = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, -1.0};
-
-        rayList.push_back(r);
+        out[i] = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, m_sourceID};
     }
-    return rayList;
 }
 
 /**
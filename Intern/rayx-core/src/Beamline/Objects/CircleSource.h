@@ -9,7 +9,7 @@ class RAYX_API CircleSource : public LightSource {
     CircleSource(const DesignSource&);
     virtual ~CircleSource() = default;
 
-    std::vector<Ray> getRays(int thread_count = 1) const override;
+    void getRays(std::span<Ray> out, int thread_count = 1) const override;
 
     glm::dvec3 getDirection() const;
 
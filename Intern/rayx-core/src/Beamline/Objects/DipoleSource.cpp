@@ -81,10 +81,10 @@ DipoleSource::DipoleSource(const DesignSource& dSource)
  * with natural energy distribution by Schwinger (see Doku)
  * with natural psi and polarisation distribution (see Doku)
  *
- * @returns list of rays
+ * writes the rays to `out`
  */
 
-std::vector<Ray> DipoleSource::getRays(int thread_count) const {
+void DipoleSource::getRays(std::span<Ray> out, int thread_count) const {
     RAYX_PROFILE_FUNCTION();
 
     /**
@@ -98,13 +98,7 @@ std::vector<Ray> DipoleSource::getRays(int thread_count) const {
 #define DIPOLE_OMP
     }
 
-    double phi, en;  // phi=horizontal Angle, en=energy
-
-    PsiAndStokes psiandstokes;  // psi=vertical Angle, stokes=light-polarisation
-
     int n = m_numberOfRays;
-    std::vector<Ray> rayList;
-    rayList.reserve(m_numberOfRays);
     RAYX_VERB << "Create " << n << " rays with standard normal deviation...";
 
 // create n rays with random position and divergence within the given span
@@ -113,13 +107,15 @@ std::vector<Ray> DipoleSource::getRays(int thread_count) const {
 #pragma omp parallel for num_threads(thread_count)
 #endif
     for (int i = 0; i < n; i++) {
-        phi = (randomDouble() - 0.5) * m_horDivergence;  // chooses phi in given Divergence
+        // phi=horizontal Angle, en=energy, psi=vertical Angle, stokes=light-polarisation
+        // (declared inside the loop, as each thread writes its own rays)
+        double phi = (randomDouble() - 0.5) * m_horDivergence;  // chooses phi in given Divergence
 
         glm::dvec3 position = getXYZPosition(phi);
 
-        en = getEnergy();  // Verteilung nach Schwingerfunktion
+        double en = getEnergy();  // Verteilung nach Schwingerfunktion
 
-        psiandstokes = getPsiandStokes(en);
+        PsiAndStokes psiandstokes = getPsiandStokes(en);
 
         phi = phi + getMisalignmentParams().m_rotationXerror.rad;
 
@@ -134,16 +130,8 @@ std::vector<Ray> DipoleSource::getRays(int thread_count) const {
         const auto rotation = glm::dmat3(m_orientation);
         const auto field = rotation * stokesToElectricField(psiandstokes.stokes);
 
-        Ray r = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, -1.0};
-#if defined(DIPOLE_OMP)
-#pragma omp critical  // thread-safety for writing rayList
-        { rayList.push_back(r); }
-#else
-        rayList.push_back(r);
-#endif
+        out[i] = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, m_sourceID};
     }
-
-    return rayList;
 }
 
 /**
@@ -16,7 +16,7 @@ class RAYX_API DipoleSource : public LightSource {
     DipoleSource(const DesignSource&);
     virtual ~DipoleSource() = default;
 
-    std::vector<Ray> getRays(int thread_count = 1) const override;
+    void getRays(std::span<Ray> out, int thread_count = 1) const override;
 
     // calculate Ray-Information
     glm::dvec3 getXYZPosition(double) const;
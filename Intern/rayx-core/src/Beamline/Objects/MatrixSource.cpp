@@ -23,17 +23,15 @@ MatrixSource::MatrixSource(const DesignSource& dSource)
  * creates floor(sqrt(numberOfRays)) **2 rays (a grid with as many rows as
  * columns, eg amountOfRays=20 -> 4*4=16, rest (4 rays) same position and
  * direction as first 4) distributed evenly across width & height of source
- * returns vector of rays
+ * writes the rays to `out`
  */
-std::vector<Ray> MatrixSource::getRays([[maybe_unused]] int thread_count) const {
+void MatrixSource::getRays(std::span<Ray> out, [[maybe_unused]] int thread_count) const {
     RAYX_PROFILE_FUNCTION();
 
     double x, y, z, psi, phi,
         en;  // x,y,z pos, psi,phi direction cosines, en=energy
     int rmat = int(sqrt(m_numberOfRays));
 
-    std::vector<Ray> returnList;
-    returnList.reserve(m_numberOfRays);
     // rayVector.reserve(1048576);
     RAYX_VERB << "create " << rmat << " times " << rmat << " matrix with Matrix Source...";
     // fill the square with rmat1xrmat1 rays
@@ -62,9 +60,7 @@ std::vector<Ray> MatrixSource::getRays([[maybe_unused]] int thread_count) const
             const auto rotation = glm::dmat3(m_orientation);
             const auto field = rotation * stokesToElectricField(m_pol);
 
-            Ray r = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, -1.0};
-
-            returnList.push_back(r);
+            out[col * rmat + row] = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, m_sourceID};
         }
     }
     // afterwards start from the beginning again
@@ -85,11 +81,10 @@ std::vector<Ray> MatrixSource::getRays([[maybe_unused]] int thread_count) const
         Ray r_copy(position.x, position.y, position.z, direction.x, direction.y,
                    direction.z, stokes.x, stokes.y, stokes.z, stokes.w, en,
                    1.0);*/
-        Ray r_copy((const Ray&)returnList.at(i));
+        Ray r_copy((const Ray&)out[i]);
         r_copy.m_energy = en = selectEnergy();
-        returnList.push_back(r_copy);
+        out[rmat * rmat + i] = r_copy;
     }
-    return returnList;
 }
 
 }  // namespace RAYX
@@ -10,7 +10,7 @@ class RAYX_API MatrixSource : public LightSource {
     MatrixSource(const DesignSource&);
     virtual ~MatrixSource() = default;
 
-    virtual std::vector<Ray> getRays(int thread_count = 1) const override;
+    void getRays(std::span<Ray> out, int thread_count = 1) const override;
 
   private:
     SourcePulseType m_sourceDistributionType;  // TODO: wo muss der name angepasst werden?
@@ -41,15 +41,13 @@ double getPosInDistribution(SourceDist l, double extent) {
  * & height in 4 distinct pixels
  * position and directions are distributed uniform
  *
- * @returns list of rays
+ * writes the rays to `out`
  */
-std::vector<Ray> PixelSource::getRays([[maybe_unused]] int thread_count) const {
+void PixelSource::getRays(std::span<Ray> out, [[maybe_unused]] int thread_count) const {
     RAYX_PROFILE_FUNCTION_STDOUT();
     double x, y, z, psi, phi, en;  // x,y,z pos, psi,phi direction cosines, en=energy
 
     int n = m_numberOfRays;
-    std::vector<Ray> rayList;
-    rayList.reserve(m_numberOfRays);
 
     // create n rays with random position and divergence within the given span
     // for width, height, depth, horizontal and vertical divergence
@@ -76,11 +74,8 @@ std::vector<Ray> PixelSource::getRays([[maybe_unused]] int thread_count) const {
         const auto rotation = glm::dmat3(m_orientation);
         const auto field = rotation * stokesToElectricField(m_pol);
 
-        Ray r = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, -1.0};
-
-        rayList.push_back(r);
+        out[i] = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, m_sourceID};
     }
-    return rayList;
 }
 
 }  // namespace RAYX
@@ -9,7 +9,7 @@ class RAYX_API PixelSource : public LightSource {
     PixelSource(const DesignSource&);
     virtual ~PixelSource() = default;
 
-    std::vector<Ray> getRays(int thread_count = 1) const override;
+    void getRays(std::span<Ray> out, int thread_count = 1) const override;
 
   private:
     // Geometric Params
@@ -1,5 +1,8 @@
 #include "PointSource.h"
 
+#include <algorithm>
+
+#include "Beamline/SourceSampling.h"
 #include "Debug/Debug.h"
 #include "Debug/Instrumentor.h"
 #include "Design/DesignElement.h"
@@ -23,19 +26,6 @@ PointSource::PointSource(const DesignSource& dSource)
     m_horDivergence = dSource.getHorDivergence();
 }
 
-/**
- * get deviation from main ray according to specified distribution (uniform if
- * hard edge, gaussian if soft edge)) and extent (eg specified width/height of
- * source)
- */
-double getCoord(const SourceDist l, const double extent) {
-    if (l == SourceDist::Uniform) {
-        return (randomDouble() - 0.5) * extent;
-    } else {
-        return randomNormal(0, 1) * extent;
-    }
-}
-
 /**
  * Creates random rays from point source with specified width and height
  * distributed according to either uniform or gaussian distribution across width
@@ -44,66 +34,84 @@ double getCoord(const SourceDist l, const double extent) {
  * a given range (m_verDivergence, m_horDivergence) z-position of ray is always
  * from uniform distribution
  *
- * @returns list of rays
+ * The rays are generated in chunks: first all random samples of a chunk are drawn (in the same order as
+ * the former scalar implementation, so that fixed-seed results are unchanged), then they are
+ * transformed by the batched kernels from SourceSampling.h.
+ *
+ * writes the rays to `out`
  */
-std::vector<Ray> PointSource::getRays(int thread_count) const {
+void PointSource::getRays(std::span<Ray> out, [[maybe_unused]] int thread_count) const {
     RAYX_PROFILE_FUNCTION();
 
-    /**
-     * initialize parallelization when counter is positive
-     * with special OMP use case for num_threads(1)
-     * */
-    if (thread_count == 0) {
-        thread_count = 1;
-#define DIPOLE_OMP
-    } else if (thread_count > 1) {
-#define DIPOLE_OMP
+    const size_t n = m_numberOfRays;
+    RAYX_VERB << "Create " << n << " rays with standard normal deviation...";
+
+    const auto misalignment = getMisalignmentParams();
+
+    CoordSamples xSamples(m_widthDist), ySamples(m_heightDist), psiSamples(m_verDist), phiSamples(m_horDist);
+    CoordSamples zSamples(SourceDist::Uniform);
+
+    // importance sampling, see LightSource::setImportanceTarget
+    double weight = 1.0;
+    if (m_importanceTarget) {
+        // the ray origins, see below.
+        const glm::dvec3 center = glm::dvec3(m_position) + glm::dvec3(misalignment.m_translationXerror, misalignment.m_translationYerror, 0.0);
+        const glm::dvec3 maxOffset = {maxCoordOffset(m_widthDist, m_sourceWidth), maxCoordOffset(m_heightDist, m_sourceHeight), m_sourceDepth / 2.0};
+        if (auto w = divergenceWindow(*m_importanceTarget, center, maxOffset)) {
+            const double rotX = misalignment.m_rotationXerror.rad;
+            const double rotY = misalignment.m_rotationYerror.rad;
+            weight = phiSamples.restrictTo(w->m_phiMin - rotY, w->m_phiMax - rotY, m_horDivergence) *
+                     psiSamples.restrictTo(w->m_psiMin - rotX, w->m_psiMax - rotX, m_verDivergence);
+            RAYX_VERB << "importance sampling the divergence of " << m_name << ", ray weight: " << weight;
+        } else {
+            RAYX_LOG << "cannot importance sample the divergence of " << m_name << " towards the first element, sampling all directions.";
+        }
     }
 
-    double x, y, z, psi, phi, en;  // x,y,z pos, psi,phi direction cosines, en=energy
+    const auto field = stokesToElectricField(m_pol * weight);
+    std::vector<double> x(SOURCE_SAMPLING_CHUNK_SIZE), y(SOURCE_SAMPLING_CHUNK_SIZE), z(SOURCE_SAMPLING_CHUNK_SIZE), psi(SOURCE_SAMPLING_CHUNK_SIZE),
+        phi(SOURCE_SAMPLING_CHUNK_SIZE), en(SOURCE_SAMPLING_CHUNK_SIZE);
+    std::vector<glm::dvec3> direction(SOURCE_SAMPLING_CHUNK_SIZE);
 
-    int n = m_numberOfRays;
-    std::vector<Ray> rayList;
-    rayList.reserve(m_numberOfRays);
-    RAYX_VERB << "Create " << n << " rays with standard normal deviation...";
+    // create n rays with random position and divergence within the given span
+    // for width, height, depth, horizontal and vertical divergence
+    for (size_t start = 0; start < n; start += SOURCE_SAMPLING_CHUNK_SIZE) {
+        const size_t m = std::min(SOURCE_SAMPLING_CHUNK_SIZE, n - start);
+
+        for (size_t i = 0; i < m; i++) {
+            xSamples.draw(i);
+            ySamples.draw(i);
+            zSamples.draw(i);
+            en[i] = selectEnergy();  // LightSource.cpp
+            psiSamples.draw(i);
+            phiSamples.draw(i);
+        }
+
+        xSamples.transform(x.data(), m, m_sourceWidth);
+        ySamples.transform(y.data(), m, m_sourceHeight);
+        zSamples.transform(z.data(), m, m_sourceDepth);
+        psiSamples.transform(psi.data(), m, m_verDivergence);
+        phiSamples.transform(phi.data(), m, m_horDivergence);
+
+#pragma omp simd
+        for (size_t i = 0; i < m; i++) {
+            x[i] = x[i] + misalignment.m_translationXerror + m_position.x;
+            y[i] = y[i] + misalignment.m_translationYerror + m_position.y;
+            z[i] = z[i] + m_position.z;
+            // get random deviation from main ray based on distribution
+            // TODO correct misalignments?
+            psi[i] = psi[i] + misalignment.m_rotationXerror.rad;
+            phi[i] = phi[i] + misalignment.m_rotationYerror.rad;
+        }
 
-// create n rays with random position and divergence within the given span
-// for width, height, depth, horizontal and vertical divergence
-#if defined(DIPOLE_OMP)
-#pragma omp parallel for num_threads(thread_count)
-#endif
-    for (int i = 0; i < n; i++) {
-        x = getCoord(m_widthDist, m_sourceWidth) + getMisalignmentParams().m_translationXerror;
-        x += m_position.x;
-        y = getCoord(m_heightDist, m_sourceHeight) + getMisalignmentParams().m_translationYerror;
-        y += m_position.y;
-        z = (randomDouble() - 0.5) * m_sourceDepth;
-        z += m_position.z;
-        en = selectEnergy();  // LightSource.cpp
-        glm::dvec3 position = glm::dvec3(x, y, z);
-
-        // get random deviation from main ray based on distribution
-        // TODO correct misalignments?
-        psi = getCoord(m_verDist, m_verDivergence) + getMisalignmentParams().m_rotationXerror.rad;
-        phi = getCoord(m_horDist, m_horDivergence) + getMisalignmentParams().m_rotationYerror.rad;
         // get corresponding angles based on distribution and deviation from
         // main ray (main ray: xDir=0,yDir=0,zDir=1 for phi=psi=0)
-        glm::dvec3 direction = getDirectionFromAngles(phi, psi);
-        glm::dvec4 tempDir = m_orientation * glm::dvec4(direction, 0.0);
-        direction = glm::dvec3(tempDir.x, tempDir.y, tempDir.z);
-
-        // const auto rotation = rotationMatrix(direction);
-        const auto field = /* rotation *  */ stokesToElectricField(m_pol);
-
-        Ray r = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, -1.0};
-#if defined(DIPOLE_OMP)
-#pragma omp critical
-        { rayList.push_back(r); }
-#else
-        rayList.push_back(r);
-#endif
+        directionsFromAngles(phi.data(), psi.data(), m_orientation, direction.data(), m);
+
+        for (size_t i = 0; i < m; i++) {
+            out[start + i] = {glm::dvec3(x[i], y[i], z[i]), ETYPE_UNINIT, direction[i], en[i], field, 0.0, 0.0, -1.0, m_sourceID};
+        }
     }
-    return rayList;
 }
 
 }  // namespace RAYX
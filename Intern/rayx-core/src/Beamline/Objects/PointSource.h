@@ -12,7 +12,7 @@ class RAYX_API PointSource : public LightSource {
     PointSource(const DesignSource&);
     virtual ~PointSource() = default;
 
-    std::vector<Ray> getRays(int thread_count = 1) const;
+    void getRays(std::span<Ray> out, int thread_count = 1) const override;
 
   private:
     // Geometric Params
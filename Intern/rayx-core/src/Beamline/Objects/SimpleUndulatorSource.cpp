@@ -1,5 +1,8 @@
 #include "SimpleUndulatorSource.h"
 
+#include <algorithm>
+
+#include "Beamline/SourceSampling.h"
 #include "Data/xml.h"
 #include "Debug/Debug.h"
 #include "Debug/Instrumentor.h"
@@ -32,54 +35,75 @@ SimpleUndulatorSource::SimpleUndulatorSource(const DesignSource& dSource)
     m_sourceWidth = getSourceWidth();
 }
 
-/**
- * get deviation from main ray according to specified distribution (uniform if
- * hard edge, gaussian if soft edge)) and extent (eg specified width/height of
- * source)
- */
-double SimpleUndulatorSource::getCoord(const double extent) const { return randomNormal(0, 1) * extent; }
-
 /**
  * Creates random rays from simple undulator Source
+ * The rays are generated in chunks, see PointSource::getRays.
  *
- * @returns list of rays
+ * writes the rays to `out`
  */
-std::vector<Ray> SimpleUndulatorSource::getRays([[maybe_unused]] int thread_count) const {
+void SimpleUndulatorSource::getRays(std::span<Ray> out, [[maybe_unused]] int thread_count) const {
     RAYX_PROFILE_FUNCTION();
 
-    double x, y, z, psi, phi, en;  // x,y,z pos, psi,phi direction cosines, en=energy
-
-    int n = m_numberOfRays;
-    std::vector<Ray> rayList;
-    rayList.reserve(m_numberOfRays);
+    const size_t n = m_numberOfRays;
     RAYX_VERB << "Create " << n << " rays with standard normal deviation...";
 
+    CoordSamples xSamples(SourceDist::Gaussian), ySamples(SourceDist::Gaussian), phiSamples(SourceDist::Gaussian), psiSamples(SourceDist::Gaussian);
+    CoordSamples zSamples(SourceDist::Uniform);
+
+    // importance sampling, see LightSource::setImportanceTarget
+    double weight = 1.0;
+    if (m_importanceTarget) {
+        const glm::dvec3 maxOffset = {maxCoordOffset(SourceDist::Gaussian, m_sourceWidth), maxCoordOffset(SourceDist::Gaussian, m_sourceHeight),
+                                      m_sourceDepth / 2.0};
+        // the rays start around (0, 0, m_position.z), see below.
+        const glm::dvec3 center = {0.0, 0.0, m_position.z};
+        if (auto w = divergenceWindow(*m_importanceTarget, center, maxOffset)) {
+            weight = phiSamples.restrictTo(w->m_phiMin, w->m_phiMax, m_horDivergence) * psiSamples.restrictTo(w->m_psiMin, w->m_psiMax, m_verDivergence);
+            RAYX_VERB << "importance sampling the divergence of " << m_name << ", ray weight: " << weight;
+        } else {
+            RAYX_LOG << "cannot importance sample the divergence of " << m_name << " towards the first element, sampling all directions.";
+        }
+    }
+
+    const auto rotation = glm::dmat3(m_orientation);
+    const auto field = rotation * stokesToElectricField(m_pol * weight);
+    std::vector<double> x(SOURCE_SAMPLING_CHUNK_SIZE), y(SOURCE_SAMPLING_CHUNK_SIZE), z(SOURCE_SAMPLING_CHUNK_SIZE), phi(SOURCE_SAMPLING_CHUNK_SIZE),
+        psi(SOURCE_SAMPLING_CHUNK_SIZE), en(SOURCE_SAMPLING_CHUNK_SIZE);
+    std::vector<glm::dvec3> direction(SOURCE_SAMPLING_CHUNK_SIZE);
+
     // create n rays with random position and divergence within the given span
     // for width, height, depth, horizontal and vertical divergence
-    for (int i = 0; i < n; i++) {
-        x = getCoord(m_sourceWidth);
-        y = getCoord(m_sourceHeight);
-        z = (randomDouble() - 0.5) * m_sourceDepth;
-        z += m_position.z;
-        en = selectEnergy();  // LightSource.cpp
-        glm::dvec3 position = glm::dvec3(x, y, z);
-
-        phi = getCoord(m_horDivergence);
-        psi = getCoord(m_verDivergence);
+    for (size_t start = 0; start < n; start += SOURCE_SAMPLING_CHUNK_SIZE) {
+        const size_t m = std::min(SOURCE_SAMPLING_CHUNK_SIZE, n - start);
+
+        for (size_t i = 0; i < m; i++) {
+            xSamples.draw(i);
+            ySamples.draw(i);
+            zSamples.draw(i);
+            en[i] = selectEnergy();  // LightSource.cpp
+            phiSamples.draw(i);
+            psiSamples.draw(i);
+        }
+
+        xSamples.transform(x.data(), m, m_sourceWidth);
+        ySamples.transform(y.data(), m, m_sourceHeight);
+        zSamples.transform(z.data(), m, m_sourceDepth);
+        phiSamples.transform(phi.data(), m, m_horDivergence);
+        psiSamples.transform(psi.data(), m, m_verDivergence);
+
+#pragma omp simd
+        for (size_t i = 0; i < m; i++) {
+            z[i] += m_position.z;
+        }
+
         // get corresponding angles based on distribution and deviation from
         // main ray (main ray: xDir=0,yDir=0,zDir=1 for phi=psi=0)
-        glm::dvec3 direction = getDirectionFromAngles(phi, psi);
-        glm::dvec4 tempDir = m_orientation * glm::dvec4(direction, 0.0);
-        direction = glm::dvec3(tempDir.x, tempDir.y, tempDir.z);
-
-        const auto rotation = glm::dmat3(m_orientation);
-        const auto field = rotation * stokesToElectricField(m_pol);
-
-        Ray r = {position, ETYPE_UNINIT, direction, en, field, 0.0, 0.0, -1.0, -1.0};
+        directionsFromAngles(phi.data(), psi.data(), m_orientation, direction.data(), m);
 
-        rayList.push_back(r);
+        for (size_t i = 0; i < m; i++) {
+            out[start + i] = {glm::dvec3(x[i], y[i], z[i]), ETYPE_UNINIT, direction[i], en[i], field, 0.0, 0.0, -1.0, m_sourceID};
+        }
     }
-    return rayList;
 }
 
 double SimpleUndulatorSource::calcUndulatorSigma() const {
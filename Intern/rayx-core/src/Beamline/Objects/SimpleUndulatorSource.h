@@ -9,7 +9,7 @@ class RAYX_API SimpleUndulatorSource : public LightSource {
     SimpleUndulatorSource(const DesignSource&);
     virtual ~SimpleUndulatorSource() = default;
 
-    std::vector<Ray> getRays(int thread_count = 1) const override;
+    void getRays(std::span<Ray> out, int thread_count = 1) const override;
 
     double calcUndulatorSigma() const;
     double calcUndulatorSigmaS() const;
@@ -20,8 +20,6 @@ class RAYX_API SimpleUndulatorSource : public LightSource {
 
     double getVerDivergence() const;
 
-    double getCoord(double extent) const;
-
   private:
     // Geometric Params
     double m_sourceDepth;
@@ -0,0 +1,71 @@
+#include "SourceAcceptance.h"
+
+#include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+#include "Shader/Collision.h"
+#include "Shader/Utils.h"
+
+namespace RAYX {
+
+uint64_t SourceAcceptance::numberOfRays() const {
+    uint64_t n = 0;
+    for (auto generated : m_generated) n += generated;
+    return n;
+}
+
+double SourceAcceptance::acceptedFraction(size_t sourceID) const {
+    if (m_generated[sourceID] == 0) return 0.0;
+    return static_cast<double>(m_accepted[sourceID]) / static_cast<double>(m_generated[sourceID]);
+}
+
+double SourceAcceptance::acceptedFlux(size_t sourceID) const {
+    if (m_generatedIntensity[sourceID] <= 0.0) return 0.0;
+    return m_acceptedIntensity[sourceID] / m_generatedIntensity[sourceID];
+}
+
+void SourceAcceptance::log() const {
+    for (size_t i = 0; i < m_generated.size(); i++) {
+        RAYX_LOG << "Source " << i << ": " << m_accepted[i] << " of " << m_generated[i] << " rays hit the first element. The accepted rays carry "
+                 << acceptedFlux(i) * 100.0 << "% of the emitted flux.";
+    }
+}
+
+SourceAcceptance cullSourceRays(std::vector<Ray>& rays, const Element& firstElement, size_t numSources) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    const auto n = static_cast<int64_t>(rays.size());
+    std::vector<uint8_t> accepted(rays.size());
+    const ElementRecord record = makeElementRecord(firstElement);
+
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; i++) {
+        // see findCollisionWith, the slope error only affects the normal.
+        Ray r = rayMatrixMult(rays[i], record.m_inTrans);
+        accepted[i] = findCollisionInElementCoords(r, record.m_surface, record.m_cutout, false).found;
+    }
+
+    SourceAcceptance out;
+    out.m_generated.assign(numSources, 0);
+    out.m_accepted.assign(numSources, 0);
+    out.m_generatedIntensity.assign(numSources, 0.0);
+    out.m_acceptedIntensity.assign(numSources, 0.0);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < rays.size(); i++) {
+        const auto sourceID = static_cast<size_t>(rays[i].m_sourceID);
+        const double rayIntensity = intensity(rays[i].m_field);
+        out.m_generated[sourceID]++;
+        out.m_generatedIntensity[sourceID] += rayIntensity;
+        if (accepted[i]) {
+            out.m_accepted[sourceID]++;
+            out.m_acceptedIntensity[sourceID] += rayIntensity;
+            out.m_rayIds.push_back(static_cast<int64_t>(i));
+            rays[kept++] = rays[i];
+        }
+    }
+    rays.resize(kept);
+
+    return out;
+}
+
+}  // namespace RAYX
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "Core.h"
+#include "Element/Element.h"
+#include "Shader/Ray.h"
+
+namespace RAYX {
+
+/**
+ * Statistics of the source-acceptance pre-culling.
+ *
+ * In sequential tracing, a ray can only interact with the beamline if it hits the first element. All other rays are absorbed by the "horizon"
+ * right away. Wide-divergence sources (e.g. dipoles) emit lots of such rays, which can be rejected before tracing.
+ * The rejected rays are only counted here, so that intensity normalisation stays correct:
+ * the accepted rays of source i carry `acceptedFlux(i)` of the total flux emitted by source i.
+ *
+ * The accepted rays keep their original ray-ids (see m_rayIds), hence they are traced with the same random numbers as without culling, and the
+ * rejected rays show up as rays without events in the output.
+ */
+struct RAYX_API SourceAcceptance {
+    // indexed by the source ID.
+    std::vector<uint64_t> m_generated;
+    std::vector<uint64_t> m_accepted;
+    // the summed intensities of the generated resp. accepted rays, indexed by the source ID.
+    std::vector<double> m_generatedIntensity;
+    std::vector<double> m_acceptedIntensity;
+
+    // the ray-id, i.e. the index before culling, of each accepted ray.
+    std::vector<int64_t> m_rayIds;
+
+    // the number of rays before culling.
+    uint64_t numberOfRays() const;
+
+    // the fraction of the rays of source i which were accepted.
+    double acceptedFraction(size_t sourceID) const;
+
+    // the fraction of the intensity of source i, which is carried by the accepted rays.
+    double acceptedFlux(size_t sourceID) const;
+
+    // logs the acceptance of each source.
+    void log() const;
+};
+
+// Removes all rays which do not hit the first element, using the same collision test as the sequential tracer (m_inTrans, surface and cutout of
+// `firstElement`). The order of the remaining rays is preserved. `numSources` is the number of light sources of the beamline.
+RAYX_API SourceAcceptance cullSourceRays(std::vector<Ray>& rays, const Element& firstElement, size_t numSources);
+
+}  // namespace RAYX
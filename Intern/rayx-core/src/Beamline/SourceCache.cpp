@@ -0,0 +1,349 @@
+#include "SourceCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RAYX_SOURCE_CACHE_MMAP
+#elif defined(_WIN32)
+#include <process.h>
+#endif
+
+#include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+#include "Element/Element.h"
+#include "Random.h"
+
+namespace RAYX {
+
+namespace {
+
+// increment this whenever the file layout or the semantics of a source change, so that stale entries are ignored.
+constexpr uint32_t SOURCE_CACHE_VERSION = 4;
+constexpr char SOURCE_CACHE_MAGIC[8] = {'R', 'A', 'Y', 'X', 'S', 'R', 'C', '\0'};
+// the ray array starts at a multiple of this, so that it is properly aligned in a mapping.
+constexpr uint64_t SOURCE_CACHE_RAY_ALIGNMENT = 64;
+
+struct SourceCacheHeader {
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_raySize;
+    uint64_t m_key;
+    uint64_t m_numberOfRays;
+    uint64_t m_rngStateSize;
+    uint64_t m_rayOffset;
+};
+
+// a temporary file name next to `path`, which no other store() uses, also not one of a concurrent run.
+std::filesystem::path temporaryPath(const std::filesystem::path& path) {
+    static std::atomic<uint64_t> counter = 0;
+#if defined(_WIN32)
+    const int pid = _getpid();
+#else
+    const int pid = static_cast<int>(getpid());
+#endif
+    auto tmp = path;
+    tmp += "." + std::to_string(pid) + "." + std::to_string(counter++) + ".tmp";
+    return tmp;
+}
+
+uint64_t rayOffset(uint64_t rngStateSize) {
+    uint64_t end = sizeof(SourceCacheHeader) + rngStateSize;
+    return (end + SOURCE_CACHE_RAY_ALIGNMENT - 1) / SOURCE_CACHE_RAY_ALIGNMENT * SOURCE_CACHE_RAY_ALIGNMENT;
+}
+
+// FNV-1a, see https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+struct Hasher {
+    uint64_t m_state = 0xcbf29ce484222325ull;
+
+    void bytes(const void* data, size_t size) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            m_state ^= p[i];
+            m_state *= 0x100000001b3ull;
+        }
+    }
+
+    // only used for types consisting of doubles and enums, which have no padding.
+    template <typename T>
+    void value(const T& x) {
+        bytes(&x, sizeof(T));
+    }
+
+    void string(const std::string& s) {
+        value<uint64_t>(s.size());
+        bytes(s.data(), s.size());
+    }
+};
+
+// hashes the contents of an external file, so that editing or replacing it invalidates the entries. Unreadable files only contribute a
+// marker, generating the rays will report them anyway.
+void hashFileContents(Hasher& h, const std::string& filename) {
+    std::ifstream f(filename, std::ios::binary);
+    h.value(f.is_open());
+    std::vector<char> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    h.value<uint64_t>(data.size());
+    h.bytes(data.data(), data.size());
+}
+
+// hashes the fields of `e` one by one, the padding bytes of the struct would make the key irreproducible.
+void hashElement(Hasher& h, const Element& e) {
+    h.value(e.m_inTrans);
+    h.value(e.m_outTrans);
+    h.value(e.m_behaviour.m_type);
+    h.value(e.m_behaviour.m_private_serialization_params);
+    h.value(e.m_surface.m_type);
+    h.value(e.m_surface.m_private_serialization_params);
+    h.value(e.m_cutout.m_type);
+    h.value(e.m_cutout.m_private_serialization_params);
+    h.value(e.m_slopeError.m_sag);
+    h.value(e.m_slopeError.m_mer);
+    h.value(e.m_slopeError.m_thermalDistortionAmp);
+    h.value(e.m_slopeError.m_thermalDistortionSigmaX);
+    h.value(e.m_slopeError.m_thermalDistortionSigmaZ);
+    h.value(e.m_slopeError.m_cylindricalBowingAmp);
+    h.value(e.m_slopeError.m_cylindricalBowingRadius);
+    h.value(e.m_azimuthalAngle);
+    h.value(e.m_material);
+}
+
+void hashDesignMap(Hasher& h, const DesignMap& m) {
+    h.value(static_cast<int>(m.type()));
+    switch (m.type()) {
+        case ValueType::Undefined:
+            break;
+        case ValueType::Double:
+            h.value(m.as_double());
+            break;
+        case ValueType::Int:
+            h.value(m.as_int());
+            break;
+        case ValueType::Bool:
+            h.value(m.as_bool());
+            break;
+        case ValueType::String:
+            h.string(m.as_string());
+            break;
+        case ValueType::Dvec4:
+            h.value(m.as_dvec4());
+            break;
+        case ValueType::Dmat4x4:
+            h.value(m.as_dmat4x4());
+            break;
+        case ValueType::Rad:
+            h.value(m.as_rad().rad);
+            break;
+        case ValueType::Material:
+            h.value(m.as_material());
+            break;
+        case ValueType::Misalignment:
+            h.value(m.as_misalignment());
+            break;
+        case ValueType::CentralBeamstop:
+            h.value(m.as_centralBeamStop());
+            break;
+        case ValueType::Cutout:
+            h.value(m.as_cutout());
+            break;
+        case ValueType::CylinderDirection:
+            h.value(m.as_cylinderDirection());
+            break;
+        case ValueType::FigureRotation:
+            h.value(m.as_figureRotation());
+            break;
+        case ValueType::CurvatureType:
+            h.value(m.as_curvatureType());
+            break;
+        case ValueType::Surface:
+            h.value(m.as_surface());
+            break;
+        case ValueType::SourceDist:
+            h.value(m.as_sourceDist());
+            break;
+        case ValueType::SpreadType:
+            h.value(m.as_energySpreadType());
+            break;
+        case ValueType::EnergyDistributionType:
+            h.value(m.as_energyDistType());
+            break;
+        case ValueType::EnergySpreadUnit:
+            h.value(m.as_energySpreadUnit());
+            break;
+        case ValueType::ElectronEnergyOrientation:
+            h.value(m.as_electronEnergyOrientation());
+            break;
+        case ValueType::SigmaType:
+            h.value(m.as_sigmaType());
+            break;
+        case ValueType::BehaviourType:
+            h.value(m.as_behaviourType());
+            break;
+        case ValueType::ElementType:
+            h.value(m.as_elementType());
+            break;
+        case ValueType::GratingMount:
+            h.value(m.as_gratingMount());
+            break;
+        case ValueType::Map: {
+            // unordered_map iteration order is unspecified, hence we sort the keys.
+            std::vector<std::string> keys;
+            for (const auto& [k, v] : m) {
+                keys.push_back(k);
+            }
+            std::sort(keys.begin(), keys.end());
+            h.value<uint64_t>(keys.size());
+            for (const auto& k : keys) {
+                h.string(k);
+                hashDesignMap(h, m[k]);
+                if (k == "photonEnergyDistributionFile" && m[k].type() == ValueType::String) {
+                    hashFileContents(h, m[k].as_string());
+                }
+            }
+            break;
+        }
+    }
+}
+
+}  // namespace
+
+SourceCache::SourceCache(std::filesystem::path directory) : m_directory(std::move(directory)) {}
+
+uint64_t SourceCache::key(const DesignSource& dSource, int sourceID, const Element* importanceTarget) {
+    Hasher h;
+    h.value(SOURCE_CACHE_VERSION);
+    h.value<uint64_t>(sizeof(Ray));
+    h.value<uint64_t>(static_cast<uint64_t>(dSource.getNumberOfRays()));
+    h.string(getRandomState());
+    hashDesignMap(h, dSource.m_elementParameters);
+    h.value(importanceTarget != nullptr);
+    if (importanceTarget) hashElement(h, *importanceTarget);
+    h.value(sourceID);
+    return h.m_state;
+}
+
+std::filesystem::path SourceCache::entryPath(uint64_t key) const {
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << key << ".rays";
+    return m_directory / ss.str();
+}
+
+void SourceCache::getRays(std::span<Ray> out, const DesignSource& dSource, int thread_count, int sourceID,
+                          const Element* importanceTarget) const {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    const uint64_t k = key(dSource, sourceID, importanceTarget);
+
+    if (load(k, out)) {
+        RAYX_VERB << "loaded " << out.size() << " rays of source '" << dSource.getName() << "' from cache " << entryPath(k);
+        return;
+    }
+
+    dSource.compile(out, thread_count, sourceID, importanceTarget);
+    store(k, out, getRandomState());
+}
+
+bool SourceCache::load(uint64_t key, std::span<Ray> out) const {
+    const auto path = entryPath(key);
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        return false;
+    }
+
+    // validates the header and copies the rays out of `data`, which holds the whole file.
+    auto parse = [&](const char* data, uint64_t size) -> bool {
+        SourceCacheHeader header;
+        if (size < sizeof(header)) return false;
+        std::memcpy(&header, data, sizeof(header));
+
+        if (std::memcmp(header.m_magic, SOURCE_CACHE_MAGIC, sizeof(SOURCE_CACHE_MAGIC)) != 0 || header.m_version != SOURCE_CACHE_VERSION ||
+            header.m_raySize != sizeof(Ray) || header.m_key != key || header.m_rayOffset != rayOffset(header.m_rngStateSize) ||
+            size != header.m_rayOffset + header.m_numberOfRays * sizeof(Ray)) {
+            RAYX_WARN << "ignoring invalid source cache entry " << path;
+            return false;
+        }
+        if (header.m_numberOfRays != out.size()) {
+            RAYX_WARN << "ignoring source cache entry " << path << ", it contains " << header.m_numberOfRays << " instead of " << out.size()
+                      << " rays";
+            return false;
+        }
+
+        std::memcpy(static_cast<void*>(out.data()), data + header.m_rayOffset, out.size() * sizeof(Ray));
+        setRandomState(std::string(data + sizeof(header), header.m_rngStateSize));
+        return true;
+    };
+
+#ifdef RAYX_SOURCE_CACHE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+    const bool found = parse(static_cast<const char*>(mapping), static_cast<uint64_t>(st.st_size));
+    munmap(mapping, st.st_size);
+    return found;
+#else
+    std::ifstream f(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    return parse(data.data(), data.size());
+#endif
+}
+
+void SourceCache::store(uint64_t key, std::span<const Ray> rays, const std::string& rngStateAfter) const {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec) {
+        RAYX_WARN << "could not create source cache directory " << m_directory << ": " << ec.message();
+        return;
+    }
+
+    SourceCacheHeader header{};
+    std::memcpy(header.m_magic, SOURCE_CACHE_MAGIC, sizeof(SOURCE_CACHE_MAGIC));
+    header.m_version = SOURCE_CACHE_VERSION;
+    header.m_raySize = sizeof(Ray);
+    header.m_key = key;
+    header.m_numberOfRays = rays.size();
+    header.m_rngStateSize = rngStateAfter.size();
+    header.m_rayOffset = rayOffset(header.m_rngStateSize);
+
+    // write to a temporary file first, so that concurrent runs never observe a half-written entry.
+    const auto path = entryPath(key);
+    const auto tmp = temporaryPath(path);
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            RAYX_WARN << "could not write source cache entry " << tmp;
+            return;
+        }
+        f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        f.write(rngStateAfter.data(), rngStateAfter.size());
+        const std::vector<char> padding(header.m_rayOffset - sizeof(header) - rngStateAfter.size(), 0);
+        f.write(padding.data(), padding.size());
+        f.write(reinterpret_cast<const char*>(rays.data()), rays.size() * sizeof(Ray));
+        if (!f) {
+            RAYX_WARN << "could not write source cache entry " << tmp;
+            f.close();
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        RAYX_WARN << "could not write source cache entry " << path << ": " << ec.message();
+        std::filesystem::remove(tmp, ec);
+    }
+}
+
+}  // namespace RAYX
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+
+#include "Core.h"
+#include "Design/DesignSource.h"
+#include "Shader/Ray.h"
+
+namespace RAYX {
+
+/**
+ * The SourceCache stores the rays generated by a DesignSource on disk, so that repeated traces of the same beamline (e.g. parameter scans of
+ * downstream elements) do not have to re-generate millions of source rays.
+ *
+ * A cache entry is identified by a hash over
+ * - all parameters of the DesignSource (recursively, in sorted key order),
+ * - the contents of the energy distribution .DAT file (if any),
+ * - the number of rays,
+ * - the RNG state before generation (this covers the seed, and any random draws that happened before),
+ * - the memory layout of `Ray`,
+ * - the importance sampling target (if any),
+ * - the source ID the rays are tagged with.
+ *
+ * Each entry is a single binary file: a small header, the RNG state after generation, followed by the packed `Ray` array.
+ * The file is memory-mapped when loading, and the rays are copied straight from the mapping into the caller's buffer. On a cache hit, the RNG state after generation is restored, hence any later random draws (e.g. the
+ * seed of the tracer) are identical to a run without cache.
+ */
+class RAYX_API SourceCache {
+  public:
+    explicit SourceCache(std::filesystem::path directory);
+
+    /// writes the rays of `dSource` to `out` (which has to hold exactly dSource.getNumberOfRays() rays), either loaded from the cache, or
+    /// generated (and then stored in the cache). `sourceID` and `importanceTarget` are passed on to DesignSource::compile.
+    void getRays(std::span<Ray> out, const DesignSource& dSource, int thread_count, int sourceID,
+                 const Element* importanceTarget = nullptr) const;
+
+    /// computes the cache key of `dSource` for the current RNG state.
+    static uint64_t key(const DesignSource& dSource, int sourceID, const Element* importanceTarget = nullptr);
+
+    std::filesystem::path entryPath(uint64_t key) const;
+
+  private:
+    // returns false if there is no valid entry for `key` with exactly out.size() rays.
+    bool load(uint64_t key, std::span<Ray> out) const;
+    void store(uint64_t key, std::span<const Ray> rays, const std::string& rngStateAfter) const;
+
+    std::filesystem::path m_directory;
+};
+
+}  // namespace RAYX
@@ -0,0 +1,145 @@
+#include "SourceSampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Random.h"
+#include "Shader/Constants.h"
+
+namespace RAYX {
+
+void boxMuller(const double* u1, const double* u2, double* z0, double* z1, size_t n, double mu, double sigma) {
+    const double two_pi = 2.0 * PI;
+
+    if (z1 == nullptr) {
+#pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            double mag = sigma * std::sqrt(-2.0 * std::log(u1[i]));
+            z0[i] = mag * std::cos(two_pi * u2[i]) + mu;
+        }
+    } else {
+#pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            double mag = sigma * std::sqrt(-2.0 * std::log(u1[i]));
+            z0[i] = mag * std::cos(two_pi * u2[i]) + mu;
+            z1[i] = mag * std::sin(two_pi * u2[i]) + mu;
+        }
+    }
+}
+
+void uniformToRange(const double* u, double* out, size_t n, double extent) {
+#pragma omp simd
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (u[i] - 0.5) * extent;
+    }
+}
+
+void directionsFromAngles(const double* phi, const double* psi, const glm::dmat4& orientation, glm::dvec3* out, size_t n) {
+    const glm::dmat3 rot(orientation);
+
+#pragma omp simd
+    for (size_t i = 0; i < n; i++) {
+        // see LightSource::getDirectionFromAngles
+        double cosPsi = std::cos(psi[i]);
+        double al = cosPsi * std::sin(phi[i]);
+        double am = -std::sin(psi[i]);
+        double an = cosPsi * std::cos(phi[i]);
+        out[i] = rot * glm::dvec3(al, am, an);
+    }
+}
+
+namespace {
+
+// cumulative distribution function of the standard normal distribution.
+double normalCdf(double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+// inverse of normalCdf, using the rational approximation by P. J. Acklam (relative error < 1.2e-9),
+// followed by one step of Halley's method to reach full double precision.
+double inverseNormalCdf(double p) {
+    constexpr double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                            1.383577518672690e+02,  -3.066479806614716e+01, 2.506628277459239e+00};
+    constexpr double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+    constexpr double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                            -2.549732539343734e+00, 4.374664141464968e+00,  2.938163982698783e+00};
+    constexpr double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+    constexpr double low = 0.02425;
+
+    double x;
+    if (p < low) {
+        double q = std::sqrt(-2.0 * std::log(p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    } else if (p <= 1.0 - low) {
+        double q = p - 0.5;
+        double r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+    } else {
+        double q = std::sqrt(-2.0 * std::log(1.0 - p));
+        x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+
+    double e = normalCdf(x) - p;
+    double u = e * std::sqrt(2.0 * PI) * std::exp(x * x / 2.0);
+    return x - u / (1.0 + x * u / 2.0);
+}
+
+}  // namespace
+
+double maxCoordOffset(SourceDist dist, double extent) { return dist == SourceDist::Uniform ? extent / 2.0 : 4.0 * extent; }
+
+CoordSamples::CoordSamples(SourceDist dist) : m_dist(dist), m_u1(SOURCE_SAMPLING_CHUNK_SIZE) {
+    if (m_dist != SourceDist::Uniform) {
+        m_u2.resize(SOURCE_SAMPLING_CHUNK_SIZE);
+    }
+}
+
+double CoordSamples::restrictTo(double lo, double hi, double extent) {
+    // a coordinate without spread can't be restricted.
+    if (extent <= 0.0) return 1.0;
+
+    if (m_dist == SourceDist::Uniform) {
+        m_cdfLo = std::clamp(lo / extent + 0.5, 0.0, 1.0);
+        m_cdfHi = std::clamp(hi / extent + 0.5, 0.0, 1.0);
+    } else {
+        m_cdfLo = normalCdf(lo / extent);
+        m_cdfHi = normalCdf(hi / extent);
+    }
+    m_cdfHi = std::max(m_cdfHi, m_cdfLo);
+    m_restricted = true;
+    return m_cdfHi - m_cdfLo;
+}
+
+void CoordSamples::draw(size_t i) {
+    if (m_restricted || m_dist == SourceDist::Uniform) {
+        m_u1[i] = randomDouble();
+    } else {
+        randomNormalUniforms(m_u1[i], m_u2[i]);
+    }
+}
+
+void CoordSamples::transform(double* out, size_t n, double extent) const {
+    if (m_restricted) {
+        // inverse transform sampling of the restricted distribution.
+        // p is clamped away from 0 and 1, where the inverse normal cdf diverges.
+        constexpr double eps = 1e-300;
+        for (size_t i = 0; i < n; i++) {
+            double p = m_cdfLo + m_u1[i] * (m_cdfHi - m_cdfLo);
+            if (m_dist == SourceDist::Uniform) {
+                out[i] = (p - 0.5) * extent;
+            } else {
+                out[i] = inverseNormalCdf(std::clamp(p, eps, 1.0 - 1e-16)) * extent;
+            }
+        }
+    } else if (m_dist == SourceDist::Uniform) {
+        uniformToRange(m_u1.data(), out, n, extent);
+    } else {
+        // scale after the transform, as randomNormal(0, 1) * extent would round differently than randomNormal(0, extent).
+        boxMuller(m_u1.data(), m_u2.data(), out, nullptr, n, 0.0, 1.0);
+#pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            out[i] *= extent;
+        }
+    }
+}
+
+}  // namespace RAYX
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm.h>
+
+#include <vector>
+
+#include "Beamline/LightSource.h"
+#include "Core.h"
+
+// Batched sampling kernels for the light sources.
+//
+// Drawing random numbers from the (inherently sequential) mt19937 is cheap, the expensive part of source generation is transforming them:
+// log, sqrt and cos for every Box-Muller sample, and sin/cos plus a matrix multiplication for every direction.
+// Hence the sources draw their raw uniform samples in a scalar loop (in exactly the order in which they used to be consumed, so fixed-seed results
+// stay the same), and then transform a whole chunk of rays at once using the kernels below.
+// The kernels are plain loops over contiguous arrays annotated with `omp simd`. They only become vector code if the compiler may call a vector
+// math library for log/sin/cos (e.g. glibc's libmvec, which needs -fno-math-errno and a -march with AVX2), which the build doesn't enable.
+// Otherwise they are scalar loops, and the gain comes from separating the RNG from the transforms, see DISABLED_benchSourceSampling.
+
+namespace RAYX {
+
+// number of rays which are sampled at once. Chosen such that all temporary arrays of one chunk fit into L2 cache.
+constexpr size_t SOURCE_SAMPLING_CHUNK_SIZE = 2048;
+
+// Box-Muller transform: z0[i] = mu + sigma * sqrt(-2 log(u1[i])) * cos(2 pi u2[i]), z1[i] the same with sin.
+// `z1` may be nullptr if only one sample per pair is required.
+void RAYX_API boxMuller(const double* u1, const double* u2, double* z0, double* z1, size_t n, double mu, double sigma);
+
+// out[i] = (u[i] - 0.5) * extent
+void RAYX_API uniformToRange(const double* u, double* out, size_t n, double extent);
+
+// out[i] = orientation * getDirectionFromAngles(phi[i], psi[i])
+void RAYX_API directionsFromAngles(const double* phi, const double* psi, const glm::dmat4& orientation, glm::dvec3* out, size_t n);
+
+// the maximal deviation of a coordinate sampled by `CoordSamples` from zero, which we still consider relevant (4 sigma for normal distributions).
+double RAYX_API maxCoordOffset(SourceDist dist, double extent);
+
+// Raw samples of one coordinate of a chunk of rays, which is distributed according to a `SourceDist`:
+// uniform over [-extent/2, extent/2] for SourceDist::Uniform, normal with standard deviation `extent` otherwise.
+class RAYX_API CoordSamples {
+  public:
+    explicit CoordSamples(SourceDist dist);
+
+    // draws the raw samples of ray i (in [0, SOURCE_SAMPLING_CHUNK_SIZE[) from the RNG.
+    void draw(size_t i);
+
+    // Restricts the samples to the interval [lo, hi] (in the unit of the transformed coordinates, i.e. scaled by `extent`).
+    // Returns the probability of this interval under the unrestricted distribution, which is the statistical weight of each restricted sample.
+    // Restricted samples are drawn by inverse transform sampling, hence they use one random number each.
+    double restrictTo(double lo, double hi, double extent);
+
+    // writes the coordinates of the first n rays to out. Yields the same values as
+    // `(randomDouble() - 0.5) * extent` resp. `randomNormal(0, 1) * extent` would.
+    void transform(double* out, size_t n, double extent) const;
+
+  private:
+    SourceDist m_dist;
+    std::vector<double> m_u1;
+    std::vector<double> m_u2;  // only used for unrestricted normal distributions.
+
+    // the restriction as an interval of the cumulative distribution function, see restrictTo.
+    bool m_restricted = false;
+    double m_cdfLo = 0.0;
+    double m_cdfHi = 1.0;
+};
+
+}  // namespace RAYX
@@ -3,33 +3,41 @@
 #include <filesystem>
 
 #include "Beamline/Objects/Objects.h"
+#include "Data/Strings.h"
 #include "Debug/Debug.h"
 namespace RAYX {
 
-std::vector<Ray> DesignSource::compile(int i) const {
-    std::vector<Ray> ray;
+std::vector<Ray> DesignSource::compile(int i, const Element* importanceTarget) const {
+    std::vector<Ray> ray(static_cast<size_t>(getNumberOfRays()));
+    compile(ray, i, -1, importanceTarget);
+    return ray;
+}
+
+void DesignSource::compile(std::span<Ray> out, int i, int sourceID, const Element* importanceTarget) const {
+    // see LightSource::setImportanceTarget
+    if (importanceTarget && getType() != ElementType::PointSource && getType() != ElementType::SimpleUndulatorSource) {
+        RAYX_LOG << "importance sampling is not supported by " << ElementStringMap[getType()] << " " << getName() << ", sampling all directions.";
+    }
+
+    auto generate = [&](LightSource&& ls) {
+        ls.setImportanceTarget(importanceTarget);
+        ls.setSourceID(sourceID);
+        ls.getRays(out, i);
+    };
 
     if (getType() == ElementType::PointSource) {
-        PointSource ps(*this);
-        ray = ps.getRays(i);
+        generate(PointSource(*this));
     } else if (getType() == ElementType::MatrixSource) {
-        MatrixSource ms(*this);
-        ray = ms.getRays(i);
+        generate(MatrixSource(*this));
     } else if (getType() == ElementType::DipoleSource) {
-        DipoleSource ds(*this);
-        ray = ds.getRays(i);
+        generate(DipoleSource(*this));
     } else if (getType() == ElementType::PixelSource) {
-        PixelSource ps(*this);
-        ray = ps.getRays(i);
+        generate(PixelSource(*this));
     } else if (getType() == ElementType::CircleSource) {
-        CircleSource cs(*this);
-        ray = cs.getRays(i);
+        generate(CircleSource(*this));
     } else if (getType() == ElementType::SimpleUndulatorSource) {
-        SimpleUndulatorSource su(*this);
-        ray = su.getRays(i);
+        generate(SimpleUndulatorSource(*this));
     }
-
-    return ray;
 }
 
 void DesignSource::setName(std::string s) { m_elementParameters["name"] = s; }
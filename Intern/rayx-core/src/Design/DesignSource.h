@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "Shader/Ray.h"
 #include "Value.h"
 
@@ -7,7 +9,12 @@ namespace RAYX {
 
 struct RAYX_API DesignSource {
     DesignMap m_elementParameters;
-    std::vector<Ray> compile(int thread_count) const;
+    // generates the rays of this source. If `importanceTarget` is given, the divergence is importance sampled towards it,
+    // see LightSource::setImportanceTarget.
+    std::vector<Ray> compile(int thread_count, const Element* importanceTarget = nullptr) const;
+    // generates the rays of this source directly into `out`, which has to hold exactly getNumberOfRays() rays.
+    // The rays are tagged with `sourceID`.
+    void compile(std::span<Ray> out, int thread_count, int sourceID, const Element* importanceTarget = nullptr) const;
 
     void setStokeslin0(double value);
     void setStokeslin45(double value);
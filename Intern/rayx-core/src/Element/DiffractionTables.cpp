@@ -0,0 +1,84 @@
+#include "DiffractionTables.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Shader/Diffraction.h"
+
+namespace RAYX {
+
+namespace {
+
+// the pdf is integrated with the trapezoidal rule on this many intervals.
+constexpr int INTEGRATION_INTERVALS = 1 << 16;
+
+// weight of fraun_diff, with x = dAngle / (5 * wl / b).
+double fraunhoferPdf(double x) {
+    double u = 5.0 * PI * x;
+    if (u == 0) return 1.0;
+    double wd = std::sin(u) / u;
+    return wd * wd;
+}
+
+// weight of bessel_diff times the circumference of the radius x = r / (5 * wl / b), where r = sqrt(dphi^2 + dpsi^2).
+double airyPdf(double x) {
+    double u = 5.0 * std::sqrt(2.0) * PI * x;
+    if (u == 0) return 0.0;
+    double wd = 2.0 * bessel1(u) / u;
+    return x * wd * wd;
+}
+
+}  // namespace
+
+std::vector<double> inverseCdfTable(double (*pdf)(double), double lo, double hi) {
+    const double h = (hi - lo) / INTEGRATION_INTERVALS;
+    std::vector<double> cdf(INTEGRATION_INTERVALS + 1, 0.0);
+    double prev = pdf(lo);
+    for (int j = 1; j <= INTEGRATION_INTERVALS; j++) {
+        double cur = pdf(lo + j * h);
+        cdf[j] = cdf[j - 1] + 0.5 * (prev + cur) * h;
+        prev = cur;
+    }
+    const double total = cdf.back();
+
+    std::vector<double> out(DIFFRACTION_TABLE_SIZE);
+    for (int k = 0; k < DIFFRACTION_TABLE_SIZE; k++) {
+        const double p = total * k / (DIFFRACTION_TABLE_SIZE - 1);
+        // the last interval with cdf[j] <= p, the cdf is linear within it.
+        int j = int(std::upper_bound(cdf.begin(), cdf.end(), p) - cdf.begin()) - 1;
+        j = std::clamp(j, 0, INTEGRATION_INTERVALS - 1);
+        const double width = cdf[j + 1] - cdf[j];
+        const double f = width > 0 ? std::clamp((p - cdf[j]) / width, 0.0, 1.0) : 0.0;
+        out[k] = lo + (j + f) * h;
+    }
+    return out;
+}
+
+std::vector<double> buildDiffractionTables(const std::vector<Element>& elements) {
+    std::vector<double> out(elements.size(), -1.0);
+
+    // every table is only appended once, and shared by all slits using it.
+    int fraunhofer = -1;
+    int airy = -1;
+    auto append = [&out](const std::vector<double>& table) {
+        int offset = static_cast<int>(out.size());
+        out.insert(out.end(), table.begin(), table.end());
+        return offset;
+    };
+
+    for (size_t id = 0; id < elements.size(); id++) {
+        if (int(elements[id].m_behaviour.m_type) != BTYPE_SLIT) continue;
+        const auto openingType = int(deserializeSlit(elements[id].m_behaviour).m_openingCutout.m_type);
+        if (openingType == CTYPE_RECT) {
+            if (fraunhofer < 0) fraunhofer = append(inverseCdfTable(fraunhoferPdf, -1.0, 1.0));
+            out[id] = fraunhofer;
+        } else if (openingType == CTYPE_ELLIPTICAL) {
+            if (airy < 0) airy = append(inverseCdfTable(airyPdf, 0.0, AIRY_TABLE_MAX_RADIUS));
+            out[id] = airy;
+        }
+    }
+
+    return out;
+}
+
+}  // namespace RAYX
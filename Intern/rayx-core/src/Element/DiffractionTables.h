@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "Core.h"
+#include "Element.h"
+
+namespace RAYX {
+
+// builds the buffer `inv.diffractionTables` (see Shader/Diffraction.h) for `elements`.
+// every slit with a rectangular or elliptical opening references the table of its diffraction pattern, all other elements get the offset -1.
+RAYX_API std::vector<double> buildDiffractionTables(const std::vector<Element>& elements);
+
+// tabulates the inverse cumulative distribution function of `pdf` on [lo, hi] in DIFFRACTION_TABLE_SIZE nodes.
+RAYX_API std::vector<double> inverseCdfTable(double (*pdf)(double), double lo, double hi);
+
+}  // namespace RAYX
@@ -0,0 +1,30 @@
+#include "ElementRecord.h"
+
+#include "Shader/CutoutFns.h"
+
+namespace RAYX {
+
+ElementRecord makeElementRecord(const Element& element) {
+    ElementRecord record;
+    record.m_inTrans = glm::dmat4x3(element.m_inTrans);
+    record.m_outTrans = glm::dmat4x3(element.m_outTrans);
+    record.m_surface = decodeSurface(element.m_surface);
+
+    // the cutout is centered at (x=0, z=0).
+    glm::dvec2 size = cutoutBoundingBox(element.m_cutout);
+    record.m_cutout.m_cutout = element.m_cutout;
+    record.m_cutout.m_min = -size / 2.0;
+    record.m_cutout.m_max = size / 2.0;
+
+    record.m_slopeError = element.m_slopeError;
+
+    // the normal of a plane is (0, +-1, 0), for which the rotation of refrac2D is the identity (independent of the sign).
+    record.m_hasConstantNormal =
+        record.m_surface.m_type == STYPE_PLANE_XZ && element.m_slopeError.m_sag == 0 && element.m_slopeError.m_mer == 0;
+
+    record.m_behaviour = element.m_behaviour;
+    record.m_material = int(element.m_material);
+    return record;
+}
+
+}  // namespace RAYX
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glm.h>
+
+#include <type_traits>
+
+#include "Core.h"
+#include "Cutout.h"
+#include "Element.h"
+#include "Shader/SlopeError.h"
+#include "Surface.h"
+
+namespace RAYX {
+
+/**
+ * @brief A Surface with its parameters decoded into typed fields.
+ * Decoding happens once on the host, so that the collision code doesn't have to deserialize `m_private_serialization_params` for every ray.
+ */
+struct DecodedSurface {
+    int m_type;  ///< one of the STYPE constants.
+    union {
+        QuadricSurface m_quadric;
+        ToroidSurface m_toroid;
+        CubicSurface m_cubic;
+    };
+};
+
+RAYX_FN_ACC
+inline DecodedSurface decodeSurface(Surface surface) {
+    DecodedSurface out;
+    out.m_type = int(surface.m_type);
+    if (out.m_type == STYPE_QUADRIC) {
+        out.m_quadric = deserializeQuadric(surface);
+    } else if (out.m_type == STYPE_TOROID) {
+        out.m_toroid = deserializeToroid(surface);
+    } else if (out.m_type == STYPE_CUBIC) {
+        out.m_cubic = deserializeCubic(surface);
+    }
+    return out;
+}
+
+/**
+ * @brief A Cutout together with its bounding box in the XZ-plane.
+ * Most rays which miss an element are rejected by the bounding box alone, which is exact for rectangular cutouts.
+ */
+struct DecodedCutout {
+    Cutout m_cutout;
+    glm::dvec2 m_min;  ///< minimal (x, z) of the cutout.
+    glm::dvec2 m_max;  ///< maximal (x, z) of the cutout.
+};
+
+/**
+ * @brief The compact representation of an Element, which the shader reads on the device instead of the Element itself.
+ * The transformations of an Element are affine, hence only their upper 3x4 part is stored (the last row is always (0, 0, 0, 1)).
+ */
+struct ElementRecord {
+    glm::dmat4x3 m_inTrans;   ///< Converts a point from world coordinates to element coordinates.
+    glm::dmat4x3 m_outTrans;  ///< Converts a point from element coordinates back to world coordinates.
+    DecodedSurface m_surface;
+    DecodedCutout m_cutout;
+    SlopeError m_slopeError;
+    // planes without slope error have the normal (0, +-1, 0) at every hitpoint, for which refrac2D can skip its rotation (see refrac2DPlane).
+    bool m_hasConstantNormal;
+    Behaviour m_behaviour;
+    int m_material;  ///< see Element::m_material.
+};
+
+static_assert(std::is_trivially_copyable_v<ElementRecord>);
+
+// decodes the surface and cutout of `element`, and drops the constant row of its transformations.
+RAYX_API ElementRecord makeElementRecord(const Element& element);
+
+}  // namespace RAYX
@@ -0,0 +1,76 @@
+#include "FresnelTableBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+#include "Shader/FresnelTable.h"
+#include "Shader/RefractiveIndex.h"
+
+namespace RAYX {
+
+std::vector<double> buildFresnelTables(const std::vector<Element>& elements, const MaterialTables& materialTables, std::span<const Ray> rays) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    std::vector<double> out(elements.size(), -1.0);
+    if (rays.empty()) return out;
+
+    const auto [minRay, maxRay] =
+        std::minmax_element(rays.begin(), rays.end(), [](const Ray& a, const Ray& b) { return a.m_energy < b.m_energy; });
+    const double minEnergy = minRay->m_energy;
+    const double maxEnergy = maxRay->m_energy;
+    if (maxEnergy - minEnergy > FRESNEL_TABLE_MAX_ENERGY_SPREAD * maxEnergy) {
+        RAYX_VERB << "not tabulating refractive indices, the energy spread [" << minEnergy << ", " << maxEnergy << "] eV is too large";
+        return out;
+    }
+
+    InvState inv{};
+    inv.mat = materialTables.materialTable;
+    inv.matIdx = materialTables.indexTable;
+
+    for (size_t id = 0; id < elements.size(); id++) {
+        const auto& element = elements[id];
+        const int mat = int(element.m_material);
+        if (int(element.m_behaviour.m_type) != BTYPE_MIRROR || mat == -2) continue;
+
+        // getRefractiveIndex only changes at the entry energies of the tables, and right after the last Palik entry (above which it falls
+        // back to the Nff table).
+        std::vector<double> energies = {minEnergy};
+        auto addEnergy = [&](double energy) {
+            if (minEnergy < energy && energy <= maxEnergy) energies.push_back(energy);
+        };
+        const int palikCount = getPalikEntryCount(mat, inv);
+        for (int i = 0; i < palikCount; i++) addEnergy(getPalikEntry(i, mat, inv).m_energy);
+        if (palikCount > 0) addEnergy(std::nextafter(getPalikEntry(palikCount - 1, mat, inv).m_energy, std::numeric_limits<double>::max()));
+        const int nffCount = getNffEntryCount(mat, inv);
+        for (int i = 0; i < nffCount; i++) addEnergy(getNffEntry(i, mat, inv).m_energy);
+        std::sort(energies.begin(), energies.end());
+
+        out[id] = static_cast<double>(out.size());
+        const size_t header = out.size();
+        out.insert(out.end(), {minEnergy, maxEnergy, 0.0});
+        int segments = 0;
+        for (const double energy : energies) {
+            // same refractive indices as in behaveMirror.
+            constexpr int vacuum_material = -1;
+            const auto iorI = getRefractiveIndex(energy, vacuum_material, inv);
+            const auto iorT = getRefractiveIndex(energy, mat, inv);
+
+            // consecutive entries may yield the same refractive indices, e.g. Nff entries within the range of the Palik table.
+            const size_t last = out.size() - FRESNEL_TABLE_SEGMENT_SIZE;
+            if (segments > 0 && out[last + 1] == iorI.real() && out[last + 2] == iorI.imag() && out[last + 3] == iorT.real() &&
+                out[last + 4] == iorT.imag()) {
+                continue;
+            }
+            out.insert(out.end(), {energy, iorI.real(), iorI.imag(), iorT.real(), iorT.imag()});
+            segments++;
+        }
+        out[header + 2] = double(segments);
+    }
+
+    return out;
+}
+
+}  // namespace RAYX
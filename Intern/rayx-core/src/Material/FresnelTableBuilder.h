@@ -0,0 +1,19 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Core.h"
+#include "Element/Element.h"
+#include "Material.h"
+#include "Shader/Ray.h"
+
+namespace RAYX {
+
+// builds the buffer `inv.fresnelTables` (see Shader/FresnelTable.h) for `elements`, given the input `rays` of the trace.
+// mirrors only get a table if the energy spread of `rays` is at most FRESNEL_TABLE_MAX_ENERGY_SPREAD, otherwise all offsets are -1.
+// `materialTables` have to contain all materials of the mirrors, see Beamline::calcMinimalMaterialTables.
+std::vector<double> RAYX_API buildFresnelTables(const std::vector<Element>& elements, const MaterialTables& materialTables,
+                                                std::span<const Ray> rays);
+
+}  // namespace RAYX
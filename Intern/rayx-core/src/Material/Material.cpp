@@ -6,6 +6,9 @@
 #include <strings.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+
 #include "Debug/Debug.h"
 #include "NffTable.h"
 #include "PalikTable.h"
@@ -54,7 +57,41 @@ bool materialFromString(const char* matname, Material* out) {
     return false;
 }
 
-MaterialTables loadMaterialTables(std::array<bool, 92> relevantMaterials) {
+namespace {
+
+// the number of grid cells per table entry.
+constexpr size_t MATERIAL_GRID_CELLS_PER_ENTRY = 2;
+
+// the index that the binary search in getRefractiveIndex yields for `energy`:
+// the last entry with an energy <= `energy`, restricted to [0, count - 2].
+int lowerEntryIndex(const std::vector<double>& energies, double energy) {
+    if (energies.size() < 2) return 0;
+    auto it = std::upper_bound(energies.begin() + 1, energies.end() - 1, energy);
+    return static_cast<int>(it - energies.begin()) - 1;
+}
+
+// appends the lookup grid of a table with the given (ascending) entry energies to `out`. See getRefractiveIndex for its layout.
+void appendLookupGrid(const std::vector<double>& energies, std::vector<double>& out) {
+    if (energies.empty() || energies.front() <= 0.0) return;
+
+    const double logMin = std::log(energies.front());
+    const double logMax = std::log(energies.back());
+    const size_t cells = std::max<size_t>(1, energies.size() * MATERIAL_GRID_CELLS_PER_ENTRY);
+    const double cellsPerLog = logMax > logMin ? static_cast<double>(cells) / (logMax - logMin) : 0.0;
+
+    out.push_back(logMin);
+    out.push_back(cellsPerLog);
+    out.push_back(static_cast<double>(cells));
+    for (size_t c = 0; c < cells; c++) {
+        // the entry at the lower end of the cell. Together with the next cell, it bounds the binary search in the shader.
+        double cellEnergy = cellsPerLog > 0.0 ? std::exp(logMin + static_cast<double>(c) / cellsPerLog) : energies.front();
+        out.push_back(static_cast<double>(lowerEntryIndex(energies, cellEnergy)));
+    }
+}
+
+}  // namespace
+
+MaterialTables loadMaterialTables(std::array<bool, 92> relevantMaterials, MaterialLookup lookup) {
     MaterialTables out;
 
     auto mats = allNormalMaterials();
@@ -102,6 +139,24 @@ MaterialTables loadMaterialTables(std::array<bool, 92> relevantMaterials) {
     // within indexTable[i]..indexTable[i+1] can be used without checks.
     out.indexTable.push_back(out.materialTable.size());
 
+    // add the lookup grids, first for all palik tables, then for all nff tables.
+    // entry i of a table starts at indexTable[...] + 3 * i, and its energy is the first of the three doubles.
+    for (size_t table = 0; table < 2; table++) {
+        for (size_t i = 0; i < mats.size(); i++) {
+            out.indexTable.push_back(out.materialTable.size());
+            if (lookup != MaterialLookup::Grid) continue;
+
+            const int begin = out.indexTable[table * 92 + i];
+            const int end = out.indexTable[table * 92 + i + 1];
+            std::vector<double> energies;
+            for (int j = begin; j < end; j += 3) {
+                energies.push_back(out.materialTable[j]);
+            }
+            appendLookupGrid(energies, out.materialTable);
+        }
+    }
+    out.indexTable.push_back(out.materialTable.size());
+
     // materialTable can't be empty, because
     // Vulkan does not support empty buffers.
     if (out.materialTable.empty()) {
@@ -35,8 +35,15 @@ struct RAYX_API MaterialTables {
     std::vector<int> indexTable;        // called "inv_matIdx" in the shader.
 };
 
+/// How getRefractiveIndex finds the table entry for a given energy.
+/// Grid: every table gets a log-uniform energy grid. The grid cell of an energy bounds its entry, so that only the entries within the cell
+/// are binary searched (typically one or two, up to 18 in si.nff).
+/// BinarySearch: binary search through the tables. This needs no additional memory, and is kept for validation of the grids.
+/// Both yield exactly the same entries, wherever the table is sorted by energy.
+enum class MaterialLookup { Grid, BinarySearch };
+
 // the following function loads the Palik & Nff tables.
 // the tables will later be written to the mat and matIdx buffers of shader.comp
-MaterialTables RAYX_API loadMaterialTables(std::array<bool, 92> relevantMaterials);
+MaterialTables RAYX_API loadMaterialTables(std::array<bool, 92> relevantMaterials, MaterialLookup lookup = MaterialLookup::Grid);
 
 }  // namespace RAYX
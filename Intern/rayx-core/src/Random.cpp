@@ -2,18 +2,41 @@
 
 #include <algorithm>
 #include <random>
+#include <sstream>
 
 #include "Shader/Constants.h"
 
 static std::mt19937 RNG;
 
+// set by ScopedRandomEngine, nullptr means that the global RNG is used.
+static thread_local std::mt19937* THREAD_RNG = nullptr;
+
+static std::mt19937& engine() { return THREAD_RNG ? *THREAD_RNG : RNG; }
+
 namespace RAYX {
 
-void fixSeed(uint32_t seed) { RNG.seed(seed); }
+void fixSeed(uint32_t seed) { engine().seed(seed); }
 
 void randomSeed() { fixSeed((uint32_t)time(nullptr)); }
 
-uint32_t randomUint() { return RNG(); }
+std::string getRandomState() {
+    std::ostringstream ss;
+    ss << engine();
+    return ss.str();
+}
+
+void setRandomState(const std::string& state) {
+    std::istringstream ss(state);
+    ss >> engine();
+}
+
+ScopedRandomEngine::ScopedRandomEngine(uint32_t seed) : m_engine(std::make_unique<std::mt19937>(seed)), m_previous(THREAD_RNG) {
+    THREAD_RNG = m_engine.get();
+}
+
+ScopedRandomEngine::~ScopedRandomEngine() { THREAD_RNG = m_previous; }
+
+uint32_t randomUint() { return engine()(); }
 
 double randomDouble() { return ((double)randomUint()) / std::mt19937::max(); }
 
@@ -30,22 +53,28 @@ double randomDoubleInRange(double a, double b) {
     return low + randomDouble() * (high - low);
 }
 
+void randomNormalUniforms(double& u1, double& u2) {
+    constexpr double epsilon = std::numeric_limits<double>::epsilon();
+
+    // make sure u1 is greater than epsilon
+    do {
+        u1 = randomDouble();
+    } while (u1 <= epsilon);
+    u2 = randomDouble();
+}
+
 // see https://en.wikipedia.org/wiki/Box%E2%80%93Muller_transform
 // we don't use std::normal_distribution, due to this:
 // https://stackoverflow.com/questions/38532927/why-gcc-and-msvc-stdnormal-distribution-are-different
 // `mu` is the mean, `sigma` is the standard deviation.
 double randomNormal(double mu, double sigma) {
-    constexpr double epsilon = std::numeric_limits<double>::epsilon();
     const double two_pi = 2.0 * PI;
 
-    // create two random numbers, make sure u1 is greater than epsilon
+    // create two random numbers
     double u1, u2;
-    do {
-        u1 = randomDouble();
-    } while (u1 <= epsilon);
-    u2 = randomDouble();
+    randomNormalUniforms(u1, u2);
 
-    // compute z0 and z1
+    // compute z0
     auto mag = sigma * sqrt(-2.0 * log(u1));
     auto z0 = mag * cos(two_pi * u2) + mu;
 
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <memory>
+#include <random>
+#include <string>
+
 #include "Core.h"
 
 // All C++ randomness should be using this module.
@@ -24,6 +29,29 @@ void RAYX_API fixSeed(uint32_t x);
 // sets the seed "randomly", depending on system time.
 void RAYX_API randomSeed();
 
+// returns the full internal RNG state as a string.
+// Together with `setRandomState` this allows to skip over a deterministic sequence of random draws (e.g. when source rays are loaded from a cache),
+// while leaving the RNG in exactly the state it would have had if the draws had actually happened.
+std::string RAYX_API getRandomState();
+
+// restores an RNG state previously obtained by `getRandomState`.
+void RAYX_API setRandomState(const std::string& state);
+
+// Redirects all random draws of the current thread to a private engine seeded with `seed`, for the lifetime of this object.
+// This allows to generate independent streams (e.g. one per light source) concurrently, while each stream stays deterministic.
+// Draws of other threads (including OpenMP workers spawned by this thread) are not affected.
+class RAYX_API ScopedRandomEngine {
+  public:
+    explicit ScopedRandomEngine(uint32_t seed);
+    ~ScopedRandomEngine();
+    ScopedRandomEngine(const ScopedRandomEngine&) = delete;
+    ScopedRandomEngine& operator=(const ScopedRandomEngine&) = delete;
+
+  private:
+    std::unique_ptr<std::mt19937> m_engine;
+    std::mt19937* m_previous;
+};
+
 // samples an integer from the uniform integer distribution over the interval [0, 2^32[
 uint32_t randomUint();
 
@@ -40,4 +68,8 @@ double RAYX_API randomDoubleInRange(double a, double b);
 // `mean` is evidently the mean of the distribution, while `stddev` is the standard deviation (often written as sigma).
 double RAYX_API randomNormal(double mean, double stddev);
 
+// draws the two uniform samples `u1` in ]epsilon, 1] and `u2` in [0, 1], which `randomNormal` consumes for one Box-Muller sample.
+// Transforming them with `boxMuller` (see Beamline/SourceSampling.h) yields exactly `randomNormal`, while allowing to vectorize the transform.
+void RAYX_API randomNormalUniforms(double& u1, double& u2);
+
 }  // namespace RAYX
@@ -2,6 +2,7 @@
 
 #include "Constants.h"
 #include "Rand.h"
+#include "Utils.h"
 
 namespace RAYX {
 
@@ -18,10 +19,9 @@ glm::dvec3 RAYX_API normalCartesian(glm::dvec3 normal, double x_rad, double z_ra
     double FY = normal[1];
     double FZ = normal[2];
 
-    double cosx = glm::cos(x_rad);
-    double sinx = glm::sin(x_rad);
-    double cosz = glm::cos(z_rad);
-    double sinz = glm::sin(z_rad);
+    double sinx, cosx, sinz, cosz;
+    sinCos(x_rad, sinx, cosx);
+    sinCos(z_rad, sinz, cosz);
 
     // put in matrix mult?
     double FY2 = FY * cosz + FZ * sinz;
@@ -43,11 +43,12 @@ RAYX_FN_ACC
 glm::dvec3 RAYX_API normalCylindrical(glm::dvec3 normal, double x_rad, double z_rad) {
     double normFXFY = sqrt(normal[0] * normal[0] + normal[1] * normal[1]);
     double arcTanFXFY = glm::atan(normal[1], normal[0]);
-    double sinz = glm::sin(z_rad);
-    double cosz = glm::cos(z_rad);
+    double sinz, cosz, sinxy, cosxy;
+    sinCos(z_rad, sinz, cosz);
+    sinCos(x_rad + arcTanFXFY, sinxy, cosxy);
 
-    normal[0] = glm::cos(x_rad + arcTanFXFY) * (normFXFY * cosz + normal[2] * sinz);
-    normal[1] = glm::sin(x_rad + arcTanFXFY) * (normFXFY * cosz + normal[2] * sinz);
+    normal[0] = cosxy * (normFXFY * cosz + normal[2] * sinz);
+    normal[1] = sinxy * (normFXFY * cosz + normal[2] * sinz);
     normal[2] = normal[2] * cosz - normFXFY * sinz;
 
     return normal;
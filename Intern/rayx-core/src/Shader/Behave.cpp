@@ -4,6 +4,7 @@
 #include "Diffraction.h"
 #include "Efficiency.h"
 #include "EventType.h"
+#include "FresnelTable.h"
 #include "Helper.h"
 #include "LineDensity.h"
 #include "Rand.h"
@@ -18,7 +19,7 @@ namespace RAYX {
 
 RAYX_FN_ACC
 Ray behaveSlit(Ray r, int id, [[maybe_unused]] Collision col, InvState& inv) {
-    SlitBehaviour b = deserializeSlit(inv.elements[id].m_behaviour);
+    SlitBehaviour b = deserializeSlit(inv.elementRecords[id].m_behaviour);
 
     // slit lies in x-y plane instead of x-z plane as other elements
     Cutout openingCutout = b.m_openingCutout;
@@ -39,15 +40,27 @@ Ray behaveSlit(Ray r, int id, [[maybe_unused]] Collision col, InvState& inv) {
     double dPsi = 0;
     double wavelength = hvlam(r.m_energy);
 
+    // the slit samples from a precomputed table if there is one, see Diffraction.h
+    int table = id < int(inv.diffractionTables.size()) ? int(inv.diffractionTables[id]) : -1;
+
     // this was previously called "diffraction"
     if (wavelength > 0) {
         if (openingCutout.m_type == CTYPE_RECT) {
             RectCutout r = deserializeRect(openingCutout);
-            fraun_diff(r.m_width, wavelength, dPhi, inv);
-            fraun_diff(r.m_length, wavelength, dPsi, inv);
+            if (table >= 0) {
+                fraun_diff_table(r.m_width, wavelength, dPhi, table, inv);
+                fraun_diff_table(r.m_length, wavelength, dPsi, table, inv);
+            } else {
+                fraun_diff(r.m_width, wavelength, dPhi, inv);
+                fraun_diff(r.m_length, wavelength, dPsi, inv);
+            }
         } else if (openingCutout.m_type == CTYPE_ELLIPTICAL) {
             EllipticalCutout e = deserializeElliptical(openingCutout);
-            bessel_diff(e.m_diameter_z, wavelength, dPhi, dPsi, inv);
+            if (table >= 0) {
+                bessel_diff_table(e.m_diameter_z, wavelength, dPhi, dPsi, table, inv);
+            } else {
+                bessel_diff(e.m_diameter_z, wavelength, dPhi, dPsi, inv);
+            }
         } else {
             _throw("encountered Slit with unsupported openingCutout");
         }
@@ -64,7 +77,7 @@ Ray behaveSlit(Ray r, int id, [[maybe_unused]] Collision col, InvState& inv) {
 
 RAYX_FN_ACC
 Ray behaveRZP(Ray r, int id, Collision col, InvState& inv) {
-    RZPBehaviour b = deserializeRZP(inv.elements[id].m_behaviour);
+    RZPBehaviour b = deserializeRZP(inv.elementRecords[id].m_behaviour);
 
     double WL = hvlam(r.m_energy);
     double Ord = b.m_orderOfDiffraction;
@@ -83,7 +96,8 @@ Ray behaveRZP(Ray r, int id, Collision col, InvState& inv) {
     // only 2D case, not 2 1D gratings with 90 degree rotation as in old RAY
     double az = WL * DZ * Ord * 1e-6;
     double ax = WL * DX * Ord * 1e-6;
-    r = refrac2D(r, col.normal, az, ax, inv);
+    const auto& record = inv.elementRecords[id];
+    r = record.m_hasConstantNormal ? refrac2DPlane(r, az, ax, inv) : refrac2D(r, col.normal, az, ax, inv);
 
     r.m_order = Ord;
     return r;
@@ -91,7 +105,7 @@ Ray behaveRZP(Ray r, int id, Collision col, InvState& inv) {
 
 RAYX_FN_ACC
 Ray behaveGrating(Ray r, int id, Collision col, InvState& inv) {
-    GratingBehaviour b = deserializeGrating(inv.elements[id].m_behaviour);
+    GratingBehaviour b = deserializeGrating(inv.elementRecords[id].m_behaviour);
 
     // vls parameters passed in q.elementParams
     double WL = hvlam(r.m_energy);
@@ -104,29 +118,40 @@ Ray behaveGrating(Ray r, int id, Collision col, InvState& inv) {
     // no additional zero order here?
 
     // refraction
-    r = refrac2D(r, col.normal, adjustedLinedensity, 0, inv);
+    const auto& record = inv.elementRecords[id];
+    r = record.m_hasConstantNormal ? refrac2DPlane(r, adjustedLinedensity, 0, inv) : refrac2D(r, col.normal, adjustedLinedensity, 0, inv);
 
     return r;
 }
 
 RAYX_FN_ACC
-Ray behaveMirror(Ray r, int id, Collision col, InvState& inv) {
-    // calculate the new direction after the reflection
-    const auto incident_vec = r.m_direction;
-    const auto reflect_vec = glm::reflect(incident_vec, col.normal);
-    r.m_direction = reflect_vec;
-
-    int mat = int(inv.elements[id].m_material);
+void reflectMirrorField(Ray& r, int id, glm::dvec3 incident_vec, glm::dvec3 normal, InvState& inv) {
+    int mat = inv.elementRecords[id].m_material;
     if (mat != -2) {
-        constexpr int vacuum_material = -1;
-        const auto ior_i = getRefractiveIndex(r.m_energy, vacuum_material, inv);
-        const auto ior_t = getRefractiveIndex(r.m_energy, mat, inv);
+        const auto reflect_vec = r.m_direction;
+        ComplexFresnelCoeffs reflect_amplitude;
+        if (!lookupReflectAmplitude(id, r.m_energy, glm::dot(incident_vec, -normal), inv, reflect_amplitude)) {
+            constexpr int vacuum_material = -1;
+            const auto ior_i = getRefractiveIndex(r.m_energy, vacuum_material, inv);
+            const auto ior_t = getRefractiveIndex(r.m_energy, mat, inv);
+            reflect_amplitude = calcReflectAmplitude(incident_vec, normal, ior_i, ior_t);
+        }
 
-        const auto reflect_field = interceptReflect(r.m_field, incident_vec, reflect_vec, col.normal, ior_i, ior_t);
+        const auto reflect_field = interceptReflect(r.m_field, incident_vec, reflect_vec, normal, reflect_amplitude);
 
         r.m_field = reflect_field;
         r.m_order = 0;
     }
+}
+
+RAYX_FN_ACC
+Ray behaveMirror(Ray r, int id, Collision col, InvState& inv) {
+    // calculate the new direction after the reflection
+    const auto incident_vec = r.m_direction;
+    const auto reflect_vec = glm::reflect(incident_vec, col.normal);
+    r.m_direction = reflect_vec;
+
+    reflectMirrorField(r, id, incident_vec, col.normal, inv);
     return r;
 }
 
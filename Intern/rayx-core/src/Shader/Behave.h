@@ -21,6 +21,9 @@ RAYX_FN_ACC Ray behaveSlit(Ray r, int id, Collision col, InvState& inv);
 RAYX_FN_ACC Ray behaveRZP(Ray r, int id, Collision col, InvState& inv);
 RAYX_FN_ACC Ray behaveGrating(Ray r, int id, Collision col, InvState& inv);
 RAYX_FN_ACC Ray behaveMirror(Ray r, int id, Collision col, InvState& inv);
+// the part of behaveMirror after the reflection of the direction: applies the reflectivity of the mirror `id` to the field of `r`, whose
+// direction is already reflected. Used by the packet tracer, which reflects the directions in SIMD lanes (see RayPacket.h).
+RAYX_FN_ACC void reflectMirrorField(Ray& r, int id, glm::dvec3 incident_vec, glm::dvec3 normal, InvState& inv);
 RAYX_FN_ACC Ray behaveImagePlane(Ray r, int id, Collision col, InvState& inv);
 
 }  // namespace RAYX
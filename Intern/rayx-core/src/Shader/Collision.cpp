@@ -16,346 +16,194 @@ namespace RAYX {
 RAYX_FN_ACC
 Collision getQuadricCollision(Ray r, QuadricSurface q) {
     Collision col;
-    col.found = true;
-    col.hitpoint = glm::dvec3(0, 0, 0);
-    col.normal = glm::dvec3(0, 0, 0);
+    col.found = intersectQuadric(q, r.m_position, r.m_direction, col.hitpoint, col.normal);
+    return col;
+}
 
-    int cs = 1;
-    int d_sign = q.m_icurv;
-    if (glm::abs(r.m_direction[1]) >= glm::abs(r.m_direction[0]) && glm::abs(r.m_direction[1]) >= glm::abs(r.m_direction[2])) {
-        cs = 2;
-    } else if (glm::abs(r.m_direction[2]) >= glm::abs(r.m_direction[0]) && glm::abs(r.m_direction[2]) >= glm::abs(r.m_direction[1])) {
-        cs = 3;
-    }
+/**************************************************************
+ *                    Cubic collision
+ **************************************************************/
+// adds the coefficients of b * u^2 * v along the ray, where u = pu + s * du and v = pv + s * dv, to `c` (c[i] is the coefficient of s^i).
+RAYX_FN_ACC
+inline void addCubicTerm(double b, double pu, double du, double pv, double dv, glm::dvec4& c) {
+    c[0] += b * pu * pu * pv;
+    c[1] += b * (2 * pu * du * pv + pu * pu * dv);
+    c[2] += b * (du * du * pv + 2 * pu * du * dv);
+    c[3] += b * du * du * dv;
+}
 
-    double x = 0;
-    double y = 0;
-    double z = 0;
-    double a = 0;
-    double b = 0;
-    double c = 0;
-
-    if (cs == 1) {
-        double aml = r.m_direction[1] / r.m_direction[0];
-        double anl = r.m_direction[2] / r.m_direction[0];
-        y = r.m_position[1] - aml * r.m_position[0];
-        z = r.m_position[2] - anl * r.m_position[0];
-        d_sign = int(glm::sign(r.m_direction[0]) * q.m_icurv);
-
-        a = q.m_a11 + 2 * q.m_a12 * aml + q.m_a22 * aml * aml + 2 * q.m_a13 * anl + 2 * q.m_a23 * aml * anl + q.m_a33 * anl * anl;
-        b = q.m_a14 + q.m_a24 * aml + q.m_a34 * anl + (q.m_a12 + q.m_a22 * aml + q.m_a23 * anl) * y + (q.m_a13 + q.m_a23 * aml + q.m_a33 * anl) * z;
-        c = q.m_a44 + q.m_a22 * y * y + 2 * q.m_a34 * z + q.m_a33 * z * z + 2 * y * (q.m_a24 + q.m_a23 * z);
-
-        double bbac = b * b - a * c;
-        if (bbac < 0) {
-            col.found = false;
-        } else {
-            if (glm::abs(a) > glm::abs(c) * 1e-10) {
-                x = (-b + d_sign * sqrt(bbac)) / a;
-            } else {
-                x = (-c / 2) / b;
-            }
+RAYX_FN_ACC
+inline double evalCubic(const glm::dvec4& c, double s) { return ((c[3] * s + c[2]) * s + c[1]) * s + c[0]; }
+
+// refines the zero point of the cubic c within [lo, hi], where c(lo) and c(hi) have opposite signs, with Newton's method. Every Newton step
+// which would leave the current bracket is replaced by a bisection step.
+RAYX_FN_ACC
+bool refineCubicRoot(const glm::dvec4& c, double lo, double hi, double tolerance, double& root) {
+    const int MAX_ITERATIONS = 100;
+
+    double sNeg = evalCubic(c, lo) < 0.0 ? lo : hi;
+    double sPos = evalCubic(c, lo) < 0.0 ? hi : lo;
+    double s = glm::clamp(0.0, lo, hi);
+    for (int n = 0; n < MAX_ITERATIONS; n++) {
+        double func = evalCubic(c, s);
+        if (func == 0.0) {
+            root = s;
+            return true;
         }
-        y = y + aml * x;
-        z = z + anl * x;
-    } else if (cs == 2) {
-        double alm = r.m_direction[0] / r.m_direction[1];
-        double anm = r.m_direction[2] / r.m_direction[1];
-        x = r.m_position[0] - alm * r.m_position[1];
-        z = r.m_position[2] - anm * r.m_position[1];
-        d_sign = int(glm::sign(r.m_direction[1]) * q.m_icurv);
-
-        a = q.m_a22 + 2 * q.m_a12 * alm + q.m_a11 * alm * alm + 2 * q.m_a23 * anm + 2 * q.m_a13 * alm * anm + q.m_a33 * anm * anm;
-        b = q.m_a24 + q.m_a14 * alm + q.m_a34 * anm + (q.m_a12 + q.m_a11 * alm + q.m_a13 * anm) * x + (q.m_a23 + q.m_a13 * alm + q.m_a33 * anm) * z;
-        c = q.m_a44 + q.m_a11 * x * x + 2 * q.m_a34 * z + q.m_a33 * z * z + 2 * x * (q.m_a14 + q.m_a13 * z);
-
-        double bbac = b * b - a * c;
-        if (bbac < 0) {
-            col.found = false;
+        if (func < 0.0) {
+            sNeg = s;
         } else {
-            if (glm::abs(a) > glm::abs(c) * 1e-10) {
-                y = (-b + d_sign * sqrt(bbac)) / a;
-            } else {
-                y = (-c / 2) / b;
-            }
+            sPos = s;
         }
-        x = x + alm * y;
-        z = z + anm * y;
 
-    } else {
-        double aln = r.m_direction[0] / r.m_direction[2];
-        double amn = r.m_direction[1] / r.m_direction[2];
-        // firstParam = aln;
-        // secondParam = amn;
-        x = r.m_position[0] - aln * r.m_position[2];
-        y = r.m_position[1] - amn * r.m_position[2];
-        d_sign = int(glm::sign(r.m_direction[2]) * q.m_icurv);
-
-        a = q.m_a33 + 2 * q.m_a13 * aln + q.m_a11 * aln * aln + 2 * q.m_a23 * amn + 2 * q.m_a12 * aln * amn + q.m_a22 * amn * amn;
-        b = q.m_a34 + q.m_a14 * aln + q.m_a24 * amn + (q.m_a13 + q.m_a11 * aln + q.m_a12 * amn) * x + (q.m_a23 + q.m_a12 * aln + q.m_a22 * amn) * y;
-        c = q.m_a44 + q.m_a11 * x * x + 2 * q.m_a24 * y + q.m_a22 * y * y + 2 * x * (q.m_a14 + q.m_a12 * y);
-
-        double bbac = b * b - a * c;
-        if (bbac < 0) {
-            col.found = false;
-        } else {
-            if (glm::abs(a) > glm::abs(c) * 1e-10) {  // pow(10, double(-10))) {
-                z = (-b + d_sign * sqrt(bbac)) / a;
-            } else {
-                z = (-c / 2) / b;
-            }
+        double dfunc = (3 * c[3] * s + 2 * c[2]) * s + c[1];
+        double next = s - func / dfunc;
+        if (dfunc == 0.0 || glm::isnan(next) || glm::isinf(next) || next <= glm::min(sNeg, sPos) || next >= glm::max(sNeg, sPos)) {
+            next = 0.5 * (sNeg + sPos);
+        }
+
+        double ds = next - s;
+        s = next;
+        if (glm::abs(ds) <= tolerance || glm::abs(sPos - sNeg) <= tolerance) {
+            root = s;
+            return true;
         }
-        x = x + aln * z;
-        y = y + amn * z;
-        // r.m_position = glm::dvec3(a, b, c);
     }
+    return false;
+}
 
-    // intersection point is in the negative direction (behind the position when the direction is followed forwards), set weight to 0
-    if ((x - r.m_position.x) / r.m_direction.x < 0 || (y - r.m_position.y) / r.m_direction.y < 0 || (z - r.m_position.z) / r.m_direction.z < 0) {
-        col.found = false;
+// finds the zero point of the cubic c (c[i] is the coefficient of s^i) closest to s = 0. All zero points lie within the Cauchy bound, and the
+// extrema of c split it into at most three intervals on which c is monotone, each containing at most one zero point.
+RAYX_FN_ACC
+bool closestCubicRoot(const glm::dvec4& c, double tolerance, double& root) {
+    int degree = 3;
+    while (degree > 0 && c[degree] == 0.0) {
+        degree--;
+    }
+    if (degree == 0) {
+        root = 0.0;
+        return c[0] == 0.0;
+    }
+
+    double bound = 0.0;
+    for (int i = 0; i < degree; i++) {
+        bound = glm::max(bound, glm::abs(c[i] / c[degree]));
+    }
+    bound += 1.0;
+
+    // the interval borders: the Cauchy bound and the extrema in between, in ascending order.
+    double borders[4];
+    int numBorders = 0;
+    borders[numBorders++] = -bound;
+    if (degree == 3) {
+        // zero points of the derivative 3 c3 s^2 + 2 c2 s + c1 (numerically stable quadratic formula).
+        double a = 3 * c[3];
+        double b = 2 * c[2];
+        double disc = b * b - 4 * a * c[1];
+        if (disc > 0) {
+            double q = -0.5 * (b + (b >= 0 ? 1.0 : -1.0) * sqrt(disc));
+            double e1 = glm::min(q / a, c[1] / q);
+            double e2 = glm::max(q / a, c[1] / q);
+            if (e1 > -bound && e1 < bound) borders[numBorders++] = e1;
+            if (e2 > -bound && e2 < bound) borders[numBorders++] = e2;
+        }
+    } else if (degree == 2) {
+        double e = -c[1] / (2 * c[2]);
+        if (e > -bound && e < bound) borders[numBorders++] = e;
     }
+    borders[numBorders++] = bound;
+
+    bool found = false;
+    for (int i = 0; i + 1 < numBorders; i++) {
+        double lo = borders[i];
+        double hi = borders[i + 1];
+        // skip intervals which can't contain a zero point closer to 0 than the one we already have.
+        double distance = (lo <= 0.0 && hi >= 0.0) ? 0.0 : glm::min(glm::abs(lo), glm::abs(hi));
+        if (found && distance >= glm::abs(root)) {
+            continue;
+        }
 
-    col.hitpoint = glm::dvec3(x, y, z);
+        double fLo = evalCubic(c, lo);
+        double fHi = evalCubic(c, hi);
+        double s;
+        bool hasRoot = true;
+        if (fLo == 0.0) {
+            s = lo;
+        } else if (fHi == 0.0) {
+            s = hi;
+        } else if ((fLo < 0.0) != (fHi < 0.0)) {
+            hasRoot = refineCubicRoot(c, lo, hi, tolerance, s);
+        } else {
+            hasRoot = false;
+        }
 
-    double fx = 2 * q.m_a14 + 2 * q.m_a11 * x + 2 * q.m_a12 * y + 2 * q.m_a13 * z;
-    double fy = 2 * q.m_a24 + 2 * q.m_a12 * x + 2 * q.m_a22 * y + 2 * q.m_a23 * z;
-    double fz = 2 * q.m_a34 + 2 * q.m_a13 * x + 2 * q.m_a23 * y + 2 * q.m_a33 * z;
-    col.normal = normalize(glm::dvec3(fx, fy, fz));
-    return col;
+        if (hasRoot && (!found || glm::abs(s) < glm::abs(root))) {
+            root = s;
+            found = true;
+        }
+    }
+    return found;
 }
 
-/**************************************************************
- *                    Cubic collision
- **************************************************************/
 /**
- * taken from RAY-UI Nov. 2023:
- *  new version of Th. Zeschke by Oct. 18, 2007
- *  corresponding exe-version is called ray_thomas1.exe (on VAX only)
+ * calculates the intersection of the ray with a surface of 3. order
+ *  F(x, y, z) = a11 x^2 + 2 a12 xy + 2 a13 xz + 2 a14 x + a22 y^2 + 2 a23 yz + 2 a24 y + a33 z^2 + 2 a34 z + a44
+ *             + b12 x^2 y + b13 x^2 z + b21 y^2 x + b23 y^2 z + b31 z^2 x + b32 z^2 y = 0
+ * (this is the surface of the RAY-UI implementation by Th. Zeschke, Oct. 18, 2007).
  *
- *  calculates intersection of a straight line
- *  equation straight line:
- *  (x-x1)/al = (y-y1)/am = (z-z1)/an
- *  with a surface of 3. order
- *
- *  method: the iterative Newtonmethod is used for zero point search
+ *  method: along the ray p + t * d, F is a cubic polynomial in t. Its coefficients are computed once, and the zero point closest to where
+ *  the ray crosses the plane of its dominant direction component (the starting point of RAY-UI) is searched with a safeguarded Newton
+ *  iteration, evaluating the polynomial and its derivative with Horner's scheme (see closestCubicRoot).
  *  result is X,Y,Z of intersection
  * Ray in in element koordinates.
  */
 RAYX_FN_ACC
 Collision getCubicCollision(Ray r, CubicSurface cu) {
+    const double CUBIC_TOLERANCE = 1e-11;
+
     Collision col;
-    col.found = true;
+    col.found = false;
     col.hitpoint = glm::dvec3(0, 0, 0);
     col.normal = glm::dvec3(0, 0, 0);
 
-    // Ray r = rotateForCubic(rin, cu.m_psi, 1000);
+    glm::dvec3 pos = cubicPosition(r, cu.m_psi);
+    glm::dvec3 dir = cubicDirection(r, cu.m_psi);
 
-    int cs = 1;
-    if (glm::abs(r.m_direction[1]) >= glm::abs(r.m_direction[0]) && glm::abs(r.m_direction[1]) >= glm::abs(r.m_direction[2])) {
+    // the dominant direction component.
+    int cs = 0;
+    if (glm::abs(dir[1]) >= glm::abs(dir[0]) && glm::abs(dir[1]) >= glm::abs(dir[2])) {
+        cs = 1;
+    } else if (glm::abs(dir[2]) >= glm::abs(dir[0]) && glm::abs(dir[2]) >= glm::abs(dir[1])) {
         cs = 2;
-    } else if (glm::abs(r.m_direction[2]) >= glm::abs(r.m_direction[0]) && glm::abs(r.m_direction[2]) >= glm::abs(r.m_direction[1])) {
-        cs = 3;
     }
 
-    glm::dvec3 pos = cubicPosition(r, cu.m_psi);
-    double x = pos.x;
-    double y = pos.y;
-    double z = pos.z;
-    double x1 = 0;
-    double xx = 0;
-    double y1 = 0;
-    double yy = 0;
-    double z1 = 0;
-    double zz = 0;
-    double counter = 0;
-    double dx = 0;
-
-    glm::dvec3 dir = cubicDirection(r, cu.m_psi);
-    double al = dir.x;
-    double am = dir.y;
-    double an = dir.z;
-
-    if (cs == 1) {
-        double aml = am / al;
-        double anl = an / al;
-
-        do {
-            x1 = xx;
-            y1 = y - aml * (x - xx);
-            z1 = z - anl * (x - xx);
-
-            double func = (2 * ((x1 - xx) * an - al * z1) * cu.m_a23 - (2 * cu.m_a24 + cu.m_b12 * pow(float(xx), 2.0)) * al +
-                           ((x1 - xx) * am - al * y1) * (cu.m_a22 + cu.m_b21 * xx)) *
-                          ((x1 - xx) * am - al * y1);
-            func = func + pow(float(((x1 - xx) * an - al * z1)), 2.0) * cu.m_a33;
-            func = func - ((x1 - xx) * an - al * z1) * (2 * cu.m_a34 + cu.m_b13 * pow(float(xx), 2.0) * al + cu.m_a44 * pow(float(al), 2.0));
-            func = (func -
-                    (2 * ((x1 - xx) * an - al * z1) * cu.m_a13 - (cu.m_a11 * xx + 2 * cu.m_a14) * al + 2 * ((x1 - xx) * am - al * y1) * cu.m_a12) *
-                        al * xx) *
-                   al;
-            func = (func - (pow(float(((x1 - xx) * am - al * y1)), 2.0) * cu.m_b23 +
-                            ((x1 - xx) * am - al * y1) * ((x1 - xx) * an - al * z1) * cu.m_b32 - ((x1 - xx) * an - al * z1) * al * cu.m_b31 * xx) *
-                               ((x1 - xx) * an - al * z1) / pow(float(al), 3));
-
-            double dfunc = (2 * ((x1 - xx) * an - al * z1) * cu.m_a23 - (2 * cu.m_a24 + cu.m_b12 * pow(float(xx), 2)) * al +
-                            ((x1 - xx) * am - al * y1) * (cu.m_a22 + cu.m_b21 * xx)) *
-                           am;
-            dfunc = dfunc - (2 * (cu.m_a12 * am + cu.m_a13 * an) + cu.m_a11 * al) * al * xx;
-            dfunc =
-                dfunc + (2 * ((x1 - xx) * an - al * z1) * cu.m_a13 - (cu.m_a11 * xx + 2 * cu.m_a14) * al + 2 * ((x1 - xx) * am - al * y1) * cu.m_a12);
-            dfunc =
-                dfunc * al + ((cu.m_a22 + cu.m_b21 * xx) * am + 2 * (cu.m_a23 * an + al * cu.m_b12 * xx) - ((x1 - xx) * am - al * y1) * cu.m_b21) *
-                                 ((x1 - xx) * am - al * y1);
-            dfunc = (dfunc + 2 * ((x1 - xx) * an - al * z1) * (cu.m_a33 * an + al * cu.m_b13 * xx) -
-                     (2 * cu.m_a34 + cu.m_b13 * pow(float(xx), 2)) * al * an) *
-                    al;
-            dfunc = (dfunc - ((((x1 - xx) * an - al * z1) * (al * cu.m_b31 + am * cu.m_b32) - al * an * cu.m_b31 * xx +
-                               ((x1 - xx) * am - al * y1) * (2 * am * cu.m_b23 + an * cu.m_b32)) *
-                                  ((x1 - xx) * an - al * z1) +
-                              (pow(float(((x1 - xx) * am - al * y1)), 2) * cu.m_b23 +
-                               ((x1 - xx) * am - al * y1) * ((x1 - xx) * an - al * z1) * cu.m_b32 - ((x1 - xx) * an - al * z1) * al * cu.m_b31 * xx) *
-                                  an));
-            dfunc = dfunc / pow(float(al), 3);
-
-            if (glm::abs(dfunc) < 0.001) {
-                dfunc = 0.001;
-            }
-
-            dx = func / dfunc;
-            xx = xx - dx;
-
-            x = x1;
-            y = y1;
-            z = z1;
-
-            if (counter > 1000) {
-                x = -2 * y1 / 2 / aml;
-                y = y1 + aml * x;
-                z = z1 + anl * x;
-            }
-            counter++;
-        } while (glm::abs(dx) > 0.001);
-
-    } else if (cs == 2) {
-        double alm = al / am;
-        double anm = an / am;
-
-        do {
-            x1 = x - alm * (y - yy);
-            y1 = yy;
-            z1 = z - anm * (y - yy);
-
-            double func = (2 * (((y1 - yy) * an - am * z1) * cu.m_a13 - (cu.m_a12 * yy + cu.m_a14) * am) +
-                           ((y1 - yy) * al - am * x1) * (cu.m_a11 + cu.m_b12 * yy)) *
-                          ((y1 - yy) * al - am * x1);
-            func = func + (((y1 - yy) * an - am * z1) * cu.m_a33 - 2 * (cu.m_a23 * yy + cu.m_a34) * am) * ((y1 - yy) * an - am * z1) +
-                   (2 * cu.m_a24 * yy + cu.m_a44 + cu.m_a22 * pow(float(yy), 2) * pow(float(am), 2));
-            func = func * am +
-                   ((((y1 - yy) * an - am * z1) * cu.m_b32 - am * cu.m_b23 * yy) * am * yy - pow(float((y1 - yy) * al - am * x1), 2) * cu.m_b13) *
-                       ((y1 - yy) * an - am * z1);
-            func = func - (pow(float(((y1 - yy) * an - am * z1)), 2) * cu.m_b31 + pow(float(am), 2) * cu.m_b21 * pow(float(yy), 2)) *
-                              ((y1 - yy) * al - am * x1);
-            func = func / pow(float(am), 3);
-
-            double dfunc = (pow(float((y1 - yy) * an - am * z1), 2) * cu.m_b31 + pow(float(am), 2) * cu.m_b21 * pow(float(yy), 2) * al +
-                            2 * (((y1 - yy) * an - am * z1) * an * cu.m_b31 - pow(float(am), 2)) * cu.m_b21 * yy) *
-                           ((y1 - yy) * al - am * x1);
-            dfunc =
-                dfunc -
-                ((((y1 - yy) * an - am * z1) * cu.m_b32 - am * cu.m_b23 * yy) * am * yy - pow(float((y1 - yy) * al - am * x1), 2) * cu.m_b13) * an;
-            dfunc = dfunc + (2 * ((y1 - yy) * al - am * x1) * al * cu.m_b13 - (am * cu.m_b23 + an * cu.m_b32) * am * yy +
-                             (((y1 - yy) * an - am * z1) * cu.m_b32 - am * cu.m_b23 * yy) * am) *
-                                ((y1 - yy) * an - am * z1);
-            dfunc = dfunc - (((cu.m_a11 + cu.m_b12 * yy) * al + 2 * (cu.m_a12 * am + cu.m_a13 * an) - ((y1 - yy) * al - am * x1) * cu.m_b12) *
-                                 ((y1 - yy) * al - am * x1) -
-                             2 * (cu.m_a22 * pow(float(am), 2) * yy + cu.m_a23 * pow(float(am), 2) * z1 - cu.m_a23 * am * an * y1 +
-                                  2 * cu.m_a23 * am * an * yy + cu.m_a24 * pow(float(am), 2) + cu.m_a33 * am * an * z1 -
-                                  cu.m_a33 * pow(float(an), 2) * y1 + cu.m_a33 * pow(float(an), 2) * yy + cu.m_a34 * am * an) +
-                             (2 * (((y1 - yy) * an - am * z1) * cu.m_a13 - (cu.m_a12 * yy + cu.m_a14) * am) +
-                              ((y1 - yy) * al - am * x1) * (cu.m_a11 + cu.m_b12 * yy)) *
-                                 al) *
-                                am;
-            dfunc = dfunc / pow(float(am), 3);
-
-            if (glm::abs(dfunc) < 0.001) {
-                dfunc = 0.001;
-            }
-
-            dx = func / dfunc;
-            yy = yy - dx;
-
-            x = x1;
-            y = y1;
-            z = z1;
-
-            if (counter > 1000) {
-                x = x1;
-                y = 0;
-                z = z1;
-            }
-            counter++;
-        } while (glm::abs(dx) > 0.001);
-    } else {
-        double aln = al / an;
-        double amn = am / an;
-
-        do {
-            x1 = x - aln * (z - zz);
-            y1 = y - amn * (z - zz);
-            z1 = zz;
-
-            double func = ((2 * (((z1 - zz) * am - an * y1) * cu.m_a12 - (cu.m_a13 * zz + cu.m_a14) * an) + ((z1 - zz) * al - an * x1) * cu.m_a11) *
-                               ((z1 - zz) * al - an * x1) +
-                           (((z1 - zz) * am - an * y1) * cu.m_a22 - 2 * (cu.m_a23 * zz + cu.m_a24) * an) * ((z1 - zz) * am - an * y1) +
-                           (2 * cu.m_a34 * zz + cu.m_a44 + cu.m_a33 * pow(float(zz), 2)) * pow(float(an), 2)) *
-                          an;
-            func = func - ((((z1 - zz) * am - an * y1) * cu.m_b12 - an * cu.m_b13 * zz) * pow(float(((z1 - zz) * al - an * x1)), 2) -
-                           (((z1 - zz) * am - an * y1) * cu.m_b23 - an * cu.m_b32 * zz) * ((z1 - zz) * am - an * y1) * an * zz +
-                           (pow(float(((z1 - zz) * am - an * y1)), 2) * cu.m_b21 + pow(float(an), 2) * cu.m_b31 * pow(float(zz), 2)) *
-                               ((z1 - zz) * al - an * x1));
-            func = func / pow(float(an), 3);
-
-            double dfunc = (((z1 - zz) * am - an * y1) * cu.m_a22 - 2 * (cu.m_a23 * zz + cu.m_a24) * an) * am +
-                           (2 * (cu.m_a12 * am + cu.m_a13 * an) + cu.m_a11 * al) * ((z1 - zz) * al - an * x1);
-            dfunc = dfunc + ((z1 - zz) * am - an * y1) * (cu.m_a22 * am + 2 * cu.m_a23 * an) - 2 * (cu.m_a33 * zz + cu.m_a34) * pow(float(an), 2);
-            dfunc = (dfunc +
-                     (2 * (((z1 - zz) * am - an * y1) * cu.m_a12 - (cu.m_a13 * zz + cu.m_a14) * an) + ((z1 - zz) * al - an * x1) * cu.m_a11) * al) *
-                    an;
-            dfunc = dfunc - (2 *
-                                 (((z1 - zz) * am - an * y1) * am * cu.m_b21 - pow(float(an), 2) * cu.m_b31 * zz +
-                                  (((z1 - zz) * am - an * y1) * cu.m_b12 - an * cu.m_b13 * zz) * al) *
-                                 ((z1 - zz) * al - an * x1) +
-                             (pow(float(((z1 - zz) * am - an * y1)), 2) * cu.m_b21 + pow(float(an), 2) * cu.m_b31 * pow(float(zz), 2)) * al +
-                             pow(float(((z1 - zz) * al - an * x1)), 2) * (am * cu.m_b12 + an * cu.m_b13) -
-                             ((z1 - zz) * am - an * y1) * (am * cu.m_b23 + an * cu.m_b32) * an * zz +
-                             (((z1 - zz) * am - an * y1) * cu.m_b23 - an * cu.m_b32 * zz) * (am * z1 - 2 * am * zz - an * y1) * an);
-            dfunc = (-dfunc) / pow(float(an), 3);
-
-            if (glm::abs(dfunc) < 0.001) {
-                dfunc = 0.001;
-            }
-
-            dx = func / dfunc;
-            zz = zz - dx;
-
-            x = x1;
-            y = y1;
-            z = z1;
-
-            if (counter > 1000) {
-                x = x1 + aln * z;
-                y = y1 + amn * z;
-                z = -2 * y1 / 2 / amn;
-            }
-            counter++;
-        } while (glm::abs(dx) > 0.001);
-        // r.m_position = glm::dvec3(a, b, c);
+    // the polynomial is expanded around the starting point o, so that the parameter s stays small.
+    const glm::dvec3 o = pos - pos[cs] / dir[cs] * dir;
+    const glm::dmat3 quad(cu.m_a11, cu.m_a12, cu.m_a13, cu.m_a12, cu.m_a22, cu.m_a23, cu.m_a13, cu.m_a23, cu.m_a33);
+    const glm::dvec3 lin(cu.m_a14, cu.m_a24, cu.m_a34);
+
+    // c[i] is the coefficient of s^i of F(o + s * dir).
+    glm::dvec4 c;
+    c[0] = dot(o, quad * o) + 2 * dot(lin, o) + cu.m_a44;
+    c[1] = 2 * (dot(dir, quad * o) + dot(lin, dir));
+    c[2] = dot(dir, quad * dir);
+    c[3] = 0.0;
+    addCubicTerm(cu.m_b12, o.x, dir.x, o.y, dir.y, c);
+    addCubicTerm(cu.m_b13, o.x, dir.x, o.z, dir.z, c);
+    addCubicTerm(cu.m_b21, o.y, dir.y, o.x, dir.x, c);
+    addCubicTerm(cu.m_b23, o.y, dir.y, o.z, dir.z, c);
+    addCubicTerm(cu.m_b31, o.z, dir.z, o.x, dir.x, c);
+    addCubicTerm(cu.m_b32, o.z, dir.z, o.y, dir.y, c);
+
+    double s;
+    if (!closestCubicRoot(c, CUBIC_TOLERANCE, s)) {
+        return col;
     }
+    col.found = true;
 
-    // intersection point is in the negative direction (behind the position when the direction is followed forwards), set weight to 0
-    // if ((x - r.m_position.x) / r.m_direction.x < 0 || (y - r.m_position.y) / r.m_direction.y < 0 || (z - r.m_position.z) / r.m_direction.z < 0) {
-    //    col.found = false;
-    //}
+    double x = o.x + s * dir.x;
+    double y = o.y + s * dir.y;
+    double z = o.z + s * dir.z;
 
     double fx = 2 * cu.m_a14 + 2 * cu.m_a11 * x + 2 * cu.m_a12 * y + 2 * cu.m_a13 * z;
     double fy = 2 * cu.m_a24 + 2 * cu.m_a12 * x + 2 * cu.m_a22 * y + 2 * cu.m_a23 * z;
@@ -369,74 +217,139 @@ Collision getCubicCollision(Ray r, CubicSurface cu) {
 /**************************************************************
  *                    Toroid Collision
  **************************************************************/
-// this uses newton to approximate a solution.
+// Evaluates the toroid function f(p) = (y - R)^2 + z^2 - rx(x)^2, where rx(x) = R - rho + sign(rho) * sqrt(rho^2 - x^2) is the distance of the
+// surface from the axis of revolution (the line y = R, z = 0). R is the long radius and rho the signed short radius.
+// f is negative between the surface and the axis. `grad` is set to the gradient of f at `p`.
+RAYX_FN_ACC
+double toroidFunction(glm::dvec3 p, double longRad, double shortRad, glm::dvec3& grad) {
+    double isigro = glm::sign(shortRad);
+
+    // outside of the tube (|x| > |rho|) the toroid is undefined, we clamp x just like the RAY-UI implementation does.
+    double xx = p.x;
+    if (xx * xx > shortRad * shortRad) {
+        xx = glm::sign(xx) * 0.95 * glm::abs(shortRad);
+    }
+    double sq = sqrt(shortRad * shortRad - xx * xx);
+    double rx = longRad - shortRad + isigro * sq;
+    double dy = p.y - longRad;
+
+    grad = glm::dvec3(2 * xx * isigro / sq * rx, 2 * dy, 2 * p.z);
+    return dy * dy + p.z * p.z - rx * rx;
+}
+
+// Intersects the ray with the toroid in two steps:
+// 1. The ray is intersected with the osculating paraboloid y = z^2 / (2R) + x^2 / (2rho) at the vertex of the toroid (closed form). For the
+//    shallow toroids used in beamlines, the intersection closer to the vertex is already very close to the actual hitpoint.
+// 2. Starting from there, the ray parameter is refined with a safeguarded Newton iteration on f(pos + t * dir). Once two iterates enclose the
+//    root, every Newton step which would leave that bracket is replaced by a bisection step. Hence the iteration converges deterministically,
+//    usually within 2-3 iterations, down to TOROID_TOLERANCE (instead of the 1e-4 tolerance of the previous z-based Newton started at z = 0).
 RAYX_FN_ACC
 Collision getToroidCollision(Ray r, ToroidSurface toroid, bool isTriangul) {
     // Constants
-    const double NEW_TOLERANCE = 0.0001;
-    const int NEW_MAX_ITERATIONS = 50;
+    const double TOROID_TOLERANCE = 1e-11;
+    const int TOROID_MAX_ITERATIONS = 50;
 
     double longRad = toroid.m_longRadius;
     double shortRad = (toroid.m_toroidType == TOROID_TYPE_CONVEX) ? -toroid.m_shortRadius : toroid.m_shortRadius;
 
     Collision col;
-    col.found = true;
+    col.found = false;
     col.hitpoint = glm::dvec3(0, 0, 0);
     col.normal = glm::dvec3(0, 0, 0);
 
-    // sign radius: +1 = concave, -1 = convex
-    double isigro = glm::sign(shortRad);
+    const glm::dvec3 pos = r.m_position;
+    const glm::dvec3 dir = r.m_direction;
+
+    // seed: roots of a * t^2 + b * t + c = 0, the intersection with the osculating paraboloid.
+    double a = dir.z * dir.z / (2 * longRad) + dir.x * dir.x / (2 * shortRad);
+    double b = pos.z * dir.z / longRad + pos.x * dir.x / shortRad - dir.y;
+    double c = pos.z * pos.z / (2 * longRad) + pos.x * pos.x / (2 * shortRad) - pos.y;
+    double disc = b * b - 4 * a * c;
+
+    double t;
+    if (disc >= 0 && (a != 0 || b != 0)) {
+        // numerically stable form of the quadratic formula, which also handles a = 0.
+        double q = -0.5 * (b + (b >= 0 ? 1.0 : -1.0) * sqrt(disc));
+        double t1 = (a != 0) ? q / a : c / q;
+        double t2 = (q != 0) ? c / q : t1;
+        double tMin = glm::min(t1, t2);
+        double tMax = glm::max(t1, t2);
+        if (isTriangul) {
+            t = glm::abs(t1) < glm::abs(t2) ? t1 : t2;
+        } else if (tMin > 0) {
+            // both intersections lie in front of the ray. Steep rays from far upstream may hit the paraboloid far from the vertex first, and
+            // the iteration would converge to the far side of the (closed) toroid from there. Like RAY-UI, which starts its iteration at the
+            // vertex, we take the intersection closer to the vertex.
+            glm::dvec3 p1 = pos + t1 * dir;
+            glm::dvec3 p2 = pos + t2 * dir;
+            t = (p1.x * p1.x + p1.z * p1.z <= p2.x * p2.x + p2.z * p2.z) ? t1 : t2;
+        } else {
+            t = tMax;
+        }
+    } else if (dir.y != 0) {
+        // the ray misses the paraboloid, fall back to the tangent plane y = 0.
+        t = -pos.y / dir.y;
+    } else {
+        return col;
+    }
 
-    // double aln = r.m_direction.x / r.m_direction.z;
-    // double amn = r.m_direction.y / r.m_direction.z;
-
-    glm::dvec4 normal = glm::dvec4(0, 0, 0, 0);
-    double xx = 0.0;
-    double zz = 0.0;
-    double yy = 0.0;
-    double dz = 0.0;
-    glm::dvec3 normalized_dir = glm::dvec3(r.m_direction) / r.m_direction.z;
-
-    int n = 0;
-    // Newton's method iteration
-    // While not converged...
-    do {
-        zz = zz + dz;
-        xx = r.m_position.x + normalized_dir.x * (zz - r.m_position.z);
-        if (xx * xx > shortRad * shortRad) {
-            xx = xx / glm::abs(xx) * 0.95 * shortRad;
+    // Newton iteration for s, where the ray is re-based at the seed o, so that s stays small and doesn't suffer from cancellation.
+    const glm::dvec3 o = pos + t * dir;
+    double s = 0.0;
+    double sNeg = 0.0;
+    double sPos = 0.0;
+    bool hasNeg = false;
+    bool hasPos = false;
+    bool converged = false;
+    glm::dvec3 grad;
+
+    for (int n = 0; n < TOROID_MAX_ITERATIONS; n++) {
+        double func = toroidFunction(o + s * dir, longRad, shortRad, grad);
+        if (func == 0.0) {
+            converged = true;
+            break;
         }
-        yy = r.m_position.y + normalized_dir.y * (zz - r.m_position.z);
-        double sq = sqrt(shortRad * shortRad - xx * xx);
-        double rx = (longRad - shortRad + isigro * sq);
-
-        // Calculate toroid normal
-        normal.x = (-2 * xx * isigro / sq) * rx;
-        normal.y = -2 * (yy - longRad);
-        normal.z = -2 * zz;
-
-        double func = -rx * rx + (yy - longRad) * (yy - longRad) + zz * zz;
-        double df = normalized_dir.x * normal.x + normalized_dir.y * normal.y + normal.z;  // dot(normalized_dir, glm::dvec3(normal));
-        dz = func / df;
-        n += 1;
-        if (n >= NEW_MAX_ITERATIONS) {
-            col.found = false;
-            return col;
+        if (func < 0.0) {
+            hasNeg = true;
+            sNeg = s;
+        } else {
+            hasPos = true;
+            sPos = s;
+        }
+        bool bracketed = hasNeg && hasPos;
+
+        double df = dot(grad, dir);
+        double next = s - func / df;
+        bool newtonValid = df != 0.0 && !glm::isnan(next) && !glm::isinf(next);
+        if (bracketed && (!newtonValid || next <= glm::min(sNeg, sPos) || next >= glm::max(sNeg, sPos))) {
+            next = 0.5 * (sNeg + sPos);
+        } else if (!newtonValid) {
+            break;
+        }
+
+        double ds = next - s;
+        s = next;
+        if (glm::abs(ds) <= TOROID_TOLERANCE || (bracketed && glm::abs(sPos - sNeg) <= TOROID_TOLERANCE)) {
+            converged = true;
+            break;
         }
-    } while (glm::abs(dz) > NEW_TOLERANCE);
+    }
+
+    if (!converged) {
+        return col;
+    }
 
-    col.normal = normalize(glm::dvec3(normal));
-    col.hitpoint = glm::dvec3(xx, yy, zz);
+    col.hitpoint = o + s * dir;
+    toroidFunction(col.hitpoint, longRad, shortRad, grad);
+    col.normal = normalize(-grad);
+    col.found = true;
 
     if (isTriangul) {  // TODO : Hack, Triangulation sensetive to direction apparently. Actual fix or func rework is needed!
         return col;
     }
 
+    // if ray points away from the hitpoint, no collision can be found.
     glm::dvec3 rayToHitpoint = col.hitpoint - r.m_position;
-    // edit: if ray points away from the hitpoint, no collision can be found.
-    // Note that multiplying the rays direction with -1 SHOULD totally have an effect on the collision detection - in most cases this 180° rotation
-    // will make the ray point away from the toroid, and hence preventing a Collision completely. The above code however, is unaffected when
-    // multiplying the ray direction with -1. Due to it having no effect on `glm::dvec3 normalized_dir = glm::dvec3(r.m_direction) / r.m_direction.z;`
     col.found = dot(rayToHitpoint, r.m_direction) > 0.0;
 
     return col;
@@ -448,8 +361,18 @@ Collision getToroidCollision(Ray r, ToroidSurface toroid, bool isTriangul) {
 
 RAYX_FN_ACC
 Collision RAYX_API findCollisionInElementCoords(Ray r, Surface surface, Cutout cutout, bool isTriangul) {
+    // without a bounding box, only the exact cutout test applies.
+    DecodedCutout decodedCutout;
+    decodedCutout.m_cutout = cutout;
+    decodedCutout.m_min = glm::dvec2(-infinity());
+    decodedCutout.m_max = glm::dvec2(infinity());
+    return findCollisionInElementCoords(r, decodeSurface(surface), decodedCutout, isTriangul);
+}
+
+RAYX_FN_ACC
+Collision RAYX_API findCollisionInElementCoords(Ray r, const DecodedSurface& surface, const DecodedCutout& cutout, bool isTriangul) {
     // RAYX_PROFILE_FUNCTION_STDOUT();
-    double sty = surface.m_type;
+    int sty = surface.m_type;
 
     Collision col;
     if (sty == STYPE_PLANE_XZ) {
@@ -469,11 +392,11 @@ Collision RAYX_API findCollisionInElementCoords(Ray r, Surface surface, Cutout c
         // = false`.
         col.found = time >= 0;
     } else if (sty == STYPE_TOROID) {
-        col = getToroidCollision(r, deserializeToroid(surface), isTriangul);
+        col = getToroidCollision(r, surface.m_toroid, isTriangul);
     } else if (sty == STYPE_QUADRIC) {
-        col = getQuadricCollision(r, deserializeQuadric(surface));
+        col = getQuadricCollision(r, surface.m_quadric);
     } else if (sty == STYPE_CUBIC) {
-        col = getCubicCollision(r, deserializeCubic(surface));
+        col = getCubicCollision(r, surface.m_cubic);
     } else {
         col.found = false;
 
@@ -481,8 +404,10 @@ Collision RAYX_API findCollisionInElementCoords(Ray r, Surface surface, Cutout c
         return col;  // has found = false
     }
 
-    // cutout is applied in the XZ plane.
-    if (!inCutout(cutout, col.hitpoint.x, col.hitpoint.z)) {
+    // cutout is applied in the XZ plane. The bounding box rejects most misses before the exact test.
+    double x = col.hitpoint.x;
+    double z = col.hitpoint.z;
+    if (x < cutout.m_min.x || x > cutout.m_max.x || z < cutout.m_min.y || z > cutout.m_max.y || !inCutout(cutout.m_cutout, x, z)) {
         col.found = false;
     }
 
@@ -500,14 +425,16 @@ Collision RAYX_API findCollisionInElementCoords(Ray r, Surface surface, Cutout c
 // and returns a Collision accordingly.
 RAYX_FN_ACC
 Collision findCollisionWith(Ray r, uint32_t id, InvState& inv) {
+    const ElementRecord& element = inv.elementRecords[id];
+
     // misalignment
-    r = rayMatrixMult(r, inv.elements[id].m_inTrans);  // image plane is the x-y plane of the coordinate system
-    Collision col = findCollisionInElementCoords(r, inv.elements[id].m_surface, inv.elements[id].m_cutout, false);
+    r = rayMatrixMult(r, element.m_inTrans);  // image plane is the x-y plane of the coordinate system
+    Collision col = findCollisionInElementCoords(r, element.m_surface, element.m_cutout, false);
     if (col.found) {
         col.elementIndex = int(id);
     }
 
-    SlopeError sE = inv.elements[id].m_slopeError;
+    SlopeError sE = element.m_slopeError;
     col.normal = applySlopeError(col.normal, sE, 0, inv);
 
     return col;
@@ -518,7 +445,7 @@ RAYX_FN_ACC
 Collision findCollision(const Ray& ray, InvState& inv) {
     // If sequential tracing is enabled, we only check collision with the "next element".
     if (inv.pushConstants.sequential == 1.0) {
-        if (ray.m_lastElement >= inv.elements.size() - 1) {
+        if (ray.m_lastElement >= inv.elementRecords.size() - 1) {
             Collision col;
             col.found = false;
             return col;
@@ -540,13 +467,13 @@ Collision findCollision(const Ray& ray, InvState& inv) {
     r.m_position += r.m_direction * COLLISION_EPSILON;
 
     // Find intersection points through all elements
-    for (uint32_t elementIndex = 0; elementIndex < uint32_t(inv.elements.size()); elementIndex++) {
+    for (uint32_t elementIndex = 0; elementIndex < uint32_t(inv.elementRecords.size()); elementIndex++) {
         Collision current_col = findCollisionWith(r, elementIndex, inv);
         if (!current_col.found) {
             continue;
         }
 
-        glm::dvec3 global_hitpoint = glm::dvec3(inv.elements[elementIndex].m_outTrans * glm::dvec4(current_col.hitpoint, 1));
+        glm::dvec3 global_hitpoint = inv.elementRecords[elementIndex].m_outTrans * glm::dvec4(current_col.hitpoint, 1);
         double current_dist = glm::length(global_hitpoint - ray.m_position);
 
         if (current_dist < best_dist) {
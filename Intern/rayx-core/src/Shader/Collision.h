@@ -4,6 +4,7 @@
 
 #include "Core.h"
 #include "Element/Cutout.h"
+#include "Element/ElementRecord.h"
 #include "InvocationState.h"
 #include "Ray.h"
 
@@ -26,9 +27,122 @@ struct RAYX_API Collision {
     bool found;
 };
 
+// intersects the ray (position, direction) with the quadric `q`, and returns whether the hitpoint lies in front of the ray.
+// Defined inline, as RayPacket.cpp computes it in SIMD lanes.
+RAYX_FN_ACC
+inline bool intersectQuadric(const QuadricSurface& q, glm::dvec3 position, glm::dvec3 direction, glm::dvec3& hitpoint, glm::dvec3& normal) {
+    bool found = true;
+
+    int cs = 1;
+    int d_sign = q.m_icurv;
+    if (glm::abs(direction[1]) >= glm::abs(direction[0]) && glm::abs(direction[1]) >= glm::abs(direction[2])) {
+        cs = 2;
+    } else if (glm::abs(direction[2]) >= glm::abs(direction[0]) && glm::abs(direction[2]) >= glm::abs(direction[1])) {
+        cs = 3;
+    }
+
+    double x = 0;
+    double y = 0;
+    double z = 0;
+    double a = 0;
+    double b = 0;
+    double c = 0;
+
+    if (cs == 1) {
+        double aml = direction[1] / direction[0];
+        double anl = direction[2] / direction[0];
+        y = position[1] - aml * position[0];
+        z = position[2] - anl * position[0];
+        d_sign = int(glm::sign(direction[0]) * q.m_icurv);
+
+        a = q.m_a11 + 2 * q.m_a12 * aml + q.m_a22 * aml * aml + 2 * q.m_a13 * anl + 2 * q.m_a23 * aml * anl + q.m_a33 * anl * anl;
+        b = q.m_a14 + q.m_a24 * aml + q.m_a34 * anl + (q.m_a12 + q.m_a22 * aml + q.m_a23 * anl) * y + (q.m_a13 + q.m_a23 * aml + q.m_a33 * anl) * z;
+        c = q.m_a44 + q.m_a22 * y * y + 2 * q.m_a34 * z + q.m_a33 * z * z + 2 * y * (q.m_a24 + q.m_a23 * z);
+
+        double bbac = b * b - a * c;
+        if (bbac < 0) {
+            found = false;
+        } else {
+            if (glm::abs(a) > glm::abs(c) * 1e-10) {
+                x = (-b + d_sign * sqrt(bbac)) / a;
+            } else {
+                x = (-c / 2) / b;
+            }
+        }
+        y = y + aml * x;
+        z = z + anl * x;
+    } else if (cs == 2) {
+        double alm = direction[0] / direction[1];
+        double anm = direction[2] / direction[1];
+        x = position[0] - alm * position[1];
+        z = position[2] - anm * position[1];
+        d_sign = int(glm::sign(direction[1]) * q.m_icurv);
+
+        a = q.m_a22 + 2 * q.m_a12 * alm + q.m_a11 * alm * alm + 2 * q.m_a23 * anm + 2 * q.m_a13 * alm * anm + q.m_a33 * anm * anm;
+        b = q.m_a24 + q.m_a14 * alm + q.m_a34 * anm + (q.m_a12 + q.m_a11 * alm + q.m_a13 * anm) * x + (q.m_a23 + q.m_a13 * alm + q.m_a33 * anm) * z;
+        c = q.m_a44 + q.m_a11 * x * x + 2 * q.m_a34 * z + q.m_a33 * z * z + 2 * x * (q.m_a14 + q.m_a13 * z);
+
+        double bbac = b * b - a * c;
+        if (bbac < 0) {
+            found = false;
+        } else {
+            if (glm::abs(a) > glm::abs(c) * 1e-10) {
+                y = (-b + d_sign * sqrt(bbac)) / a;
+            } else {
+                y = (-c / 2) / b;
+            }
+        }
+        x = x + alm * y;
+        z = z + anm * y;
+
+    } else {
+        double aln = direction[0] / direction[2];
+        double amn = direction[1] / direction[2];
+        // firstParam = aln;
+        // secondParam = amn;
+        x = position[0] - aln * position[2];
+        y = position[1] - amn * position[2];
+        d_sign = int(glm::sign(direction[2]) * q.m_icurv);
+
+        a = q.m_a33 + 2 * q.m_a13 * aln + q.m_a11 * aln * aln + 2 * q.m_a23 * amn + 2 * q.m_a12 * aln * amn + q.m_a22 * amn * amn;
+        b = q.m_a34 + q.m_a14 * aln + q.m_a24 * amn + (q.m_a13 + q.m_a11 * aln + q.m_a12 * amn) * x + (q.m_a23 + q.m_a12 * aln + q.m_a22 * amn) * y;
+        c = q.m_a44 + q.m_a11 * x * x + 2 * q.m_a24 * y + q.m_a22 * y * y + 2 * x * (q.m_a14 + q.m_a12 * y);
+
+        double bbac = b * b - a * c;
+        if (bbac < 0) {
+            found = false;
+        } else {
+            if (glm::abs(a) > glm::abs(c) * 1e-10) {  // pow(10, double(-10))) {
+                z = (-b + d_sign * sqrt(bbac)) / a;
+            } else {
+                z = (-c / 2) / b;
+            }
+        }
+        x = x + aln * z;
+        y = y + amn * z;
+        // position = glm::dvec3(a, b, c);
+    }
+
+    // intersection point is in the negative direction (behind the position when the direction is followed forwards), set weight to 0
+    if ((x - position.x) / direction.x < 0 || (y - position.y) / direction.y < 0 || (z - position.z) / direction.z < 0) {
+        found = false;
+    }
+
+    hitpoint = glm::dvec3(x, y, z);
+
+    double fx = 2 * q.m_a14 + 2 * q.m_a11 * x + 2 * q.m_a12 * y + 2 * q.m_a13 * z;
+    double fy = 2 * q.m_a24 + 2 * q.m_a12 * x + 2 * q.m_a22 * y + 2 * q.m_a23 * z;
+    double fz = 2 * q.m_a34 + 2 * q.m_a13 * x + 2 * q.m_a23 * y + 2 * q.m_a33 * z;
+    normal = glm::normalize(glm::dvec3(fx, fy, fz));
+    return found;
+}
+
 RAYX_FN_ACC Collision getQuadricCollision(Ray r, QuadricSurface q);
+RAYX_FN_ACC Collision getCubicCollision(Ray r, CubicSurface cu);
 RAYX_FN_ACC Collision getToroidCollision(Ray r, ToroidSurface toroid, bool isTriangul);
 RAYX_FN_ACC Collision RAYX_API findCollisionInElementCoords(Ray r, Surface surface, Cutout cutout, bool isTriangul);
+// same as above, but for a pre-decoded surface and cutout (see ElementRecord).
+RAYX_FN_ACC Collision RAYX_API findCollisionInElementCoords(Ray r, const DecodedSurface& surface, const DecodedCutout& cutout, bool isTriangul);
 RAYX_FN_ACC Collision findCollisionWith(Ray r, uint32_t id, InvState& inv);
 RAYX_FN_ACC Collision findCollision(const Ray& ray, InvState& inv);
 
@@ -4,6 +4,7 @@
 #include "Constants.h"
 #include "InvocationState.h"
 #include "Rand.h"
+#include "Utils.h"
 
 namespace RAYX {
 
@@ -109,4 +110,33 @@ void fraun_diff(double dim, double wl, double& dAngle, InvState& inv) {
     }
 }
 
+RAYX_FN_ACC
+double RAYX_API sampleDiffractionTable(int offset, double p, InvState& inv) {
+    double t = glm::clamp(p, 0.0, 1.0) * (DIFFRACTION_TABLE_SIZE - 1);
+    int i = glm::min(int(t), DIFFRACTION_TABLE_SIZE - 2);
+    double a = inv.diffractionTables[offset + i];
+    double b = inv.diffractionTables[offset + i + 1];
+    return a + (t - i) * (b - a);
+}
+
+RAYX_FN_ACC
+void bessel_diff_table(double radius, double wl, double& dphi, double& dpsi, int offset, InvState& inv) {
+    double b = glm::abs(radius) * 1e06;
+    double ximax = 5.0 * wl / b;
+
+    // the pattern is rotationally symmetric, hence only the radius is tabulated.
+    double r = sampleDiffractionTable(offset, squaresDoubleRNG(inv.ctr), inv) * ximax;
+    double sin_a, cos_a;
+    sinCos(2.0 * PI * squaresDoubleRNG(inv.ctr), sin_a, cos_a);
+    dphi = r * cos_a;
+    dpsi = r * sin_a;
+}
+
+RAYX_FN_ACC
+void fraun_diff_table(double dim, double wl, double& dAngle, int offset, InvState& inv) {
+    if (dim == 0) return;  // no diffraction in this direction
+    double b = dim * 1e06;
+    dAngle = sampleDiffractionTable(offset, squaresDoubleRNG(inv.ctr), inv) * 5.0 * wl / b;
+}
+
 }  // namespace RAYX
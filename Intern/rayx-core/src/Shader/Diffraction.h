@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Constants.h"
 #include "Core.h"
 #include "InvocationState.h"
 
@@ -31,4 +32,31 @@ RAYX_FN_ACC void bessel_diff(double radius, double wl, double& dphi, double& dps
  */
 RAYX_FN_ACC void fraun_diff(double dim, double wl, double& dAngle, InvState& inv);
 
+/**
+ * Inverse cumulative distribution functions of the diffraction patterns, so that slits can sample the diffraction angles in constant time
+ * instead of by rejection sampling. Both patterns are self-similar in (angle * aperture / wavelength), hence a single table per pattern
+ * serves all slits and wavelengths. The tables are built on the host, see Element/DiffractionTables.h.
+ *
+ * Layout of `inv.diffractionTables`:
+ * - diffractionTables[id] is the offset of the table used by slit `id` (Fraunhofer for rectangular, Airy for elliptical openings),
+ *   or -1 if the slit uses rejection sampling.
+ * - each table consists of DIFFRACTION_TABLE_SIZE nodes x(p), equidistant in p = 0 .. 1.
+ *
+ * Fraunhofer: x in [-1, 1] is the diffraction angle in units of 5 * wl / b, distributed like sinc^2(5 * pi * x).
+ * Airy: x in [0, AIRY_TABLE_MAX_RADIUS] is the radial diffraction angle in units of 5 * wl / b, distributed like x * (2 * J1(u) / u)^2
+ * with u = 5 * sqrt(2) * pi * x. bessel1 vanishes above 20, which limits the radius just as in bessel_diff.
+ */
+constexpr int DIFFRACTION_TABLE_SIZE = 4096;
+constexpr double AIRY_TABLE_MAX_RADIUS = 20.0 / (5.0 * 1.4142135623730951 * PI);
+
+// evaluates the table at `offset` for the probability p in [0, 1] by linear interpolation.
+RAYX_FN_ACC double RAYX_API sampleDiffractionTable(int offset, double p, InvState& inv);
+
+// same as bessel_diff, but sampled from the Airy table at `offset`.
+RAYX_FN_ACC void bessel_diff_table(double radius, double wl, double& dphi, double& dpsi, int offset, InvState& inv);
+
+// same as fraun_diff, but sampled from the Fraunhofer table at `offset`.
+// Note: fraun_diff weights with sinc^2(pi * b * sin(dAngle) / wl), the table uses sin(dAngle) = dAngle, which is exact up to dAngle^2 / 6 (relative).
+RAYX_FN_ACC void fraun_diff_table(double dim, double wl, double& dAngle, int offset, InvState& inv);
+
 }  // namespace RAYX
@@ -4,10 +4,62 @@
 #include "Collision.h"
 #include "EventType.h"
 #include "Helper.h"
+#include "RayPacket.h"
 #include "Utils.h"
 
 namespace RAYX {
 
+RAYX_FN_ACC
+bool traceCollision(Ray& ray, const Collision& col, InvState& inv) {
+    // transform ray and intersection point in ELEMENT coordiantes
+    const ElementRecord& nextElement = inv.elementRecords[col.elementIndex];
+    ray = rayMatrixMult(ray, nextElement.m_inTrans);
+
+    // Calculate interaction(reflection,material, absorption etc.) of ray with detected next element
+    int btype = int(nextElement.m_behaviour.m_type);
+
+    ray.m_pathLength += glm::length(ray.m_position - col.hitpoint);
+    ray.m_position = col.hitpoint;
+    ray.m_lastElement = col.elementIndex;
+
+    switch (btype) {
+        case BTYPE_MIRROR:
+            ray = behaveMirror(ray, col.elementIndex, col, inv);
+            break;
+        case BTYPE_GRATING:
+            ray = behaveGrating(ray, col.elementIndex, col, inv);
+            break;
+        case BTYPE_SLIT:
+            ray = behaveSlit(ray, col.elementIndex, col, inv);
+            break;
+        case BTYPE_RZP:
+            ray = behaveRZP(ray, col.elementIndex, col, inv);
+            break;
+        case BTYPE_IMAGE_PLANE:
+            ray = behaveImagePlane(ray, col.elementIndex, col, inv);
+            break;
+    }
+
+    // the ray might finalize due to being absorbed, or because an error occured while tracing!
+    if (inv.finalized) {
+        return false;
+    }
+
+    recordEvent(ray, ETYPE_JUST_HIT_ELEM, inv);
+
+    // transform back to WORLD coordinates
+    ray = rayMatrixMult(ray, nextElement.m_outTrans);
+    return true;
+}
+
+// stores the number of recorded events of the ray `gid`.
+RAYX_FN_ACC
+void storeEventsCount(int gid, InvState& inv) {
+    auto eventsCount = static_cast<int>(inv.nextEventIndex - inv.pushConstants.startEventID);
+    eventsCount = std::max(0, std::min(static_cast<int>(inv.pushConstants.maxEvents), eventsCount));
+    inv.outputRayCounts[gid] = eventsCount;
+}
+
 RAYX_FN_ACC
 void dynamicElements(int gid, InvState& inv) {
     // initializes the global state.
@@ -16,11 +68,6 @@ void dynamicElements(int gid, InvState& inv) {
 
     Ray ray = inv.inputRays[gid];
 
-    Element nextElement;
-    // at the end of this function we apply inTrans, if no collision happened (i.e. nextElement undefined), we want this to do nothing.
-    nextElement.m_inTrans = glm::dmat4(1);
-    nextElement.m_outTrans = glm::dmat4(1);
-
     // Iterate through all bounces
     while (true) {
         Collision col = findCollision(ray, inv);
@@ -30,50 +77,50 @@ void dynamicElements(int gid, InvState& inv) {
             break;
         }
 
-        // transform ray and intersection point in ELEMENT coordiantes
-        nextElement = inv.elements[col.elementIndex];
-        ray = rayMatrixMult(ray, nextElement.m_inTrans);
-
-        // Calculate interaction(reflection,material, absorption etc.) of ray with detected next element
-        int btype = int(nextElement.m_behaviour.m_type);
-
-        ray.m_pathLength += glm::length(ray.m_position - col.hitpoint);
-        ray.m_position = col.hitpoint;
-        ray.m_lastElement = col.elementIndex;
-
-        switch (btype) {
-            case BTYPE_MIRROR:
-                ray = behaveMirror(ray, col.elementIndex, col, inv);
-                break;
-            case BTYPE_GRATING:
-                ray = behaveGrating(ray, col.elementIndex, col, inv);
-                break;
-            case BTYPE_SLIT:
-                ray = behaveSlit(ray, col.elementIndex, col, inv);
-                break;
-            case BTYPE_RZP:
-                ray = behaveRZP(ray, col.elementIndex, col, inv);
-                break;
-            case BTYPE_IMAGE_PLANE:
-                ray = behaveImagePlane(ray, col.elementIndex, col, inv);
-                break;
-        }
-
-        // the ray might finalize due to being absorbed, or because an error occured while tracing!
-        if (inv.finalized) {
+        if (!traceCollision(ray, col, inv)) {
             break;
         }
+    }
+
+    // store recorded events count
+    storeEventsCount(gid, inv);
+}
+
+RAYX_FN_ACC
+void dynamicElementsPacket(int packetId, InvState& inv) {
+    // every ray has its own lane state, exactly as if it was traced by dynamicElements.
+    LaneState lanes[RAY_PACKET_SIZE];
+    Ray rays[RAY_PACKET_SIZE] = {};
+    bool active[RAY_PACKET_SIZE] = {};
+    Collision cols[RAY_PACKET_SIZE];
 
-        recordEvent(ray, ETYPE_JUST_HIT_ELEM, inv);
+    const int first = packetId * RAY_PACKET_SIZE;
+    const int count = std::min(RAY_PACKET_SIZE, static_cast<int>(inv.inputRays.size()) - first);
+    if (count < 1) return;
 
-        // transform back to WORLD coordinates
-        ray = rayMatrixMult(ray, nextElement.m_outTrans);
+    for (int i = 0; i < count; i++) {
+        inv.globalInvocationId = orderedRayIndex(first + i, inv);
+        init(inv);
+        rays[i] = inv.inputRays[inv.globalInvocationId];
+        active[i] = true;
+        storeLane(inv, lanes[i]);
     }
 
-    // store recorded events count
-    auto eventsCount = static_cast<int>(inv.nextEventIndex - inv.pushConstants.startEventID);
-    eventsCount = std::max(0, std::min(static_cast<int>(inv.pushConstants.maxEvents), eventsCount));
-    inv.outputRayCounts[gid] = eventsCount;
+    // Iterate through all bounces, until all rays of the packet are done.
+    bool anyActive = true;
+    while (anyActive) {
+        findCollisionPacket(rays, active, inv, lanes, cols);
+
+        traceCollisionPacket(rays, cols, active, inv, lanes);
+
+        anyActive = false;
+        for (int i = 0; i < count; i++) anyActive = anyActive || active[i];
+    }
+
+    for (int i = 0; i < count; i++) {
+        loadLane(lanes[i], inv);
+        storeEventsCount(inv.globalInvocationId, inv);
+    }
 }
 
 }  // namespace RAYX
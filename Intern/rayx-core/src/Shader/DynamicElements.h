@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Collision.h"
 #include "Core.h"
 #include "InvocationState.h"
 
@@ -8,6 +9,13 @@ namespace RAYX {
 // @brief: Dynamic ray tracing: check which ray hits which element first
 // in this function we need to make sure that rayData ALWAYS remains in GLOBAL coordinates (it can be changed in a function but needs to be changed
 // back before the function returns to this function)
+// applies the element hit in `col` to `ray`, which is in world coordinates before and after. Returns false if the ray was finalized.
+RAYX_FN_ACC bool traceCollision(Ray& ray, const Collision& col, InvState& inv);
+
 RAYX_FN_ACC void dynamicElements(int gid, InvState& inv);
 
+// same as dynamicElements, but the threads [packetId * RAY_PACKET_SIZE, (packetId + 1) * RAY_PACKET_SIZE) are traced as a packet. Only for the
+// CPU, see RayPacket.h
+RAYX_FN_ACC void dynamicElementsPacket(int packetId, InvState& inv);
+
 }  // namespace RAYX
@@ -22,6 +22,103 @@ struct ComplexFresnelCoeffs {
     complex::Complex p;
 };
 
+/**
+ * Closed-form variants of the Fresnel equations and the polarization matrix, written in terms of cos(incidence angle).
+ * They avoid the complex trigonometric functions, and replace the complex multiplication and division of std::complex (which handle
+ * infinities, NaNs and overflow, and can't be inlined without -ffast-math) with plain real arithmetic. None of these cases occur for
+ * refractive indices and incidence angles of physical elements.
+ * They are used instead of the generic functions if rayx-core is built with RAYX_FAST_FRESNEL (CMake option of the same name).
+ * The tabulated mirrors (see FresnelTable.h) always use fast::calcReflectAmplitude, which keeps full precision close to the critical angle.
+ */
+namespace fast {
+
+RAYX_FN_ACC
+inline complex::Complex mul(const complex::Complex a, const complex::Complex b) {
+    return complex::Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+RAYX_FN_ACC
+inline complex::Complex div(const complex::Complex a, const complex::Complex b) {
+    const double d = 1.0 / (b.real() * b.real() + b.imag() * b.imag());
+    return complex::Complex((a.real() * b.real() + a.imag() * b.imag()) * d, (a.imag() * b.real() - a.real() * b.imag()) * d);
+}
+
+// principal square root. The smaller component is derived from the larger one, to avoid cancellation.
+RAYX_FN_ACC
+inline complex::Complex sqrt(const complex::Complex z) {
+    const double x = z.real();
+    const double y = z.imag();
+    const double t = glm::sqrt(0.5 * (glm::sqrt(x * x + y * y) + glm::abs(x)));
+    if (t == 0.0) return complex::Complex(0.0, 0.0);
+    if (x >= 0.0) return complex::Complex(t, y / (2.0 * t));
+    // as std::sqrt, a negative zero imaginary part selects the lower branch.
+    const bool negative = y < 0.0 || (y == 0.0 && 1.0 / y < 0.0);
+    return complex::Complex(glm::abs(y) / (2.0 * t), negative ? -t : t);
+}
+
+// cos(refractAngle) = sqrt(1 - (iorI / iorT)^2 * sin^2(incidentAngle))
+RAYX_FN_ACC
+inline complex::Complex cosRefractAngle(const double cosIncidence, const complex::Complex iorI, const complex::Complex iorT) {
+    const auto ratio = div(iorI, iorT);
+    const double sin2_i = (1.0 - cosIncidence) * (1.0 + cosIncidence);
+    const auto r2 = mul(ratio, ratio);
+    return fast::sqrt(complex::Complex(1.0 - r2.real() * sin2_i, -r2.imag() * sin2_i));
+}
+
+RAYX_FN_ACC
+inline ComplexFresnelCoeffs calcReflectAmplitude(const double cosIncidence, const complex::Complex iorI, const complex::Complex iorT) {
+    const auto cos_t = cosRefractAngle(cosIncidence, iorI, iorT);
+    const auto iorI_cos_i = iorI * cosIncidence;
+    const auto iorT_cos_i = iorT * cosIncidence;
+    const auto iorT_cos_t = mul(iorT, cos_t);
+    const auto iorI_cos_t = mul(iorI, cos_t);
+
+    return {
+        .s = div(iorI_cos_i - iorT_cos_t, iorI_cos_i + iorT_cos_t),
+        .p = div(iorT_cos_i - iorI_cos_t, iorT_cos_i + iorI_cos_t),
+    };
+}
+
+RAYX_FN_ACC
+inline ComplexFresnelCoeffs calcRefractAmplitude(const double cosIncidence, const complex::Complex iorI, const complex::Complex iorT) {
+    const auto cos_t = cosRefractAngle(cosIncidence, iorI, iorT);
+    const auto iorI_cos_i = iorI * cosIncidence;
+    const auto iorT_cos_i = iorT * cosIncidence;
+
+    return {
+        .s = div(2.0 * iorI_cos_i, iorI_cos_i + mul(iorT, cos_t)),
+        .p = div(2.0 * iorI_cos_i, iorT_cos_i + mul(iorI, cos_t)),
+    };
+}
+
+// projection of a complex field onto a real direction.
+RAYX_FN_ACC
+inline complex::Complex project(const glm::dvec3 v, const ElectricField field) { return v.x * field.x + v.y * field.y + v.z * field.z; }
+
+// same as calcPolaririzationMatrix(incidentVec, reflectVec, normalVec, reflectAmplitude) * incidentElectricField (respectively the matrix at
+// normal incidence), but applied directly to the field instead of building and multiplying complex matrices.
+RAYX_FN_ACC
+inline ElectricField interceptReflect(const ElectricField incidentElectricField, const glm::dvec3 incidentVec, const glm::dvec3 reflectVec,
+                                      const glm::dvec3 normalVec, const ComplexFresnelCoeffs reflectAmplitude) {
+    if (incidentVec == -normalVec) {
+        const auto& s = reflectAmplitude.s;
+        return ElectricField(mul(s, incidentElectricField.x), mul(s, incidentElectricField.y), mul(s, incidentElectricField.z));
+    }
+
+    const auto s0 = glm::normalize(glm::cross(incidentVec, -normalVec));
+    const auto p0 = glm::cross(incidentVec, s0);
+    const auto p1 = glm::cross(reflectVec, s0);
+
+    const auto es = mul(reflectAmplitude.s, project(s0, incidentElectricField));
+    const auto ep = mul(reflectAmplitude.p, project(p0, incidentElectricField));
+    const auto ek = project(incidentVec, incidentElectricField);
+
+    return ElectricField(s0.x * es + p1.x * ep + reflectVec.x * ek, s0.y * es + p1.y * ep + reflectVec.y * ek,
+                         s0.z * es + p1.z * ep + reflectVec.z * ek);
+}
+
+}  // namespace fast
+
 RAYX_FN_ACC
 inline double angleBetweenUnitVectors(glm::dvec3 a, glm::dvec3 b) { return glm::acos(glm::dot(a, b)); }
 
@@ -126,13 +223,23 @@ inline cmat3 calcReflectPolarizationMatrixAtNormalIncidence(const ComplexFresnel
 }
 
 RAYX_FN_ACC
-inline ElectricField interceptReflect(const ElectricField incidentElectricField, const glm::dvec3 incidentVec, const glm::dvec3 reflectVec,
-                                      const glm::dvec3 normalVec, const complex::Complex iorI, const complex::Complex iorT) {
+inline ComplexFresnelCoeffs calcReflectAmplitude(const glm::dvec3 incidentVec, const glm::dvec3 normalVec, const complex::Complex iorI,
+                                                 const complex::Complex iorT) {
+#ifdef RAYX_FAST_FRESNEL
+    return fast::calcReflectAmplitude(glm::dot(incidentVec, -normalVec), iorI, iorT);
+#else
     const auto incidentAngle = complex::Complex(angleBetweenUnitVectors(incidentVec, -normalVec), 0);
     const auto refractAngle = calcRefractAngle(incidentAngle, iorI, iorT);
+    return calcReflectAmplitude(incidentAngle, refractAngle, iorI, iorT);
+#endif
+}
 
-    const auto reflectAmplitude = calcReflectAmplitude(incidentAngle, refractAngle, iorI, iorT);
-
+RAYX_FN_ACC
+inline ElectricField interceptReflect(const ElectricField incidentElectricField, const glm::dvec3 incidentVec, const glm::dvec3 reflectVec,
+                                      const glm::dvec3 normalVec, const ComplexFresnelCoeffs reflectAmplitude) {
+#ifdef RAYX_FAST_FRESNEL
+    return fast::interceptReflect(incidentElectricField, incidentVec, reflectVec, normalVec, reflectAmplitude);
+#else
     // TODO: make this more robust
     const auto isNormalIncidence = incidentVec == -normalVec;
     const auto reflectPolarizationMatrix = isNormalIncidence ? calcReflectPolarizationMatrixAtNormalIncidence(reflectAmplitude)
@@ -140,6 +247,14 @@ inline ElectricField interceptReflect(const ElectricField incidentElectricField,
 
     const auto reflectElectricField = reflectPolarizationMatrix * incidentElectricField;
     return reflectElectricField;
+#endif
+}
+
+RAYX_FN_ACC
+inline ElectricField interceptReflect(const ElectricField incidentElectricField, const glm::dvec3 incidentVec, const glm::dvec3 reflectVec,
+                                      const glm::dvec3 normalVec, const complex::Complex iorI, const complex::Complex iorT) {
+    const auto reflectAmplitude = calcReflectAmplitude(incidentVec, normalVec, iorI, iorT);
+    return interceptReflect(incidentElectricField, incidentVec, reflectVec, normalVec, reflectAmplitude);
 }
 
 RAYX_FN_ACC
@@ -0,0 +1,35 @@
+#include "FresnelTable.h"
+
+namespace RAYX {
+
+RAYX_FN_ACC
+bool lookupReflectAmplitude(int id, double energy, double cosIncidence, InvState& inv, ComplexFresnelCoeffs& out) {
+    if (id >= int(inv.fresnelTables.size()) || inv.fresnelTables[id] < 0) return false;
+
+    const int offset = int(inv.fresnelTables[id]);
+    const double minEnergy = inv.fresnelTables[offset];
+    const double maxEnergy = inv.fresnelTables[offset + 1];
+    const int segments = int(inv.fresnelTables[offset + 2]);
+    if (energy < minEnergy || energy > maxEnergy) return false;
+
+    // binary search for the last segment starting at or below `energy`.
+    const int start = offset + FRESNEL_TABLE_HEADER_SIZE;
+    int low = 0;
+    int high = segments;
+    while (high - low > 1) {
+        int center = (low + high) / 2;
+        if (energy < inv.fresnelTables[start + center * FRESNEL_TABLE_SEGMENT_SIZE]) {
+            high = center;
+        } else {
+            low = center;
+        }
+    }
+
+    const int index = start + low * FRESNEL_TABLE_SEGMENT_SIZE;
+    const auto iorI = complex::Complex(inv.fresnelTables[index + 1], inv.fresnelTables[index + 2]);
+    const auto iorT = complex::Complex(inv.fresnelTables[index + 3], inv.fresnelTables[index + 4]);
+    out = fast::calcReflectAmplitude(glm::clamp(cosIncidence, 0.0, 1.0), iorI, iorT);
+    return true;
+}
+
+}  // namespace RAYX
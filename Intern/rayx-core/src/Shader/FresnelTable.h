@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Core.h"
+#include "Efficiency.h"
+#include "InvocationState.h"
+
+namespace RAYX {
+
+/**
+ * Tabulated refractive indices of the mirrors, so that the reflection amplitude of a mirror doesn't require a material table lookup and
+ * complex trigonometric functions for every reflection.
+ * The tables are built on the host (see Material/FresnelTableBuilder.h), but only if the beam is monochromatic or narrow-band.
+ *
+ * getRefractiveIndex is a step function of the energy: it uses the Palik or Nff entry at or below the energy, without interpolation.
+ * Hence a table stores the steps within the energy range of the beam, split at the entry energies of the material tables, and yields
+ * exactly the refractive indices of getRefractiveIndex (in particular across absorption edges).
+ *
+ * Layout of `inv.fresnelTables`:
+ * - fresnelTables[id] is the offset of the table of element `id`, or -1 if the element has no table.
+ * - each table starts with a header of FRESNEL_TABLE_HEADER_SIZE doubles: [minimal energy, maximal energy, number of segments]
+ * - followed by the segments in ascending order, each [first energy, Re(iorI), Im(iorI), Re(iorT), Im(iorT)].
+ *   A segment is used from its first energy up to the first energy of the next segment (respectively the maximal energy).
+ *
+ * The incidence angle is not tabulated: the reflectivity of weakly absorbing coatings changes too abruptly at the critical angle to be
+ * interpolated. Instead, the amplitude is evaluated in closed form from cos(incidence angle), see fast::calcReflectAmplitude.
+ */
+
+constexpr int FRESNEL_TABLE_HEADER_SIZE = 3;
+constexpr int FRESNEL_TABLE_SEGMENT_SIZE = 5;
+// tables are only built if (maximal energy - minimal energy) <= FRESNEL_TABLE_MAX_ENERGY_SPREAD * maximal energy.
+constexpr double FRESNEL_TABLE_MAX_ENERGY_SPREAD = 1e-2;
+
+// looks up the reflection amplitude of element `id` for a ray with `energy`, hitting the surface with cos(incidence angle) = `cosIncidence`.
+// returns false if the element has no table, or `energy` is not covered by it. In this case the amplitude has to be calculated exactly.
+RAYX_FN_ACC bool RAYX_API lookupReflectAmplitude(int id, double energy, double cosIncidence, InvState& inv, ComplexFresnelCoeffs& out);
+
+}  // namespace RAYX
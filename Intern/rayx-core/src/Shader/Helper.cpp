@@ -25,7 +25,14 @@ void init(InvState& inv) {
 }
 
 RAYX_FN_ACC
-uint64_t rayId(InvState& inv) { return uint64_t(inv.pushConstants.rayIdStart) + uint64_t(inv.globalInvocationId); }
+uint64_t rayId(InvState& inv) {
+    if (inv.rayIds[0] >= 0) return uint64_t(inv.rayIds[inv.globalInvocationId]);
+    return uint64_t(inv.pushConstants.rayIdStart) + uint64_t(inv.globalInvocationId);
+}
+
+// the index of the input ray, which is traced by the given thread. See InvState::rayOrder
+RAYX_FN_ACC
+int orderedRayIndex(int thread, InvState& inv) { return inv.rayOrder[0] < 0 ? thread : inv.rayOrder[thread]; }
 
 // `i in [0, maxEvents-1]`.
 // Will return the index in outputRays to access the `i'th` output ray belonging to this shader call.
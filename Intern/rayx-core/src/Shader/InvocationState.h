@@ -5,6 +5,7 @@
 #include <span>
 
 #include "Element/Element.h"
+#include "Element/ElementRecord.h"
 #include "Ray.h"
 
 namespace RAYX {
@@ -34,11 +35,15 @@ struct RAYX_API InvState {
     uint64_t nextEventIndex;
 
     std::span<const Ray> inputRays;
+    std::span<const int> rayOrder;  // thread i traces inputRays[rayOrder[i]], or inputRays[i] if rayOrder[0] is -1. See Tracer/RayOrder.h
+    std::span<const int64_t> rayIds;  // the ray-id of inputRays[i], or -1 in rayIds[0] if it is rayIdStart + i. See Beamline/SourceAcceptance.h
     std::span<Ray> outputRays;
     std::span<int> outputRayCounts;
-    std::span<const Element> elements;
+    std::span<const ElementRecord> elementRecords;  // the compact representation of the elements, see Element/ElementRecord.h
     std::span<const int> matIdx;
     std::span<const double> mat;
+    std::span<const double> fresnelTables;      // tabulated refractive indices of the mirrors, see FresnelTable.h
+    std::span<const double> diffractionTables;  // inverse CDFs of the slit diffraction patterns, see Diffraction.h
 
 #ifdef RAYX_DEBUG_MODE
     std::span<_debug_struct> d_struct;
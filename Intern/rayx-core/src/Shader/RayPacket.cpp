@@ -0,0 +1,333 @@
+#include "RayPacket.h"
+
+#include "Behave.h"
+#include "DynamicElements.h"
+#include "EventType.h"
+#include "Helper.h"
+#include "Utils.h"
+
+// vectorizes the loops over the lanes of a packet.
+#if defined(_OPENMP) && !defined(__CUDA_ARCH__)
+#define RAYX_SIMD _Pragma("omp simd")
+#else
+#define RAYX_SIMD
+#endif
+
+namespace RAYX {
+
+// the rays of a packet in world coordinates.
+struct RayLanes {
+    double m_position[3][RAY_PACKET_SIZE];
+    double m_direction[3][RAY_PACKET_SIZE];
+};
+
+// the collisions of the rays of a packet with a single element, in element coordinates.
+struct CollisionLanes {
+    double m_hitpoint[3][RAY_PACKET_SIZE];
+    double m_normal[3][RAY_PACKET_SIZE];
+    bool m_found[RAY_PACKET_SIZE];
+};
+
+RAYX_FN_ACC
+bool isPacketElement(const ElementRecord& record) {
+    const int stype = record.m_surface.m_type;
+    const int ctype = int(record.m_cutout.m_cutout.m_type);
+    // applySlopeError leaves the normal untouched and draws no random numbers.
+    const bool noSlopeError = record.m_slopeError.m_sag == 0 && record.m_slopeError.m_mer == 0;
+    return noSlopeError && (stype == STYPE_PLANE_XZ || stype == STYPE_QUADRIC) && (ctype == CTYPE_RECT || ctype == CTYPE_UNLIMITED);
+}
+
+// intersects all lanes with the plane or quadric of `record`.
+// Performs the same floating point operations as findCollisionWith, i.e. rayMatrixMult and findCollisionInElementCoords.
+RAYX_FN_ACC
+void collideLanes(const RayLanes& rays, const ElementRecord& record, CollisionLanes& out) {
+    const glm::dmat4x3& m = record.m_inTrans;
+    const DecodedCutout& cutout = record.m_cutout;
+    const bool quadric = record.m_surface.m_type == STYPE_QUADRIC;
+    const QuadricSurface& q = record.m_surface.m_quadric;
+
+    // the exact test of inCutout, a rectangle doesn't contain its border.
+    const bool rect = int(cutout.m_cutout.m_type) == CTYPE_RECT;
+    double xMax = 0.0;
+    double zMax = 0.0;
+    if (rect) {
+        RectCutout r = deserializeRect(cutout.m_cutout);
+        xMax = r.m_width / 2.0;
+        zMax = r.m_length / 2.0;
+    }
+
+    RAYX_SIMD
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        const glm::dvec4 x = glm::dvec4(rays.m_position[0][i], rays.m_position[1][i], rays.m_position[2][i], 1);
+        const glm::dvec4 d = glm::dvec4(rays.m_direction[0][i], rays.m_direction[1][i], rays.m_direction[2][i], 0);
+        const glm::dvec3 position = m * x;
+        const glm::dvec3 direction = m * d;
+
+        glm::dvec3 hitpoint;
+        glm::dvec3 normal;
+        bool found;
+        if (quadric) {
+            found = intersectQuadric(q, position, direction, hitpoint, normal);
+        } else {
+            normal = glm::dvec3(0, -glm::sign(direction.y), 0);
+            const double time = -position.y / direction.y;
+            hitpoint = glm::dvec3(position.x + direction.x * time, 0, position.z + direction.z * time);
+            found = time >= 0;
+        }
+
+        const bool outside = hitpoint.x < cutout.m_min.x || hitpoint.x > cutout.m_max.x || hitpoint.z < cutout.m_min.y ||
+                             hitpoint.z > cutout.m_max.y ||
+                             (rect && (hitpoint.x <= -xMax || hitpoint.x >= xMax || hitpoint.z <= -zMax || hitpoint.z >= zMax));
+
+        // the normal faces the ray, see findCollisionInElementCoords. The normal of a plane already does.
+        if (dot(direction, normal) > 0.0) {
+            normal = normal * -1.0;
+        }
+
+        for (int k = 0; k < 3; k++) {
+            out.m_hitpoint[k][i] = hitpoint[k];
+            out.m_normal[k][i] = normal[k];
+        }
+        out.m_found[i] = found && !outside;
+    }
+}
+
+RAYX_FN_ACC
+Collision laneCollision(const CollisionLanes& lanes, int i, int elementIndex) {
+    Collision col;
+    col.hitpoint = glm::dvec3(lanes.m_hitpoint[0][i], lanes.m_hitpoint[1][i], lanes.m_hitpoint[2][i]);
+    col.normal = glm::dvec3(lanes.m_normal[0][i], lanes.m_normal[1][i], lanes.m_normal[2][i]);
+    col.elementIndex = elementIndex;
+    col.found = true;
+    return col;
+}
+
+// sequential tracing: every ray only checks the element after its last element.
+RAYX_FN_ACC
+void findCollisionPacketSequential(const Ray* rays, const bool* active, InvState& inv, LaneState* lanes, Collision* out) {
+    // the rays of a packet usually share their next element, otherwise fall back to findCollision.
+    int next = 0;
+    bool any = false;
+    bool shared = true;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        if (!active[i]) continue;
+        const int n = int(rays[i].m_lastElement) + 1;
+        if (!any) next = n;
+        any = true;
+        shared = shared && n == next;
+    }
+
+    const bool packet = any && shared && next >= 0 && next < int(inv.elementRecords.size()) && isPacketElement(inv.elementRecords[next]);
+    if (!packet) {
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            if (!active[i]) continue;
+            loadLane(lanes[i], inv);
+            out[i] = findCollision(rays[i], inv);
+            storeLane(inv, lanes[i]);
+        }
+        return;
+    }
+
+    RayLanes lanesRays;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        for (int k = 0; k < 3; k++) {
+            lanesRays.m_position[k][i] = rays[i].m_position[k];
+            lanesRays.m_direction[k][i] = rays[i].m_direction[k];
+        }
+    }
+
+    CollisionLanes cols;
+    collideLanes(lanesRays, inv.elementRecords[next], cols);
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        if (!active[i]) continue;
+        if (cols.m_found[i]) {
+            out[i] = laneCollision(cols, i, next);
+        } else {
+            out[i].found = false;
+        }
+    }
+}
+
+RAYX_FN_ACC
+void findCollisionPacket(const Ray* rays, const bool* active, InvState& inv, LaneState* lanes, Collision* out) {
+    if (inv.pushConstants.sequential == 1.0) {
+        findCollisionPacketSequential(rays, active, inv, lanes, out);
+        return;
+    }
+
+    // see findCollision: the rays are moved slightly forward, but the distances are measured from their original positions.
+    RayLanes moved;
+    double origin[3][RAY_PACKET_SIZE];
+    double bestDist[RAY_PACKET_SIZE];
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        for (int k = 0; k < 3; k++) {
+            origin[k][i] = rays[i].m_position[k];
+            moved.m_position[k][i] = rays[i].m_position[k] + rays[i].m_direction[k] * COLLISION_EPSILON;
+            moved.m_direction[k][i] = rays[i].m_direction[k];
+        }
+        bestDist[i] = infinity();
+        out[i].found = false;
+    }
+
+    CollisionLanes cols;
+    double dist[RAY_PACKET_SIZE];
+    bool closer[RAY_PACKET_SIZE];
+    for (uint32_t elementIndex = 0; elementIndex < uint32_t(inv.elementRecords.size()); elementIndex++) {
+        const ElementRecord& record = inv.elementRecords[elementIndex];
+
+        if (!isPacketElement(record)) {
+            for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+                if (!active[i]) continue;
+                Ray r = rays[i];
+                r.m_position += r.m_direction * COLLISION_EPSILON;
+                loadLane(lanes[i], inv);
+                Collision col = findCollisionWith(r, elementIndex, inv);
+                storeLane(inv, lanes[i]);
+                if (!col.found) continue;
+
+                glm::dvec3 global_hitpoint = record.m_outTrans * glm::dvec4(col.hitpoint, 1);
+                double d = glm::length(global_hitpoint - rays[i].m_position);
+                if (d < bestDist[i]) {
+                    out[i] = col;
+                    bestDist[i] = d;
+                }
+            }
+            continue;
+        }
+
+        collideLanes(moved, record, cols);
+
+        const glm::dmat4x3& m = record.m_outTrans;
+        RAYX_SIMD
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            const glm::dvec4 hitpoint = glm::dvec4(cols.m_hitpoint[0][i], cols.m_hitpoint[1][i], cols.m_hitpoint[2][i], 1);
+            const glm::dvec3 global_hitpoint = m * hitpoint;
+            const glm::dvec3 e = global_hitpoint - glm::dvec3(origin[0][i], origin[1][i], origin[2][i]);
+            dist[i] = glm::length(e);
+            closer[i] = active[i] && cols.m_found[i] && dist[i] < bestDist[i];
+            bestDist[i] = closer[i] ? dist[i] : bestDist[i];
+        }
+
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            if (closer[i]) out[i] = laneCollision(cols, i, int(elementIndex));
+        }
+    }
+}
+
+// reflects the rays in `mask`, which all hit the mirror `id`. Equivalent to traceCollision, but the transformations and the reflection of
+// the direction are computed in SIMD lanes.
+RAYX_FN_ACC
+void traceMirrorLanes(Ray* rays, const Collision* cols, const bool* mask, int id, bool* active, InvState& inv, LaneState* lanes) {
+    const ElementRecord& record = inv.elementRecords[id];
+
+    // unmasked lanes may hold no collision, they are computed on zeros.
+    RayLanes world;
+    CollisionLanes hit;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        for (int k = 0; k < 3; k++) {
+            world.m_position[k][i] = mask[i] ? rays[i].m_position[k] : 0.0;
+            world.m_direction[k][i] = mask[i] ? rays[i].m_direction[k] : 0.0;
+            hit.m_hitpoint[k][i] = mask[i] ? cols[i].hitpoint[k] : 0.0;
+            hit.m_normal[k][i] = mask[i] ? cols[i].normal[k] : 0.0;
+        }
+    }
+
+    // see traceCollision and behaveMirror.
+    double incident[3][RAY_PACKET_SIZE];
+    double reflected[3][RAY_PACKET_SIZE];
+    double path[RAY_PACKET_SIZE];
+    const glm::dmat4x3& in = record.m_inTrans;
+    RAYX_SIMD
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        const glm::dvec4 x = glm::dvec4(world.m_position[0][i], world.m_position[1][i], world.m_position[2][i], 1);
+        const glm::dvec4 d = glm::dvec4(world.m_direction[0][i], world.m_direction[1][i], world.m_direction[2][i], 0);
+        const glm::dvec3 position = in * x;
+        const glm::dvec3 direction = in * d;
+        const glm::dvec3 hitpoint = glm::dvec3(hit.m_hitpoint[0][i], hit.m_hitpoint[1][i], hit.m_hitpoint[2][i]);
+        const glm::dvec3 normal = glm::dvec3(hit.m_normal[0][i], hit.m_normal[1][i], hit.m_normal[2][i]);
+
+        path[i] = glm::length(position - hitpoint);
+        const glm::dvec3 reflect = glm::reflect(direction, normal);
+        for (int k = 0; k < 3; k++) {
+            incident[k][i] = direction[k];
+            reflected[k][i] = reflect[k];
+        }
+    }
+
+    // the reflectivity and the events differ between the rays.
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        if (!mask[i]) continue;
+        Ray& r = rays[i];
+        r.m_pathLength += path[i];
+        r.m_position = cols[i].hitpoint;
+        r.m_direction = glm::dvec3(reflected[0][i], reflected[1][i], reflected[2][i]);
+        r.m_lastElement = cols[i].elementIndex;
+
+        loadLane(lanes[i], inv);
+        reflectMirrorField(r, id, glm::dvec3(incident[0][i], incident[1][i], incident[2][i]), cols[i].normal, inv);
+        active[i] = !inv.finalized;
+        if (active[i]) recordEvent(r, ETYPE_JUST_HIT_ELEM, inv);
+        storeLane(inv, lanes[i]);
+
+        for (int k = 0; k < 3; k++) {
+            world.m_position[k][i] = r.m_position[k];
+            world.m_direction[k][i] = r.m_direction[k];
+        }
+    }
+
+    // transform back to world coordinates.
+    const glm::dmat4x3& out = record.m_outTrans;
+    RAYX_SIMD
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        const glm::dvec4 x = glm::dvec4(world.m_position[0][i], world.m_position[1][i], world.m_position[2][i], 1);
+        const glm::dvec4 d = glm::dvec4(world.m_direction[0][i], world.m_direction[1][i], world.m_direction[2][i], 0);
+        const glm::dvec3 position = out * x;
+        const glm::dvec3 direction = out * d;
+        for (int k = 0; k < 3; k++) {
+            world.m_position[k][i] = position[k];
+            world.m_direction[k][i] = direction[k];
+        }
+    }
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        if (!mask[i] || !active[i]) continue;
+        for (int k = 0; k < 3; k++) {
+            rays[i].m_position[k] = world.m_position[k][i];
+            rays[i].m_direction[k] = world.m_direction[k][i];
+        }
+    }
+}
+
+RAYX_FN_ACC
+void traceCollisionPacket(Ray* rays, const Collision* cols, bool* active, InvState& inv, LaneState* lanes) {
+    // the mirror lanes are traced per mirror, all other lanes one by one.
+    bool mirror[RAY_PACKET_SIZE];
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        mirror[i] = false;
+        if (!active[i]) continue;
+        if (!cols[i].found) {
+            active[i] = false;
+            continue;
+        }
+
+        mirror[i] = int(inv.elementRecords[cols[i].elementIndex].m_behaviour.m_type) == BTYPE_MIRROR;
+        if (!mirror[i]) {
+            loadLane(lanes[i], inv);
+            active[i] = traceCollision(rays[i], cols[i], inv);
+            storeLane(inv, lanes[i]);
+        }
+    }
+
+    for (int first = 0; first < RAY_PACKET_SIZE; first++) {
+        if (!mirror[first]) continue;
+        const int id = cols[first].elementIndex;
+        bool mask[RAY_PACKET_SIZE];
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            mask[i] = mirror[i] && cols[i].elementIndex == id;
+            mirror[i] = mirror[i] && !mask[i];
+        }
+        traceMirrorLanes(rays, cols, mask, id, active, inv, lanes);
+    }
+}
+
+}  // namespace RAYX
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Collision.h"
+#include "Core.h"
+#include "InvocationState.h"
+#include "Ray.h"
+
+namespace RAYX {
+
+/**
+ * Packet tracing on the CPU: instead of one ray per thread, every thread traces a packet of RAY_PACKET_SIZE rays.
+ * The rays of a packet are stored in structure-of-arrays layout while searching for their next collision, so that the collisions with
+ * planes and quadrics (mirrors, slits, image planes, ...) are computed for all rays of the packet at once in SIMD lanes. Likewise, the rays
+ * which hit the same mirror are reflected in SIMD lanes. Rays which hit different elements or are already done are masked, and all other
+ * behaviours, the reflectivity of mirrors and the recording of events are applied to every ray separately.
+ *
+ * Every ray of a packet keeps its own LaneState, hence a packet produces the same events and random numbers as tracing its rays one by one.
+ */
+
+// 8 doubles fill an AVX-512 register, or two AVX2 registers.
+constexpr int RAY_PACKET_SIZE = 8;
+
+// the members of InvState which differ between the rays of a packet. The rays share all other members (the buffers and push constants), hence a
+// packet keeps a single InvState, into which the LaneState of a ray is loaded before it is traced.
+struct LaneState {
+    int globalInvocationId;
+    bool finalized;
+    uint64_t ctr;
+    uint64_t nextEventIndex;
+};
+
+RAYX_FN_ACC
+inline void loadLane(const LaneState& lane, InvState& inv) {
+    inv.globalInvocationId = lane.globalInvocationId;
+    inv.finalized = lane.finalized;
+    inv.ctr = lane.ctr;
+    inv.nextEventIndex = lane.nextEventIndex;
+}
+
+RAYX_FN_ACC
+inline void storeLane(const InvState& inv, LaneState& lane) {
+    lane.globalInvocationId = inv.globalInvocationId;
+    lane.finalized = inv.finalized;
+    lane.ctr = inv.ctr;
+    lane.nextEventIndex = inv.nextEventIndex;
+}
+
+// whether the collisions with the element are computed in SIMD lanes: planes and quadrics without slope error, whose cutout is rectangular
+// or unlimited.
+RAYX_FN_ACC bool RAYX_API isPacketElement(const ElementRecord& record);
+
+// finds the next collision of every active ray of a packet, equivalent to calling findCollision(rays[i], inv) with lanes[i] loaded into `inv`
+// for every active lane. The slope errors draw from the random state of lanes[i].
+RAYX_FN_ACC void RAYX_API findCollisionPacket(const Ray* rays, const bool* active, InvState& inv, LaneState* lanes, Collision* out);
+
+// applies the collisions found by findCollisionPacket, equivalent to traceCollision(rays[i], cols[i], inv) with lanes[i] loaded into `inv` for
+// every active lane. Afterwards, active[i] tells whether ray i is still traced.
+RAYX_FN_ACC void RAYX_API traceCollisionPacket(Ray* rays, const Collision* cols, bool* active, InvState& inv, LaneState* lanes);
+
+}  // namespace RAYX
@@ -5,6 +5,14 @@
 
 namespace RAYX {
 
+/**
+ * @brief The rotation which refrac2D applies to fit the collision normal to the element normal, and its inverse.
+ */
+struct RefracRotation {
+    glm::dmat3 m_rot;
+    glm::dmat3 m_invRot;
+};
+
 /**
 calculates refracted ray
 @params: 	r: ray
@@ -15,4 +23,13 @@ anyways. az: linedensity in z direction ax: linedensity in x direction
 */
 RAYX_FN_ACC Ray refrac2D(Ray r, glm::dvec3 normal, double az, double ax, InvState& inv);
 
+// same as above, for a rotation precomputed by refracRotation.
+RAYX_FN_ACC Ray refrac2D(Ray r, const RefracRotation& rotation, double az, double ax, InvState& inv);
+
+// same as above, for the normal (0, +-1, 0) of planes. The rotation is the identity for both signs, hence it is skipped.
+RAYX_FN_ACC Ray refrac2DPlane(Ray r, double az, double ax, InvState& inv);
+
+// the rotation which fits `normal` to the element normal (0, 1, 0), see refrac2D.
+RAYX_FN_ACC RefracRotation RAYX_API refracRotation(glm::dvec3 normal);
+
 }  // namespace RAYX
@@ -20,6 +20,12 @@ namespace RAYX {
 // materials.
 // -- Thus, we cannot index into it as inv.mat[i1][i2][i3][i4] directly, but instead have to use inv.matIdx as described above.
 
+// Additionally, each table may have a lookup grid (see MaterialLookup), which narrows down the binary search for an energy to a single grid cell:
+// * inv.matIdx[185+i] is the beginning of the lookup grid of the Palik Table of the element with atomic number i+1.
+// * inv.matIdx[185+92+i] is the beginning of the lookup grid of the Nff Table of the element with atomic number i+1.
+// A grid consists of log(E_min), the number of cells per unit of log(E), the number of cells, and then for each cell the index of the entry that
+// the binary search yields for the energy at the lower end of that cell. The grid is empty if it wasn't requested, or the table is empty.
+
 // The concrete layout of inv.mat and inv.matIdx has to be compatible with the "loadMaterialTables" function from Material.cpp
 // It is responsible for creating these tables.
 
@@ -73,6 +79,57 @@ NffEntry RAYX_API getNffEntry(int index, int material, InvState& inv) {
     return e;
 }
 
+RAYX_FN_ACC
+int RAYX_API findEntryIndex(double energy, int table, int material, int count, InvState& inv) {
+    int m = material - 1;  // in [0, 91]
+    int start = inv.matIdx[92 * table + m];
+    int gridStart = inv.matIdx[185 + 92 * table + m];
+    int gridEnd = inv.matIdx[185 + 92 * table + m + 1];
+
+    if (gridStart == gridEnd) {
+        // binary search
+        int low = 0;           // <= energy
+        int high = count - 1;  // >= energy
+        while (high - low > 1) {
+            int center = (low + high) / 2;
+            if (energy < inv.mat[start + 3 * center]) {
+                high = center;
+            } else {
+                low = center;
+            }
+        }
+        return low;
+    }
+
+    // the grid cell of `energy` bounds the entry from below and above: by the entries at the lower ends of this and the next cell. Entries are
+    // not spread evenly in log(E) though (e.g. 18 entries of si.nff fall into a single cell), hence we binary search within these bounds.
+    double logMin = inv.mat[gridStart];
+    double cellsPerLog = inv.mat[gridStart + 1];
+    int cells = int(inv.mat[gridStart + 2]);
+    int cell = energy > 0.0 ? int(glm::clamp((glm::log(energy) - logMin) * cellsPerLog, 0.0, double(cells - 1))) : 0;
+
+    int last = glm::max(count - 2, 0);
+    int low = int(inv.mat[gridStart + 3 + cell]);
+    int high = cell + 1 < cells ? int(inv.mat[gridStart + 3 + cell + 1]) : last;
+
+    // the grid cell may be off by one due to rounding of log(), then the bounds move to the neighbouring entries.
+    while (low > 0 && energy < inv.mat[start + 3 * low]) {
+        low--;
+    }
+    while (high < last && inv.mat[start + 3 * (high + 1)] <= energy) {
+        high++;
+    }
+    while (low < high) {
+        int center = (low + high + 1) / 2;
+        if (energy < inv.mat[start + 3 * center]) {
+            high = center - 1;
+        } else {
+            low = center;
+        }
+    }
+    return low;
+}
+
 // returns dvec2 to represent a complex number
 RAYX_FN_ACC
 complex::Complex RAYX_API getRefractiveIndex(double energy, int material, InvState& inv) {
@@ -95,37 +152,15 @@ complex::Complex RAYX_API getRefractiveIndex(double energy, int material, InvSta
         PalikEntry high_entry = getPalikEntry(high, material, inv);
 
         if (low_entry.m_energy <= energy && energy <= high_entry.m_energy) {  // if 'energy' is in range of tha PalikTable
-            // binary search
-            while (high - low > 1) {
-                int center = (low + high) / 2;
-                PalikEntry center_entry = getPalikEntry(center, material, inv);
-                if (energy < center_entry.m_energy) {
-                    high = center;
-                } else {
-                    low = center;
-                }
-            }
-
-            PalikEntry entry = getPalikEntry(low, material, inv);
+            PalikEntry entry = getPalikEntry(findEntryIndex(energy, 0, material, high + 1, inv), material, inv);
             return complex::Complex(entry.m_n, entry.m_k);
         }
     }
 
     // get refractive index with Nff table
-    if (getNffEntryCount(material, inv) > 0) {           // don't try binary search if there are 0 entries!
-        int low = 0;                                     // <= energy
-        int high = getNffEntryCount(material, inv) - 1;  // >= energy
-
-        // binary search
-        while (high - low > 1) {
-            int center = (low + high) / 2;
-            NffEntry center_entry = getNffEntry(center, material, inv);
-            if (energy < center_entry.m_energy) {
-                high = center;
-            } else {
-                low = center;
-            }
-        }
+    int nffCount = getNffEntryCount(material, inv);
+    if (nffCount > 0) {  // don't try to look up entries if there are 0 entries!
+        int low = findEntryIndex(energy, 1, material, nffCount, inv);
 
         // compute n, k from the Nff data.
         glm::dvec2 massAndRho = getAtomicMassAndRho(material);
@@ -33,6 +33,10 @@ RAYX_FN_ACC PalikEntry RAYX_API getPalikEntry(int index, int material, InvState&
 
 RAYX_FN_ACC NffEntry RAYX_API getNffEntry(int index, int material, InvState& inv);
 
+// Returns the index of the last entry with energy <= `energy` in [0, count - 2] (or 0) of the Palik (table = 0) or Nff (table = 1) table of
+// `material`, where `count` is the number of entries. Uses the lookup grid of the table, if there is one.
+RAYX_FN_ACC int RAYX_API findEntryIndex(double energy, int table, int material, int count, InvState& inv);
+
 // returns dvec2 to represent a complex number
 RAYX_FN_ACC complex::Complex RAYX_API getRefractiveIndex(double energy, int material, InvState& inv);
 
@@ -1,13 +1,14 @@
 #include "SphericalCoords.h"
 
+#include "Utils.h"
+
 namespace RAYX {
 
 RAYX_FN_ACC
 void RAYX_API sphericalCoordsToDirection(double phi, double psi, glm::dvec3& out_direction) {
-    double cos_psi = glm::cos(psi);
-    double cos_phi = glm::cos(phi);
-    double sin_psi = glm::sin(psi);
-    double sin_phi = glm::sin(phi);
+    double sin_psi, cos_psi, sin_phi, cos_phi;
+    sinCos(psi, sin_psi, cos_psi);
+    sinCos(phi, sin_phi, cos_phi);
 
     out_direction = glm::dvec3(cos_psi * sin_phi, cos_psi * cos_phi, -sin_psi);
 }
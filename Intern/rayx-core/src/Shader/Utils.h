@@ -19,6 +19,26 @@ inline Ray RAYX_API rayMatrixMult(Ray r, const glm::dmat4 m) {
     return r;
 }
 
+// same as above, for an affine transformation given by its upper 3x4 part (see ElementRecord)
+RAYX_FN_ACC
+inline Ray RAYX_API rayMatrixMult(Ray r, const glm::dmat4x3 m) {
+    r.m_position = m * glm::dvec4(r.m_position, 1);
+    r.m_direction = m * glm::dvec4(r.m_direction, 0);
+    return r;
+}
+
+// computes sin(x) and cos(x) at once.
+RAYX_FN_ACC
+inline void sinCos(double x, double& out_sin, double& out_cos) {
+#if defined(__CUDA_ARCH__)
+    ::sincos(x, &out_sin, &out_cos);
+#else
+    // compilers merge these into a single sincos call.
+    out_sin = glm::sin(x);
+    out_cos = glm::cos(x);
+#endif
+}
+
 // returns angle between ray direction and surface normal at intersection point
 RAYX_FN_ACC double RAYX_API getIncidenceAngle(Ray r, glm::dvec3 normal);
 
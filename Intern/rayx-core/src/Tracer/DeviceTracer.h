@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cstring>
+#include <functional>
+#include <optional>
 
+#include "Beamline/SourceAcceptance.h"
 #include "Core.h"
 #include "Shader/InvocationState.h"
 
@@ -22,6 +25,11 @@ using RayHistory = std::vector<Ray>;
 /// hist[i][j] is the j'th event of the i'th ray of the bundle.
 using BundleHistory = std::vector<RayHistory>;
 
+/// Receives the BundleHistory of each traced batch, as soon as the batch is done.
+/// The ray-ids of a batch continue those of the previous batch.
+/// The batch is passed by value, so that the receiver can take it over without copying (the tracer moves it in).
+using BatchCallback = std::function<void(BundleHistory)>;
+
 /**
  * @brief DeviceTracer is an interface to a tracer implementation
  * we use this interface to remove the actual implementation from the rayx api
@@ -30,11 +38,16 @@ class RAYX_API DeviceTracer {
   public:
     virtual ~DeviceTracer() = default;
 
+    // if `onBatch` is set, the batches are passed to it instead of being collected into the returned BundleHistory, which is empty then.
     virtual BundleHistory trace(const Beamline&, Sequential sequential, uint64_t max_batch_size, int THREAD_COUNT = 1, uint32_t maxEvents = 1,
-                                int startEventID = 0) = 0;
+                                int startEventID = 0, const BatchCallback& onBatch = {}) = 0;
+
+    // the source acceptance of the last trace, if its source rays were culled. See Beamline::m_cullSourceRays
+    const std::optional<SourceAcceptance>& sourceAcceptance() const { return m_sourceAcceptance; }
 
   protected:
     PushConstants m_pushConstants;
+    std::optional<SourceAcceptance> m_sourceAcceptance;
 };
 
 }  // namespace RAYX
@@ -0,0 +1,72 @@
+#include "RayOrder.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "Debug/Instrumentor.h"
+
+namespace RAYX {
+
+uint64_t mortonCode(const double (&point)[6]) {
+    constexpr uint64_t maxCell = (uint64_t(1) << MORTON_BITS_PER_DIM) - 1;
+
+    uint64_t cells[6];
+    for (int d = 0; d < 6; d++) {
+        // NaN is sorted to the first cell.
+        const double p = std::clamp(point[d], 0.0, 1.0);
+        cells[d] = p == p ? static_cast<uint64_t>(p * maxCell) : 0;
+    }
+
+    uint64_t code = 0;
+    for (int bit = MORTON_BITS_PER_DIM - 1; bit >= 0; bit--) {
+        for (int d = 0; d < 6; d++) {
+            code = (code << 1) | ((cells[d] >> bit) & 1);
+        }
+    }
+    return code;
+}
+
+std::vector<int> mortonOrder(std::span<const Ray> rays) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    const auto n = static_cast<int64_t>(rays.size());
+
+    // bounding box of positions and directions.
+    double lo[6];
+    double hi[6];
+    std::fill(std::begin(lo), std::end(lo), std::numeric_limits<double>::infinity());
+    std::fill(std::begin(hi), std::end(hi), -std::numeric_limits<double>::infinity());
+    for (const auto& r : rays) {
+        for (int k = 0; k < 3; k++) {
+            lo[k] = std::min(lo[k], r.m_position[k]);
+            hi[k] = std::max(hi[k], r.m_position[k]);
+            lo[k + 3] = std::min(lo[k + 3], r.m_direction[k]);
+            hi[k + 3] = std::max(hi[k + 3], r.m_direction[k]);
+        }
+    }
+    double scale[6];
+    for (int d = 0; d < 6; d++) {
+        // dimensions without extent (or without finite extent) don't contribute to the order.
+        const double extent = hi[d] - lo[d];
+        scale[d] = extent > 0.0 && extent < std::numeric_limits<double>::infinity() ? 1.0 / extent : 0.0;
+    }
+
+    std::vector<uint64_t> codes(rays.size());
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; i++) {
+        const Ray& r = rays[i];
+        const double point[6] = {
+            (r.m_position.x - lo[0]) * scale[0],  (r.m_position.y - lo[1]) * scale[1],  (r.m_position.z - lo[2]) * scale[2],
+            (r.m_direction.x - lo[3]) * scale[3], (r.m_direction.y - lo[4]) * scale[4], (r.m_direction.z - lo[5]) * scale[5],
+        };
+        codes[i] = mortonCode(point);
+    }
+
+    std::vector<int> order(rays.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&codes](int a, int b) { return codes[a] < codes[b]; });
+    return order;
+}
+
+}  // namespace RAYX
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Core.h"
+#include "Shader/Ray.h"
+
+namespace RAYX {
+
+/**
+ * Coherence sorting of the input rays of a batch.
+ *
+ * Rays are traced in generation order, hence neighbouring threads often hit different elements. Sorting the rays by a Morton code of their
+ * quantized position and direction groups similar rays, which take the same path through the beamline. This improves the coherence of GPU
+ * warps and the cache reuse of the element and material buffers on the CPU.
+ *
+ * The input rays are not reordered. Instead, thread i traces the input ray rayOrder[i] (see InvState::rayOrder), and every ray keeps its
+ * ray-id, its random numbers and its output slots. Hence the results are identical to tracing in generation order.
+ */
+
+// bits per dimension of the Morton code. 6 dimensions (position and direction) fit into 64 bits.
+constexpr int MORTON_BITS_PER_DIM = 10;
+
+// the Morton code of a point in [0, 1]^6.
+RAYX_API uint64_t mortonCode(const double (&point)[6]);
+
+// returns the indices of `rays`, sorted by the Morton code of their position and direction, quantized within the bounding box of `rays`.
+// Rays with equal codes keep their order.
+RAYX_API std::vector<int> mortonOrder(std::span<const Ray> rays);
+
+}  // namespace RAYX
@@ -4,13 +4,19 @@
 #include <cstring>
 
 #include "Beamline/Beamline.h"
+#include "Beamline/SourceAcceptance.h"
 #include "DeviceTracer.h"
+#include "Element/DiffractionTables.h"
 #include "Gather.h"
+#include "Material/FresnelTableBuilder.h"
 #include "Material/Material.h"
 #include "RAY-Core.h"
 #include "Random.h"
 #include "Scan.h"
+#include "RayOrder.h"
 #include "Shader/DynamicElements.h"
+#include "Shader/Helper.h"
+#include "Shader/RayPacket.h"
 #include "Util.h"
 
 namespace {
@@ -21,7 +27,17 @@ struct DynamicElementsKernel {
         using Idx = alpaka::Idx<Acc>;
         const Idx gid = alpaka::getIdx<alpaka::Grid, alpaka::Threads>(acc)[0];
 
-        if (gid < static_cast<Idx>(inv.inputRays.size())) dynamicElements(gid, inv);
+        if (gid < static_cast<Idx>(inv.inputRays.size())) dynamicElements(RAYX::orderedRayIndex(gid, inv), inv);
+    }
+};
+
+struct DynamicElementsPacketKernel {
+    template <typename Acc>
+    RAYX_FN_ACC void operator()(const Acc& acc, RAYX::InvState inv) const {
+        using Idx = alpaka::Idx<Acc>;
+        const Idx gid = alpaka::getIdx<alpaka::Grid, alpaka::Threads>(acc)[0];
+
+        if (gid * RAYX::RAY_PACKET_SIZE < static_cast<Idx>(inv.inputRays.size())) dynamicElementsPacket(gid, inv);
     }
 };
 
@@ -49,7 +65,7 @@ class SimpleTracer : public DeviceTracer {
     SimpleTracer(int deviceIndex);
 
     BundleHistory trace(const Beamline&, Sequential sequential, uint64_t maxBatchSize, int getInputRaysThreadCount, uint32_t maxEvents,
-                        int startEventID) override;
+                        int startEventID, const BatchCallback& onBatch) override;
 
   private:
     struct TraceResult {
@@ -70,15 +86,19 @@ class SimpleTracer : public DeviceTracer {
 
     /// BeamlineInput contains beamline data, that is constant across all batches
     struct BeamlineInput {
-        Buffer<Element> elements;
+        Buffer<ElementRecord> elementRecords;
         Buffer<int> materialIndices;
         Buffer<double> materialData;
+        Buffer<double> fresnelTables;
+        Buffer<double> diffractionTables;
     } m_beamlineInput;
 
     /// BatchINput contains data corresponding to a single batch
     /// The data is stored on the accelerator device
     struct BatchInput {
         Buffer<Ray> rays;
+        Buffer<int> rayOrder;
+        Buffer<int64_t> rayIds;
     } m_batchInput;
 
     /// BatchOutput contains data corresponding to a single batch
@@ -117,7 +137,7 @@ class SimpleTracer : public DeviceTracer {
     template <typename T>
     std::span<T> bufferToSpan(Buffer<T>& buffer);
 
-    TraceResult traceBatch(Queue q, const Idx numInputRays);
+    TraceResult traceBatch(Queue q, const Idx numInputRays, bool tracePackets);
 };
 
 template <typename Acc>
@@ -125,9 +145,10 @@ SimpleTracer<Acc>::SimpleTracer(int deviceIndex) : m_deviceIndex(deviceIndex) {}
 
 template <typename Acc>
 BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64_t maxBatchSize, int getInputRaysThreadCount, uint32_t maxEvents,
-                                       int startEventID) {
+                                       int startEventID, const BatchCallback& onBatch) {
     RAYX_PROFILE_FUNCTION_STDOUT();
     RAYX_VERB << "maxEvents: " << maxEvents;
+    m_sourceAcceptance.reset();
 
     // don't trace if there are no optical elements
     if (b.m_DesignElements.size() == 0) {
@@ -144,8 +165,21 @@ BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64
         return elements;
     };
     const auto elements = extractElements();
-    const auto rays = b.getInputRays(getInputRaysThreadCount);
+    std::vector<ElementRecord> elementRecords;
+    elementRecords.reserve(elements.size());
+    for (const auto& e : elements) elementRecords.push_back(makeElementRecord(e));
+    auto rays = b.getInputRays(getInputRaysThreadCount);
+    if (seq == Sequential::Yes && b.m_cullSourceRays) {
+        m_sourceAcceptance = cullSourceRays(rays, elements[0], b.m_DesignSources.size());
+        m_sourceAcceptance->log();
+    }
+    // the number of rays before culling, the ray-ids are in [0, numRays).
+    const uint64_t numRays = m_sourceAcceptance ? m_sourceAcceptance->numberOfRays() : rays.size();
     const auto materialTables = b.calcMinimalMaterialTables();
+    // without tables, the buffer only holds the offset -1 for every element.
+    const auto fresnelTables = b.m_cacheFresnelCoefficients ? buildFresnelTables(elements, materialTables, rays)
+                                                            : std::vector<double>(elements.size(), -1.0);
+    const auto diffractionTables = b.m_tabulateDiffraction ? buildDiffractionTables(elements) : std::vector<double>(elements.size(), -1.0);
     const auto randomSeed = randomDouble();
 
     const auto cpu = getDevice<Cpu>(0);
@@ -159,13 +193,17 @@ BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64
     resizeBufferIfNeeded(q, m_batchOutput.compactEventCounts, firstBatchSize);
     resizeBufferIfNeeded(q, m_batchOutput.compactEventOffsets, firstBatchSize);
     resizeBufferIfNeeded(q, m_batchOutput.events, maxOutputEventsCount);
-    transferToBuffer(q, cpu, m_beamlineInput.elements, elements, static_cast<Idx>(elements.size()));
+    transferToBuffer(q, cpu, m_beamlineInput.elementRecords, elementRecords, static_cast<Idx>(elementRecords.size()));
     transferToBuffer(q, cpu, m_beamlineInput.materialIndices, materialTables.indexTable, static_cast<Idx>(materialTables.indexTable.size()));
     transferToBuffer(q, cpu, m_beamlineInput.materialData, materialTables.materialTable, static_cast<Idx>(materialTables.materialTable.size()));
+    transferToBuffer(q, cpu, m_beamlineInput.fresnelTables, fresnelTables, static_cast<Idx>(fresnelTables.size()));
+    transferToBuffer(q, cpu, m_beamlineInput.diffractionTables, diffractionTables, static_cast<Idx>(diffractionTables.size()));
 
     // This will be the complete BundleHistory.
     // All initialized events will have been put into this by the end of this function.
     BundleHistory result;
+    // the ray-id of the next RayHistory to be passed on. The rays rejected by cullSourceRays are passed on without events.
+    uint64_t nextRayId = 0;
 
     // iterate over all batches.
     for (int batch_id = 0; batch_id * maxBatchSize < rays.size(); batch_id++) {
@@ -181,7 +219,7 @@ BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64
 
         const auto sequential = (double)(seq == Sequential::Yes);
         m_pushConstants = {.rayIdStart = (double)rayIdStart,
-                           .numRays = (double)rays.size(),
+                           .numRays = (double)numRays,
                            .randomSeed = randomSeed,
                            .maxEvents = (double)maxEvents,
                            .sequential = sequential,
@@ -189,9 +227,17 @@ BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64
 
         const auto inputRays = rays.data() + rayIdStart;
         transferToBuffer(q, cpu, m_batchInput.rays, inputRays, static_cast<Idx>(batchSize));
+        // without sorting, the buffer only holds -1.
+        const auto rayOrder = b.m_sortRays ? mortonOrder(std::span<const Ray>(inputRays, batchSize)) : std::vector<int>{-1};
+        transferToBuffer(q, cpu, m_batchInput.rayOrder, rayOrder, static_cast<Idx>(rayOrder.size()));
+        // without culling, the ray-ids follow from rayIdStart and the buffer only holds -1.
+        const auto rayIds = m_sourceAcceptance ? std::vector<int64_t>(m_sourceAcceptance->m_rayIds.begin() + rayIdStart,
+                                                                      m_sourceAcceptance->m_rayIds.begin() + rayIdStart + batchSize)
+                                               : std::vector<int64_t>{-1};
+        transferToBuffer(q, cpu, m_batchInput.rayIds, rayIds, static_cast<Idx>(rayIds.size()));
 
         // run the actual tracer (GPU/CPU).
-        const auto traceResult = traceBatch(q, numInputRays);
+        const auto traceResult = traceBatch(q, numInputRays, b.m_traceRayPackets);
         RAYX_LOG << "Traced " << traceResult.totalEventsCount << " events.";
 
         transferFromBuffer(q, cpu, m_batchResult.compactEventCounts, m_batchOutput.compactEventCounts, static_cast<Idx>(numInputRays));
@@ -200,18 +246,34 @@ BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64
 
         alpaka::wait(q);
 
-        // put all events from the rawBatch to unified `BundleHistory result`.
+        // put all events from the rawBatch to unified `BundleHistory result`, or pass them on batch by batch.
         {
             RAYX_PROFILE_SCOPE_STDOUT("BundleHistory-calculation");
+            BundleHistory batchResult;
+            BundleHistory& out = onBatch ? batchResult : result;
             for (uint32_t i = 0; i < batchSize; i++) {
+                const uint64_t id = m_sourceAcceptance ? static_cast<uint64_t>(rayIds[i]) : rayIdStart + i;
+                out.resize(out.size() + (id - nextRayId));
+                nextRayId = id + 1;
+
                 // We now create the Rayhistory for the `i`th ray of the batch:
                 auto begin = m_batchResult.compactEvents.data() + m_batchResult.compactEventOffsets[i];
                 auto end = begin + m_batchResult.compactEventCounts[i];
                 auto hist = RayHistory(begin, end);
 
                 // We put the `hist` for the `i`th ray of the batch into the global `BundleHistory result`.
-                result.push_back(hist);
+                out.push_back(std::move(hist));
             }
+            if (onBatch) onBatch(std::move(batchResult));
+        }
+    }
+
+    // the rejected rays after the last accepted ray.
+    if (nextRayId < numRays) {
+        if (onBatch) {
+            onBatch(BundleHistory(numRays - nextRayId));
+        } else {
+            result.resize(numRays);
         }
     }
 
@@ -219,7 +281,7 @@ BundleHistory SimpleTracer<Acc>::trace(const Beamline& b, Sequential seq, uint64
 }
 
 template <typename Acc>
-SimpleTracer<Acc>::TraceResult SimpleTracer<Acc>::traceBatch(Queue q, const Idx numInputRays) {
+SimpleTracer<Acc>::TraceResult SimpleTracer<Acc>::traceBatch(Queue q, const Idx numInputRays, bool tracePackets) {
     RAYX_PROFILE_FUNCTION_STDOUT();
 
     // reference resources
@@ -233,11 +295,15 @@ SimpleTracer<Acc>::TraceResult SimpleTracer<Acc>::traceBatch(Queue q, const Idx
 
         // buffers
         .inputRays = bufferToSpan(m_batchInput.rays),
+        .rayOrder = bufferToSpan(m_batchInput.rayOrder),
+        .rayIds = bufferToSpan(m_batchInput.rayIds),
         .outputRays = bufferToSpan(m_batchOutput.events),
         .outputRayCounts = bufferToSpan(m_batchOutput.compactEventCounts),
-        .elements = bufferToSpan(m_beamlineInput.elements),
+        .elementRecords = bufferToSpan(m_beamlineInput.elementRecords),
         .matIdx = bufferToSpan(m_beamlineInput.materialIndices),
         .mat = bufferToSpan(m_beamlineInput.materialData),
+        .fresnelTables = bufferToSpan(m_beamlineInput.fresnelTables),
+        .diffractionTables = bufferToSpan(m_beamlineInput.diffractionTables),
 
 #ifdef RAYX_DEBUG_MODE
         .d_struct = {},
@@ -248,7 +314,17 @@ SimpleTracer<Acc>::TraceResult SimpleTracer<Acc>::traceBatch(Queue q, const Idx
 
     // execute dynamic elements shader
 
-    alpaka::exec<Acc>(q, getWorkDivForAcc<Acc>(numInputRays), DynamicElementsKernel{}, inv);
+    // packets are only traced on the CPU, where their collisions are computed in SIMD lanes. See Shader/RayPacket.h
+    if constexpr (std::is_same_v<alpaka::Dev<Acc>, alpaka::DevCpu>) {
+        if (tracePackets) {
+            const auto numPackets = static_cast<Idx>((numInputRays + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE);
+            alpaka::exec<Acc>(q, getWorkDivForAcc<Acc>(numPackets), DynamicElementsPacketKernel{}, inv);
+        } else {
+            alpaka::exec<Acc>(q, getWorkDivForAcc<Acc>(numInputRays), DynamicElementsKernel{}, inv);
+        }
+    } else {
+        alpaka::exec<Acc>(q, getWorkDivForAcc<Acc>(numInputRays), DynamicElementsKernel{}, inv);
+    }
 
     // make output events compact
 
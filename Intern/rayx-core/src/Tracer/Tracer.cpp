@@ -54,8 +54,8 @@ Tracer::Tracer(const DeviceConfig& deviceConfig) {
 }
 
 BundleHistory Tracer::trace(const Beamline& beamline, Sequential sequential, uint64_t max_batch_size, int THREAD_COUNT, uint32_t maxEvents,
-                            int startEventID) {
-    return m_deviceTracer->trace(beamline, sequential, max_batch_size, THREAD_COUNT, maxEvents, startEventID);
+                            int startEventID, const BatchCallback& onBatch) {
+    return m_deviceTracer->trace(beamline, sequential, max_batch_size, THREAD_COUNT, maxEvents, startEventID, onBatch);
 }
 
 /// Get the last event for each ray of the bundle.
@@ -27,11 +27,15 @@ class RAYX_API Tracer {
     // This will call the trace implementation of a subclass
     // See `BundleHistory` for information about the return value.
     // `max_batch_size` corresponds to the maximal number of rays that will be put into `traceRaw` in one batch.
+    // If `onBatch` is set, each batch is passed to it as soon as it is traced, and the returned BundleHistory is empty.
     BundleHistory trace(const Beamline&, Sequential sequential, uint64_t max_batch_size, int THREAD_COUNT = 1, uint32_t maxEvents = 1,
-                        int startEventID = 0);
+                        int startEventID = 0, const BatchCallback& onBatch = {});
 
     static int defaultMaxEvents(const Beamline* beamline = nullptr);
 
+    // the source acceptance of the last trace, if its source rays were culled. See SourceAcceptance.h
+    const std::optional<SourceAcceptance>& sourceAcceptance() const { return m_deviceTracer->sourceAcceptance(); }
+
   private:
     std::shared_ptr<DeviceTracer> m_deviceTracer;
 };
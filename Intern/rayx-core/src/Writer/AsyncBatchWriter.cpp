@@ -0,0 +1,66 @@
+#include "AsyncBatchWriter.h"
+
+#include <algorithm>
+#include <utility>
+
+AsyncBatchWriter::AsyncBatchWriter(RAYX::BatchCallback write, size_t capacity)
+    : m_write(std::move(write)), m_capacity(std::max<size_t>(capacity, 1)), m_thread(&AsyncBatchWriter::run, this) {}
+
+AsyncBatchWriter::~AsyncBatchWriter() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_done = true;
+        }
+        m_pushed.notify_one();
+        m_thread.join();
+    }
+}
+
+void AsyncBatchWriter::push(RAYX::BundleHistory batch) {
+    std::unique_lock lock(m_mutex);
+    // after an error, the remaining batches are dropped.
+    m_popped.wait(lock, [&] { return m_queue.size() + (m_writing ? 1 : 0) < m_capacity || m_error; });
+    if (m_error) return;
+    m_queue.push_back(std::move(batch));
+    lock.unlock();
+    m_pushed.notify_one();
+}
+
+void AsyncBatchWriter::finish() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_done = true;
+    }
+    m_pushed.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+void AsyncBatchWriter::run() {
+    while (true) {
+        std::unique_lock lock(m_mutex);
+        m_pushed.wait(lock, [&] { return !m_queue.empty() || m_done; });
+        if (m_queue.empty()) return;
+
+        RAYX::BundleHistory batch = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_writing = true;
+        lock.unlock();
+        try {
+            m_write(std::move(batch));
+        } catch (...) {
+            lock.lock();
+            m_error = std::current_exception();
+            m_writing = false;
+            m_queue.clear();
+            m_popped.notify_one();
+            return;
+        }
+
+        lock.lock();
+        m_writing = false;
+        lock.unlock();
+        m_popped.notify_one();
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "Tracer/DeviceTracer.h"
+
+/**
+ * @brief Writes traced batches on a dedicated thread, so that writing the output overlaps with tracing the next batches.
+ *
+ * The batches are handed over through a bounded queue: push() only blocks if `capacity` batches are still waiting to be written,
+ * which bounds the memory to `capacity` batches in flight. `write` is called on the writer thread, once for every batch in the
+ * order in which they were pushed. The batches are moved through the queue into `write`, they are never copied.
+ * Errors of `write` have to be thrown as exceptions, they are rethrown by finish().
+ */
+class RAYX_API AsyncBatchWriter {
+  public:
+    explicit AsyncBatchWriter(RAYX::BatchCallback write, size_t capacity = 2);
+    // finishes writing, see finish().
+    ~AsyncBatchWriter();
+
+    AsyncBatchWriter(const AsyncBatchWriter&) = delete;
+    AsyncBatchWriter& operator=(const AsyncBatchWriter&) = delete;
+
+    void push(RAYX::BundleHistory batch);
+
+    // waits until all pushed batches are written. Rethrows an exception thrown by `write`.
+    void finish();
+
+  private:
+    void run();
+
+    RAYX::BatchCallback m_write;
+    size_t m_capacity;
+
+    std::mutex m_mutex;
+    // signals the writer thread that a batch is waiting or the writer is done.
+    std::condition_variable m_pushed;
+    // signals push() that the queue has space again.
+    std::condition_variable m_popped;
+    std::deque<RAYX::BundleHistory> m_queue;
+    // whether the writer thread is writing a batch, which counts against the capacity.
+    bool m_writing = false;
+    bool m_done = false;
+    std::exception_ptr m_error;
+
+    std::thread m_thread;
+};
@@ -1,10 +1,13 @@
 #include "CSVWriter.h"
 
+#include <charconv>
 #include <cstring>
 #include <fstream>
-#include <sstream>
+#include <stdexcept>
 
 #include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+#include "MappedFile.h"
 
 // writer:
 
@@ -17,6 +20,14 @@ struct Cell {
     char buf[CELL_SIZE + 1];  // + 1 for null-termination.
 };
 
+// the number of characters of a cell, without its null-termination.
+const int CELL_WIDTH = CELL_SIZE - 1;
+
+// the rays of a chunk are formatted by a single thread.
+constexpr size_t CSV_CHUNK_RAYS = 1 << 12;
+// the number of chunks which are formatted in parallel, before they are written in order.
+constexpr size_t CSV_CHUNKS_PER_ROUND = 64;
+
 using std::min;
 
 // Tries to write a string into a cell.
@@ -39,121 +50,284 @@ Cell strToCell(const char* x) {
     return out;
 }
 
-// Formats a double into a cell.
-Cell doubleToCell(double x) {
-    std::stringstream ss;
-    ss.setf(std::ios::fixed);
+// Formats a double into a cell: fixed notation with CELL_SIZE decimals, cut or padded with spaces to CELL_WIDTH characters.
+void appendFixedCell(std::string& out, double x) {
+    // a double has at most 309 digits before the decimal point.
+    char buf[320 + CELL_SIZE];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::fixed, CELL_SIZE);
+    const int n = ec == std::errc() ? int(end - buf) : 0;
 
-    ss.precision(CELL_SIZE);
-    std::string s;
-    ss << x;
-    ss >> s;
+    out.append(buf, min(n, CELL_WIDTH));
+    if (n < CELL_WIDTH) out.append(CELL_WIDTH - n, ' ');
+}
+
+// Formats a double with the fewest characters which still read back to exactly the same double.
+void appendCompactCell(std::string& out, double x) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), x);
+    out.append(buf, end);
+}
 
-    // remove digits which do not fit.
-    while (s.size() > CELL_SIZE) {
-        s.pop_back();
+// Formats the events of the rays [begin, end) into `out`, one line per event. The ray-ids start at `firstRayId` for hist[0].
+void formatRays(const RAYX::BundleHistory& hist, size_t begin, size_t end, uint64_t firstRayId, const Format& format, int startEventID,
+                CSVStyle style, std::string& out) {
+    size_t events = 0;
+    for (size_t ray_id = begin; ray_id < end; ray_id++) events += hist[ray_id].size();
+    out.reserve(events * format.size() * (style == CSVStyle::FixedWidth ? CELL_SIZE : 16));
+
+    const FormatConverter converter(format);
+    std::vector<double> rows;
+    for (size_t ray_id = begin; ray_id < end; ray_id++) {
+        const RAYX::RayHistory& ray_hist = hist[ray_id];
+        rows.resize(ray_hist.size() * format.size());
+        converter.toRows(ray_hist, static_cast<uint32_t>(firstRayId + ray_id), static_cast<uint32_t>(startEventID), rows.data());
+
+        for (size_t event_id = 0; event_id < ray_hist.size(); event_id++) {
+            for (uint32_t i = 0; i < format.size(); i++) {
+                if (i > 0) {
+                    out.push_back(DELIMITER);
+                }
+                const double d = rows[event_id * format.size() + i];
+                if (style == CSVStyle::FixedWidth) {
+                    appendFixedCell(out, d);
+                } else {
+                    appendCompactCell(out, d);
+                }
+            }
+            out.push_back('\n');
+        }
     }
-    return strToCell(s.c_str());
 }
 
-void writeCSV(const RAYX::BundleHistory& hist, const std::string& filename, const Format& format, int startEventID) {
-    std::ofstream file(filename);
+CSVStreamWriter::CSVStreamWriter(const std::string& filename, const Format& format, int startEventID, CSVStyle style)
+    : m_filename(filename), m_file(filename), m_format(format), m_startEventID(startEventID), m_style(style), m_buffers(CSV_CHUNKS_PER_ROUND) {
+    if (!m_file) {
+        RAYX_EXIT << "could not open " << filename;
+    }
 
     // write the header of the CSV file:
-    for (uint32_t i = 0; i < format.size(); i++) {
+    for (uint32_t i = 0; i < m_format.size(); i++) {
         if (i > 0) {
-            file << DELIMITER;
+            m_file << DELIMITER;
         }
-        file << strToCell(format[i].name).buf;
+        m_file << (m_style == CSVStyle::FixedWidth ? strToCell(m_format[i].name).buf : m_format[i].name);
     }
-    file << '\n';
+    m_file << '\n';
+}
 
-    RAYX_VERB << "Writing " << hist.size() << " rays to file...";
+void CSVStreamWriter::append(const RAYX::BundleHistory& batch) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
 
-    // write the body of the CSV file:
-    for (uint64_t ray_id = 0; ray_id < hist.size(); ray_id++) {
-        const RAYX::RayHistory& ray_hist = hist[ray_id];
-        for (size_t event_id = 0; event_id < ray_hist.size(); event_id++) {
-            const RAYX::Ray& event = ray_hist[event_id];
-            for (uint32_t i = 0; i < format.size(); i++) {
-                if (i > 0) {
-                    file << DELIMITER;
-                }
-                double d = format[i].get_double(static_cast<uint32_t>(ray_id), static_cast<int>(event_id) + startEventID, event);
-                file << doubleToCell(d).buf;
-            }
-            file << '\n';
+    // write the body of the CSV file: the chunks of a round are formatted in parallel, and then written in order.
+    const size_t numChunks = (batch.size() + CSV_CHUNK_RAYS - 1) / CSV_CHUNK_RAYS;
+    for (size_t first = 0; first < numChunks; first += CSV_CHUNKS_PER_ROUND) {
+        const int n = static_cast<int>(min(CSV_CHUNKS_PER_ROUND, numChunks - first));
+
+#pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < n; c++) {
+            const size_t begin = (first + c) * CSV_CHUNK_RAYS;
+            const size_t end = min(begin + CSV_CHUNK_RAYS, batch.size());
+            m_buffers[c].clear();
+            formatRays(batch, begin, end, m_numberOfRays, m_format, m_startEventID, m_style, m_buffers[c]);
         }
+
+        for (int c = 0; c < n; c++) {
+            m_file.write(m_buffers[c].data(), static_cast<std::streamsize>(m_buffers[c].size()));
+        }
+    }
+    m_numberOfRays += batch.size();
+
+    // append() runs on the writer thread of AsyncBatchWriter, so it throws instead of exiting.
+    if (!m_file) {
+        throw std::runtime_error("could not write " + m_filename);
+    }
+}
+
+void CSVStreamWriter::finish() {
+    m_file.close();
+    if (!m_file) {
+        throw std::runtime_error("could not write " + m_filename);
+    }
+}
+
+void writeCSV(const RAYX::BundleHistory& hist, const std::string& filename, const Format& format, int startEventID, CSVStyle style) {
+    RAYX_VERB << "Writing " << hist.size() << " rays to file...";
+    CSVStreamWriter writer(filename, format, startEventID, style);
+    try {
+        writer.append(hist);
+        writer.finish();
+    } catch (const std::exception& err) {
+        RAYX_EXIT << err.what();
     }
     RAYX_VERB << "Writing done!";
 }
 
 // loader:
 
-RAYX::BundleHistory loadCSV(const std::string& filename) {
-    std::ifstream file(filename);
+// the lines of a chunk are parsed by a single thread.
+constexpr size_t CSV_LOAD_CHUNK_BYTES = 1 << 20;
 
-    // ignore setup line
-    std::string s;
-    std::getline(file, s);
+// the number of doubles per line after ray-id and event-id: with Stokes parameters (legacy files) or with the electric field (FULL_FORMAT).
+constexpr int CSV_STOKES_VALUES = 16;
+constexpr int CSV_FIELD_VALUES = 18;
+constexpr int CSV_MAX_VALUES = 2 + CSV_FIELD_VALUES;
 
-    RAYX::BundleHistory out;
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
 
-    while (std::getline(file, s)) {
-        std::vector<double> d;
-        std::stringstream ss(s);
-        std::string num;
+// parses the cells of the line [begin, end) into `values`. Returns the number of cells, or -1 if a cell isn't a number.
+int parseLine(const char* begin, const char* end, double* values) {
+    int n = 0;
+    const char* p = begin;
+    while (true) {
+        while (p < end && isBlank(*p)) p++;
+        if (n == CSV_MAX_VALUES) return n + 1;
+        auto [next, ec] = std::from_chars(p, end, values[n]);
+        if (ec != std::errc()) return -1;
+        n++;
+        p = next;
+        while (p < end && isBlank(*p)) p++;
+        if (p == end) return n;
+        if (*p != DELIMITER) return -1;
+        p++;
+    }
+}
 
-        std::getline(ss, num, DELIMITER);
-        uint64_t ray_id = std::stoi(num);
+// builds the event of a line from the doubles after its ray-id and event-id.
+RAYX::Ray rayFromValues(const double* d, int n) {
+    RAYX::ElectricField field;
+    if (n == CSV_STOKES_VALUES) {
+        const auto stokes = glm::dvec4(d[8], d[9], d[10], d[11]);
+        // const auto rotation = glm::transpose(RAYX::rotationMatrix(direction));
+        field = /* rotation *  */ RAYX::stokesToElectricField(stokes);
+    } else {
+        field = RAYX::ElectricField{{d[8], d[9]}, {d[10], d[11]}, {d[12], d[13]}};
+    }
+    const int tail = n - 4;
+
+    return RAYX::Ray{.m_position = {d[0], d[1], d[2]},
+                     .m_eventType = d[3],
+                     .m_direction = glm::dvec3(d[4], d[5], d[6]),
+                     .m_energy = d[7],
+                     .m_field = field,
+                     .m_pathLength = d[tail],
+                     .m_order = d[tail + 1],
+                     .m_lastElement = d[tail + 2],
+                     .m_sourceID = d[tail + 3]};
+}
+
+// returns the end of the line starting at `p`, i.e. the position of its '\n' or `end`.
+const char* lineEnd(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', end - p);
+    return nl ? static_cast<const char*>(nl) : end;
+}
 
-        std::getline(ss, num, DELIMITER);
-        uint64_t event_id = std::stoi(num);
+bool isBlankLine(const char* begin, const char* end) {
+    while (begin < end && isBlank(*begin)) begin++;
+    return begin == end;
+}
 
-        while (std::getline(ss, num, DELIMITER)) {
-            d.push_back(std::stod(num));
+RAYX::BundleHistory loadCSV(const std::string& filename) {
+    MappedFile file(filename, FileAccess::Sequential);
+    if (!file.ok()) {
+        RAYX_EXIT << "loadCSV failed: could not open " << filename;
+    }
+    const char* const end = file.data() + file.size();
+
+    // ignore setup line
+    const char* body = lineEnd(file.data(), end);
+    if (body < end) body++;
+
+    // split the body into chunks of whole lines.
+    std::vector<const char*> chunks = {body};
+    while (chunks.back() < end) {
+        const char* p = chunks.back() + min(CSV_LOAD_CHUNK_BYTES, size_t(end - chunks.back()));
+        if (p < end) p = lineEnd(p, end) + 1;
+        chunks.push_back(min(p, end));
+    }
+    const int numChunks = static_cast<int>(chunks.size()) - 1;
+
+    // count the lines of every chunk, so that each chunk knows where its events go in the flat buffer.
+    std::vector<size_t> firstLine(numChunks + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < numChunks; c++) {
+        size_t lines = 0;
+        for (const char* p = chunks[c]; p < chunks[c + 1];) {
+            const char* e = lineEnd(p, chunks[c + 1]);
+            if (!isBlankLine(p, e)) lines++;
+            p = e + 1;
         }
+        firstLine[c + 1] = lines;
+    }
+    for (int c = 0; c < numChunks; c++) firstLine[c + 1] += firstLine[c];
+    const size_t numLines = firstLine[numChunks];
 
-        if (d.size() != 16) {
-            RAYX_EXIT << "CSV line has incorrect length: " << d.size();
+    // parse all lines in parallel, directly into the flat buffers.
+    std::vector<RAYX::Ray> events(numLines);
+    std::vector<uint64_t> rayIds(numLines);
+    std::vector<uint64_t> eventIds(numLines);
+    // the error of the first malformed line of each chunk, if any.
+    std::vector<std::string> errors(numChunks);
+#pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < numChunks; c++) {
+        size_t line = firstLine[c];
+        double d[CSV_MAX_VALUES];
+        for (const char* p = chunks[c]; p < chunks[c + 1]; p++) {
+            const char* e = lineEnd(p, chunks[c + 1]);
+            if (isBlankLine(p, e)) {
+                p = e;
+                continue;
+            }
+            const int cells = parseLine(p, e, d);
+            const int n = cells - 2;
+            p = e;
+            if (cells < 0) {
+                errors[c] = "loadCSV failed: CSV line contains a cell which is not a number";
+                break;
+            }
+            if (n != CSV_STOKES_VALUES && n != CSV_FIELD_VALUES) {
+                errors[c] = "CSV line has incorrect length: " + std::to_string(n);
+                break;
+            }
+            rayIds[line] = static_cast<uint64_t>(d[0]);
+            eventIds[line] = static_cast<uint64_t>(d[1]);
+            events[line] = rayFromValues(d + 2, n);
+            line++;
+        }
+    }
+    for (const auto& error : errors) {
+        if (!error.empty()) {
+            RAYX_EXIT << error;
         }
+    }
 
-        const auto direction = glm::dvec3(d[4], d[5], d[6]);
+    RAYX::BundleHistory out;
+    // the events of the current ray start at line `rayBegin`, it is only put into `out` once all its events are known.
+    uint64_t numberOfRays = 0;
+    size_t rayBegin = 0;
+    for (size_t line = 0; line < numLines; line++) {
+        const uint64_t ray_id = rayIds[line];
+        const uint64_t event_id = eventIds[line];
 
-        const auto stokes = glm::dvec4(d[8], d[9], d[10], d[11]);
-        // const auto rotation = glm::transpose(RAYX::rotationMatrix(direction));
-        const auto field = /* rotation *  */ RAYX::stokesToElectricField(stokes);
-
-        // create the Ray from the loaded doubles from this line.
-        RAYX::Ray ray = {.m_position = {d[0], d[1], d[2]},
-                         .m_eventType = d[3],
-                         .m_direction = direction,
-                         .m_energy = d[7],
-                         .m_field = field,
-                         .m_pathLength = d[12],
-                         .m_order = d[13],
-                         .m_lastElement = d[14],
-                         .m_sourceID = d[15]};
         // This checks whether `ray_id` is from a "new ray" that didn't yet come up in the BundleHistory.
-        // If so, we need to make place for it.
-        if (out.size() <= ray_id) {
-            out.emplace_back();
+        // If so, the events of the previous ray are complete.
+        if (numberOfRays <= ray_id) {
+            if (numberOfRays > 0) out.emplace_back(events.begin() + rayBegin, events.begin() + line);
+            rayBegin = line;
+            numberOfRays++;
         }
 
         // If the rays are out of order, we crash.
         // This happens for example if we load rays with ray-ids 0, 1, 2, 4, 3.
         // Then when the parser reads the 4, it will consider it out-of-order as it expected a 3.
-        if (ray_id + 1 != out.size()) {
+        if (ray_id + 1 != numberOfRays) {
             RAYX_EXIT << "loadCSV failed: rays out of order";
         }
         // The event-id of the new event should match the number of previous events found for this ray.
-        if (event_id != out[ray_id].size()) {
+        if (event_id != line - rayBegin) {
             RAYX_EXIT << "loadCSV failed: events out of order";
         }
-
-        // put the new event into the BundleHistory.
-        out[ray_id].push_back(ray);
     }
+    if (numberOfRays > 0) out.emplace_back(events.begin() + rayBegin, events.end());
 
     return out;
 }
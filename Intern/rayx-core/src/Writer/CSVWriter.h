@@ -1,5 +1,6 @@
 #pragma once
 
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -8,7 +9,48 @@
 #include "Tracer/Tracer.h"
 #include "Writer/Writer.h"
 
-void RAYX_API writeCSV(const RAYX::BundleHistory&, const std::string& filename, const Format& format, int startEventID = 0);
+// How the cells of a CSV file are formatted.
+enum class CSVStyle {
+    // every cell is padded or cut to the same width, so that the file looks like a grid.
+    FixedWidth,
+    // every cell holds the shortest number which reads back to exactly the written double.
+    Compact,
+};
 
-// loadCSV only works for csv files created using FULL_FORMAT.
+/**
+ * @brief Writes rays into a CSV file batch by batch, while they are traced (see BatchCallback).
+ * The batches have to arrive in ray order, as the ray-ids continue those of the previously appended batches.
+ */
+class RAYX_API CSVStreamWriter {
+  public:
+    CSVStreamWriter(const std::string& filename, const Format& format, int startEventID = 0, CSVStyle style = CSVStyle::FixedWidth);
+
+    CSVStreamWriter(const CSVStreamWriter&) = delete;
+    CSVStreamWriter& operator=(const CSVStreamWriter&) = delete;
+
+    // formats and appends the events of `batch`. Throws std::runtime_error if the events can't be written.
+    void append(const RAYX::BundleHistory& batch);
+
+    // closes the file, once after the last batch was appended. Throws std::runtime_error if the file can't be written.
+    void finish();
+
+    uint64_t numberOfRays() const { return m_numberOfRays; }
+
+  private:
+    std::string m_filename;
+    std::ofstream m_file;
+    Format m_format;
+    int m_startEventID;
+    CSVStyle m_style;
+    uint64_t m_numberOfRays = 0;
+    // the formatted chunks of a round, see append().
+    std::vector<std::string> m_buffers;
+};
+
+// writes all rays at once, see CSVStreamWriter.
+void RAYX_API writeCSV(const RAYX::BundleHistory&, const std::string& filename, const Format& format, int startEventID = 0,
+                       CSVStyle style = CSVStyle::FixedWidth);
+
+// loadCSV only works for csv files created using FULL_FORMAT, or the former full format with Stokes parameters instead of the electric field.
+// The file is memory-mapped and its lines are parsed in parallel.
 RAYX::BundleHistory RAYX_API loadCSV(const std::string& filename);
@@ -0,0 +1,270 @@
+#ifndef NO_H5
+
+#include "H5RayReader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <highfive/H5DataSet.hpp>
+#include <highfive/H5DataSpace.hpp>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+#include <span>
+
+#include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+#include "H5StreamWriter.h"
+
+struct H5RayReader::Impl {
+    HighFive::File m_file;
+    H5Layout m_layout;
+    uint64_t m_numberOfEvents;
+    // only for H5Layout::Columns.
+    uint64_t m_numberOfRays;
+    int m_startEventID;
+    // the `rays` dataset for H5Layout::Rows.
+    std::optional<HighFive::DataSet> m_rows;
+    // for H5Layout::Columns: the dataset of every component of the format, if it was written, and the ray offsets.
+    std::vector<std::optional<HighFive::DataSet>> m_columns;
+    std::optional<HighFive::DataSet> m_rayOffsets;
+};
+
+namespace {
+
+// appends the selected events of the ray `rayId` to `batch`.
+void selectEvents(uint64_t rayId, std::span<const RAYX::Ray> events, const H5RayFilter& filter, H5RayBatch& batch) {
+    RAYX::RayHistory selected;
+    for (const auto& event : events) {
+        if (filter.m_elementId && static_cast<int>(event.m_lastElement) != *filter.m_elementId) continue;
+        if (filter.m_eventType && static_cast<int>(event.m_eventType) != *filter.m_eventType) continue;
+        selected.push_back(event);
+    }
+    if (selected.empty()) return;
+    if (filter.m_lastEventOnly) selected.erase(selected.begin(), selected.end() - 1);
+
+    batch.m_rayIds.push_back(rayId);
+    batch.m_rays.push_back(std::move(selected));
+}
+
+// reads a single value of a two-dimensional dataset.
+double readValue(const HighFive::DataSet& dataset, uint64_t row, size_t column) {
+    double value = 0;
+    dataset.select({row, column}, {1, 1}).read(&value);
+    return value;
+}
+
+}  // unnamed namespace
+
+H5RayReader::H5RayReader(const std::string& filename, const Format& format, uint64_t chunkEvents)
+    : m_format(format), m_converter(format), m_chunkEvents(std::max<uint64_t>(chunkEvents, 1)) {
+    try {
+        HighFive::File file(filename, HighFive::File::ReadOnly);
+        Impl impl{std::move(file), H5Layout::Rows, 0, 0, 0, std::nullopt, {}, std::nullopt};
+
+        if (impl.m_file.exist("columns")) {
+            impl.m_layout = H5Layout::Columns;
+            auto group = impl.m_file.getGroup("columns");
+            group.getAttribute("startEventID").read(impl.m_startEventID);
+
+            impl.m_rayOffsets = group.getDataSet("ray_offsets");
+            const uint64_t offsets = impl.m_rayOffsets->getSpace().getDimensions()[0];
+            if (offsets > 0) {
+                impl.m_numberOfRays = offsets - 1;
+                impl.m_rayOffsets->select({offsets - 1}, {1}).read(&impl.m_numberOfEvents);
+            }
+
+            for (const auto& component : m_format) {
+                if (group.exist(component.name)) {
+                    impl.m_columns.push_back(group.getDataSet(component.name));
+                } else {
+                    RAYX_WARN << "Component \"" << component.name << "\" was not written, ignoring it";
+                    impl.m_columns.push_back(std::nullopt);
+                }
+            }
+        } else {
+            impl.m_rows = impl.m_file.getDataSet("rays");
+            const auto dims = impl.m_rows->getSpace().getDimensions();
+            if (dims.size() != 2 || dims[1] != m_format.size()) {
+                RAYX_EXIT << "The rays of " << filename << " don't match the format with " << m_format.size() << " components";
+            }
+            impl.m_numberOfEvents = dims[0];
+
+            const int eventIdColumn = m_converter.findColumn(FORMAT_EVENT_ID);
+            if (impl.m_numberOfEvents > 0 && eventIdColumn >= 0) {
+                impl.m_startEventID = static_cast<int>(readValue(*impl.m_rows, 0, eventIdColumn));
+            }
+        }
+
+        m_impl = std::make_unique<Impl>(std::move(impl));
+    } catch (HighFive::Exception& err) {
+        RAYX_EXIT << err.what();
+    }
+}
+
+H5RayReader::~H5RayReader() = default;
+
+uint64_t H5RayReader::numberOfEvents() const { return m_impl->m_numberOfEvents; }
+
+int H5RayReader::startEventID() const { return m_impl->m_startEventID; }
+
+void H5RayReader::read(const H5RayFilter& filter, const std::function<void(const H5RayBatch&)>& onBatch) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    // the filters need the components they compare.
+    auto require = [&](int offset, const char* name) {
+        const int column = m_converter.findColumn(offset);
+        if (column < 0 || (m_impl->m_layout == H5Layout::Columns && !m_impl->m_columns[column])) {
+            RAYX_EXIT << "Filtering the rays requires the component \"" << name << "\"";
+        }
+    };
+    if (filter.m_elementId) require(static_cast<int>(offsetof(RAYX::Ray, m_lastElement)), "lastElement");
+    if (filter.m_eventType) require(static_cast<int>(offsetof(RAYX::Ray, m_eventType)), "Event-type");
+
+    try {
+        if (m_impl->m_layout == H5Layout::Rows) {
+            readRows(filter, onBatch);
+        } else {
+            readColumns(filter, onBatch);
+        }
+    } catch (HighFive::Exception& err) {
+        RAYX_EXIT << err.what();
+    }
+}
+
+RAYX::BundleHistory H5RayReader::readAll(const H5RayFilter& filter) {
+    RAYX::BundleHistory rays;
+    read(filter, [&](const H5RayBatch& batch) { rays.insert(rays.end(), batch.m_rays.begin(), batch.m_rays.end()); });
+    return rays;
+}
+
+void H5RayReader::readRows(const H5RayFilter& filter, const std::function<void(const H5RayBatch&)>& onBatch) {
+    const HighFive::DataSet& dataset = *m_impl->m_rows;
+    const size_t columns = m_format.size();
+    const uint64_t numberOfEvents = m_impl->m_numberOfEvents;
+
+    const int rayIdColumn = m_converter.findColumn(FORMAT_RAY_ID);
+    const int eventIdColumn = m_converter.findColumn(FORMAT_EVENT_ID);
+    if (rayIdColumn < 0 && eventIdColumn < 0) {
+        RAYX_EXIT << "Reading the rows of an .h5 file requires the component \"Ray-ID\" or \"Event-ID\"";
+    }
+
+    // the rays are stored in order of their ids, hence the first selected ray is found by a binary search. It searches the chunks first, every
+    // probe reads the Ray-ID column of a whole chunk, and then the last chunk read, without reading it again.
+    uint64_t first = 0;
+    if (rayIdColumn >= 0 && filter.m_firstRay > 0) {
+        const double firstRay = static_cast<double>(filter.m_firstRay);
+        const uint64_t chunks = (numberOfEvents + m_chunkEvents - 1) / m_chunkEvents;
+        std::vector<double> rayIds;
+        uint64_t loadedChunk = chunks;
+        auto loadChunk = [&](uint64_t chunk) {
+            if (chunk == loadedChunk) return;
+            const uint64_t pos = chunk * m_chunkEvents;
+            rayIds.resize(std::min(m_chunkEvents, numberOfEvents - pos));
+            dataset.select({pos, static_cast<size_t>(rayIdColumn)}, {rayIds.size(), 1}).read(rayIds.data());
+            loadedChunk = chunk;
+        };
+
+        // the first chunk, whose last ray-id isn't below the first selected ray.
+        uint64_t low = 0;
+        uint64_t high = chunks;
+        while (low < high) {
+            const uint64_t mid = low + (high - low) / 2;
+            loadChunk(mid);
+            if (rayIds.back() < firstRay) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        first = numberOfEvents;
+        if (low < chunks) {
+            loadChunk(low);
+            first = low * m_chunkEvents + static_cast<uint64_t>(std::lower_bound(rayIds.begin(), rayIds.end(), firstRay) - rayIds.begin());
+        }
+    }
+
+    std::vector<double> rows;
+    std::vector<RAYX::Ray> events;
+    // the events of the current ray, which may continue in the next chunk.
+    RAYX::RayHistory current;
+    uint64_t currentId = 0;
+    bool started = false;
+    bool done = false;
+
+    for (uint64_t pos = first; pos < numberOfEvents && !done; pos += m_chunkEvents) {
+        const uint64_t n = std::min(m_chunkEvents, numberOfEvents - pos);
+        rows.resize(n * columns);
+        events.assign(n, RAYX::Ray{});
+        dataset.select({pos, 0}, {n, columns}).read(rows.data());
+        m_converter.fromRows(rows.data(), events);
+
+        H5RayBatch batch;
+        for (uint64_t i = 0; i < n; i++) {
+            const double* row = rows.data() + i * columns;
+            uint64_t rayId = currentId;
+            if (rayIdColumn >= 0) {
+                rayId = static_cast<uint64_t>(row[rayIdColumn]);
+            } else if (started && row[eventIdColumn] == static_cast<double>(m_impl->m_startEventID)) {
+                // without ray-ids, a ray starts with the start event-id.
+                rayId = currentId + 1;
+            }
+            if (started && rayId != currentId) {
+                if (currentId >= filter.m_firstRay) selectEvents(currentId, current, filter, batch);
+                current.clear();
+            }
+            if (rayId >= filter.m_endRay) {
+                done = true;
+                break;
+            }
+            current.push_back(events[i]);
+            currentId = rayId;
+            started = true;
+        }
+        if (!batch.m_rays.empty()) onBatch(batch);
+    }
+
+    if (!current.empty() && currentId >= filter.m_firstRay) {
+        H5RayBatch batch;
+        selectEvents(currentId, current, filter, batch);
+        if (!batch.m_rays.empty()) onBatch(batch);
+    }
+}
+
+void H5RayReader::readColumns(const H5RayFilter& filter, const std::function<void(const H5RayBatch&)>& onBatch) {
+    Impl& impl = *m_impl;
+    const uint64_t endRay = std::min(filter.m_endRay, impl.m_numberOfRays);
+
+    std::vector<uint64_t> offsets;
+    std::vector<double> values;
+    std::vector<RAYX::Ray> events;
+    for (uint64_t ray = std::min(filter.m_firstRay, endRay); ray < endRay;) {
+        // the offsets of the next rays, a chunk contains at most m_chunkEvents rays.
+        const uint64_t rays = std::min(m_chunkEvents, endRay - ray);
+        offsets.resize(rays + 1);
+        impl.m_rayOffsets->select({ray}, {rays + 1}).read(offsets.data());
+
+        // the rays whose events fit into the chunk, but at least one ray.
+        uint64_t count = 1;
+        while (count < rays && offsets[count + 1] - offsets[0] <= m_chunkEvents) count++;
+
+        const uint64_t firstEvent = offsets[0];
+        const uint64_t n = offsets[count] - firstEvent;
+        events.assign(n, RAYX::Ray{});
+        values.resize(n);
+        for (size_t c = 0; c < m_format.size() && n > 0; c++) {
+            if (!impl.m_columns[c]) continue;
+            impl.m_columns[c]->select({firstEvent}, {n}).read(values.data());
+            m_converter.fromColumn(c, values.data(), events);
+        }
+
+        H5RayBatch batch;
+        const std::span<const RAYX::Ray> chunk(events);
+        for (uint64_t r = 0; r < count; r++) {
+            selectEvents(ray + r, chunk.subspan(offsets[r] - firstEvent, offsets[r + 1] - offsets[r]), filter, batch);
+        }
+        if (!batch.m_rays.empty()) onBatch(batch);
+        ray += count;
+    }
+}
+
+#endif
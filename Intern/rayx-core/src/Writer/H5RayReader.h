@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Tracer/Tracer.h"
+#include "Writer/Writer.h"
+
+// the default number of events which an H5RayReader reads at once.
+constexpr uint64_t H5_READ_CHUNK_EVENTS = 1 << 16;
+
+// Selects the events which an H5RayReader hands out.
+struct H5RayFilter {
+    // only the rays whose ray-id is in [m_firstRay, m_endRay).
+    uint64_t m_firstRay = 0;
+    uint64_t m_endRay = std::numeric_limits<uint64_t>::max();
+    // only the events at this element, see Ray::m_lastElement. Requires the "lastElement" component.
+    std::optional<int> m_elementId;
+    // only the events of this type, see EventType.h. Requires the "Event-type" component.
+    std::optional<int> m_eventType;
+    // only the last event of every ray, which passes the other filters.
+    bool m_lastEventOnly = false;
+};
+
+// The rays of a chunk, which have selected events. Rays without selected events are skipped, hence their ray-ids are listed.
+struct H5RayBatch {
+    std::vector<uint64_t> m_rayIds;
+    RAYX::BundleHistory m_rays;
+};
+
+/**
+ * @brief Reads the rays of an .h5 file (both layouts of H5StreamWriter) chunk by chunk, so that files larger than the memory can be processed.
+ *
+ * Every chunk is a hyperslab of about `chunkEvents` events, only the rays of the current chunk are held in memory.
+ * For H5Layout::Rows, the rays are delimited by the Ray-ID component (or, if the format lacks it, by the Event-ID component), and the first
+ * ray of a ray-id range is found by a binary search. For H5Layout::Columns, the rays are delimited by `ray_offsets`, and only the
+ * components of the format are read.
+ */
+class RAYX_API H5RayReader {
+  public:
+    // `format` is the format which the file was written with. For H5Layout::Columns, it may be any subset of it.
+    H5RayReader(const std::string& filename, const Format& format, uint64_t chunkEvents = H5_READ_CHUNK_EVENTS);
+    ~H5RayReader();
+
+    H5RayReader(const H5RayReader&) = delete;
+    H5RayReader& operator=(const H5RayReader&) = delete;
+
+    uint64_t numberOfEvents() const;
+    int startEventID() const;
+
+    // calls `onBatch` for every chunk with selected events, in order of the ray-ids.
+    void read(const H5RayFilter& filter, const std::function<void(const H5RayBatch&)>& onBatch);
+
+    // collects the selected events of all rays.
+    RAYX::BundleHistory readAll(const H5RayFilter& filter = {});
+
+  private:
+    void readRows(const H5RayFilter& filter, const std::function<void(const H5RayBatch&)>& onBatch);
+    void readColumns(const H5RayFilter& filter, const std::function<void(const H5RayBatch&)>& onBatch);
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+    Format m_format;
+    FormatConverter m_converter;
+    uint64_t m_chunkEvents;
+};
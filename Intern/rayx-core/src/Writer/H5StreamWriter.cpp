@@ -0,0 +1,337 @@
+#ifndef NO_H5
+
+#include "H5StreamWriter.h"
+
+#include <H5Zpublic.h>
+
+#include <algorithm>
+#include <highfive/H5Attribute.hpp>
+#include <highfive/H5DataSet.hpp>
+#include <highfive/H5DataSpace.hpp>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Data/Strings.h"
+#include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+
+// number of events per chunk of the datasets. Events are buffered and written chunk by chunk.
+constexpr size_t H5_STREAM_CHUNK_EVENTS = 1 << 14;
+
+struct H5StreamWriter::Impl {
+    HighFive::File m_file;
+    // the `rays` dataset for H5Layout::Rows, or a dataset per component for H5Layout::Columns.
+    std::vector<HighFive::DataSet> m_datasets;
+    // only for H5Layout::Columns.
+    std::optional<HighFive::DataSet> m_rayOffsets;
+    // number of ray offsets in m_rayOffsets.
+    uint64_t m_writtenRayOffsets = 0;
+};
+
+namespace {
+
+// the ids of the registered HDF5 filter plugins for zstd and LZ4.
+constexpr H5Z_filter_t H5_FILTER_ZSTD = 32015;
+constexpr H5Z_filter_t H5_FILTER_LZ4 = 32004;
+
+// a compression filter of an HDF5 filter plugin, which HighFive doesn't know.
+struct PluginFilter {
+    H5Z_filter_t m_id;
+    std::vector<unsigned int> m_params;
+
+    void apply(hid_t list) const {
+        if (H5Pset_filter(list, m_id, H5Z_FLAG_MANDATORY, m_params.size(), m_params.data()) < 0) {
+            RAYX_EXIT << "could not add the HDF5 filter " << m_id;
+        }
+    }
+};
+
+H5Z_filter_t pluginFilter(H5Codec codec) {
+    switch (codec) {
+        case H5Codec::Zstd:
+            return H5_FILTER_ZSTD;
+        case H5Codec::LZ4:
+            return H5_FILTER_LZ4;
+        default:
+            return H5Z_FILTER_NONE;
+    }
+}
+
+// falls back to deflate, if the filter plugin of the codec is not available.
+H5Compression availableCompression(H5Compression compression) {
+    const H5Z_filter_t filter = pluginFilter(compression.m_codec);
+    if (compression.m_level > 0 && filter != H5Z_FILTER_NONE && H5Zfilter_avail(filter) <= 0) {
+        RAYX_WARN << "The HDF5 filter plugin " << filter << " is not available (see HDF5_PLUGIN_PATH), compressing with deflate instead";
+        compression.m_codec = H5Codec::Deflate;
+        compression.m_level = std::min(compression.m_level, 9);
+    }
+    return compression;
+}
+
+HighFive::DataSetCreateProps createProps(std::vector<hsize_t> chunk, H5Compression compression) {
+    HighFive::DataSetCreateProps props;
+    props.add(HighFive::Chunking(chunk));
+    if (compression.m_level > 0) {
+        if (compression.m_shuffle) props.add(HighFive::Shuffle());
+        switch (compression.m_codec) {
+            case H5Codec::Deflate:
+                props.add(HighFive::Deflate(compression.m_level));
+                break;
+            case H5Codec::Zstd:
+                props.add(PluginFilter{.m_id = H5_FILTER_ZSTD, .m_params = {static_cast<unsigned int>(compression.m_level)}});
+                break;
+            case H5Codec::LZ4:
+                props.add(PluginFilter{.m_id = H5_FILTER_LZ4, .m_params = {}});
+                break;
+        }
+    }
+    return props;
+}
+
+// calls `f` with a value of the C++ type of `type`.
+template <typename F>
+void visitStorageType(StorageType type, F&& f) {
+    switch (type) {
+        case StorageType::Float64:
+            f(double{});
+            break;
+        case StorageType::Float32:
+            f(float{});
+            break;
+        case StorageType::Int32:
+            f(int32_t{});
+            break;
+        case StorageType::UInt32:
+            f(uint32_t{});
+            break;
+        case StorageType::UInt8:
+            f(uint8_t{});
+            break;
+    }
+}
+
+// appends `values` to the end of the one-dimensional `dataset`, which holds `size` values.
+template <typename T>
+void appendTo(HighFive::DataSet& dataset, uint64_t size, const std::vector<T>& values) {
+    dataset.resize({size + values.size()});
+    dataset.select({size}, {values.size()}).write_raw(values.data());
+}
+
+// writes `strings` at once as a dataset of variable-length strings.
+void writeStrings(HighFive::File& file, const std::string& name, const std::vector<std::string>& strings) {
+    file.createDataSet<std::string>(name, HighFive::DataSpace::From(strings)).write(strings);
+}
+
+}  // unnamed namespace
+
+H5StreamWriter::H5StreamWriter(const std::string& filename, const Format& format, int startEventID, H5Layout layout,
+                               H5Compression compression)
+    : m_format(format), m_converter(format), m_startEventID(startEventID), m_layout(layout) {
+    compression = availableCompression(compression);
+    try {
+        HighFive::File file(filename, HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate);
+        Impl impl{std::move(file), {}, std::nullopt, 0};
+
+        const size_t columns = m_format.size();
+        if (m_layout == H5Layout::Rows) {
+            HighFive::DataSpace dataspace({0, columns}, {HighFive::DataSpace::UNLIMITED, columns});
+            auto props = createProps({H5_STREAM_CHUNK_EVENTS, columns}, compression);
+            impl.m_datasets.push_back(impl.m_file.createDataSet<double>("rays", dataspace, props));
+
+            m_buffers.resize(1);
+            m_buffers[0].reserve(H5_STREAM_CHUNK_EVENTS * columns);
+        } else {
+            auto group = impl.m_file.createGroup("columns");
+            HighFive::DataSpace dataspace({0}, {HighFive::DataSpace::UNLIMITED});
+            auto props = createProps({H5_STREAM_CHUNK_EVENTS}, compression);
+            for (const auto& component : m_format) {
+                const auto type = compression.m_reducedPrecision && component.reducible ? StorageType::Float32 : component.storage;
+                m_storage.push_back(type);
+                visitStorageType(type, [&](auto zero) {
+                    impl.m_datasets.push_back(group.createDataSet<decltype(zero)>(component.name, dataspace, props));
+                });
+            }
+            impl.m_rayOffsets = group.createDataSet<uint64_t>("ray_offsets", dataspace, props);
+            group.createAttribute<int>("startEventID", HighFive::DataSpace::From(m_startEventID)).write(m_startEventID);
+
+            m_buffers.resize(columns);
+            for (auto& buffer : m_buffers) buffer.reserve(H5_STREAM_CHUNK_EVENTS);
+            // the events of the first ray start at 0.
+            m_rayOffsets.push_back(0);
+        }
+
+        m_impl = std::make_unique<Impl>(std::move(impl));
+    } catch (HighFive::Exception& err) {
+        RAYX_EXIT << err.what();
+    }
+}
+
+H5StreamWriter::~H5StreamWriter() {
+    if (!m_impl || m_finished) return;
+    try {
+        flush();
+    } catch (const std::exception& err) {
+        RAYX_WARN << err.what();
+    }
+}
+
+void H5StreamWriter::finish() {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    flush();
+    try {
+        m_impl->m_file.flush();
+    } catch (HighFive::Exception& err) {
+        throw std::runtime_error(err.what());
+    }
+    m_finished = true;
+}
+
+void H5StreamWriter::append(const RAYX::BundleHistory& batch) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    const auto firstEventID = static_cast<uint32_t>(m_startEventID);
+    for (const auto& ray_hist : batch) {
+        const auto ray_id = static_cast<uint32_t>(m_numberOfRays++);
+        const size_t buffered = m_numberOfEvents - m_writtenEvents;
+        if (m_layout == H5Layout::Rows) {
+            m_buffers[0].resize((buffered + ray_hist.size()) * m_converter.columns());
+            m_converter.toRows(ray_hist, ray_id, firstEventID, m_buffers[0].data() + buffered * m_converter.columns());
+        } else {
+            for (size_t i = 0; i < m_buffers.size(); i++) {
+                m_buffers[i].resize(buffered + ray_hist.size());
+                m_converter.toColumn(ray_hist, i, ray_id, firstEventID, m_buffers[i].data() + buffered);
+            }
+            m_rayOffsets.push_back(m_numberOfEvents + ray_hist.size());
+        }
+        m_numberOfEvents += ray_hist.size();
+        if (m_numberOfEvents - m_writtenEvents >= H5_STREAM_CHUNK_EVENTS) flush();
+    }
+}
+
+void H5StreamWriter::flush() {
+    const size_t rows = m_numberOfEvents - m_writtenEvents;
+
+    try {
+        if (m_layout == H5Layout::Rows) {
+            if (rows > 0) {
+                const size_t columns = m_format.size();
+                auto& dataset = m_impl->m_datasets[0];
+                dataset.resize({m_writtenEvents + rows, columns});
+                dataset.select({m_writtenEvents, 0}, {rows, columns}).write_raw(m_buffers[0].data());
+            }
+        } else {
+            if (rows > 0) {
+                for (size_t i = 0; i < m_buffers.size(); i++) {
+                    visitStorageType(m_storage[i], [&](auto zero) {
+                        using T = decltype(zero);
+                        if constexpr (std::is_same_v<T, double>) {
+                            appendTo(m_impl->m_datasets[i], m_writtenEvents, m_buffers[i]);
+                        } else {
+                            std::vector<T> values(m_buffers[i].size());
+                            std::transform(m_buffers[i].begin(), m_buffers[i].end(), values.begin(), [](double d) { return static_cast<T>(d); });
+                            appendTo(m_impl->m_datasets[i], m_writtenEvents, values);
+                        }
+                    });
+                }
+            }
+            if (!m_rayOffsets.empty()) {
+                appendTo(*m_impl->m_rayOffsets, m_impl->m_writtenRayOffsets, m_rayOffsets);
+                m_impl->m_writtenRayOffsets += m_rayOffsets.size();
+                m_rayOffsets.clear();
+            }
+        }
+    } catch (HighFive::Exception& err) {
+        // flush() runs on the writer thread of AsyncBatchWriter, so it throws instead of exiting.
+        throw std::runtime_error(err.what());
+    }
+
+    m_writtenEvents = m_numberOfEvents;
+    for (auto& buffer : m_buffers) buffer.clear();
+}
+
+void H5StreamWriter::writeElementNames(const std::vector<std::string>& elementNames) {
+    try {
+        writeStrings(m_impl->m_file, "element_names", elementNames);
+    } catch (HighFive::Exception& err) {
+        RAYX_EXIT << err.what();
+    }
+}
+
+void H5StreamWriter::writeBeamline(const RAYX::Beamline& beamline) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    const size_t numberOfElements = beamline.m_DesignElements.size();
+    std::vector<std::string> elementNames;
+    std::vector<std::string> elementTypes;
+    std::vector<RAYX::Element> elements;
+    elementNames.reserve(numberOfElements);
+    elementTypes.reserve(numberOfElements);
+    elements.reserve(numberOfElements);
+    for (const auto& designElement : beamline.m_DesignElements) {
+        elementNames.push_back(designElement.getName());
+        const auto type = RAYX::ElementStringMap.find(designElement.getType());
+        elementTypes.push_back(type != RAYX::ElementStringMap.end() ? type->second : "");
+        elements.push_back(designElement.compile());
+    }
+
+    std::vector<std::string> sourceNames;
+    sourceNames.reserve(beamline.m_DesignSources.size());
+    for (const auto& designSource : beamline.m_DesignSources) {
+        sourceNames.push_back(designSource.getName());
+    }
+
+    // glm matrices are indexed [column][row].
+    std::vector<double> transforms;
+    transforms.reserve(numberOfElements * 16);
+    for (const auto& element : elements) {
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                transforms.push_back(element.m_outTrans[column][row]);
+            }
+        }
+    }
+
+    try {
+        HighFive::File& file = m_impl->m_file;
+        writeStrings(file, "element_names", elementNames);
+        writeStrings(file, "element_types", elementTypes);
+        writeStrings(file, "source_names", sourceNames);
+
+        auto transformSet = file.createDataSet<double>("element_transforms", HighFive::DataSpace({numberOfElements, 4, 4}));
+        auto elementSet = file.createDataSet<uint8_t>("elements", HighFive::DataSpace({numberOfElements * sizeof(RAYX::Element)}));
+        // readers compare the size and the version to detect files written with a different Element layout.
+        const uint64_t elementSize = sizeof(RAYX::Element);
+        elementSet.createAttribute<uint64_t>("element_size", HighFive::DataSpace::From(elementSize)).write(elementSize);
+        const uint32_t layoutVersion = H5_ELEMENT_LAYOUT_VERSION;
+        elementSet.createAttribute<uint32_t>("element_layout_version", HighFive::DataSpace::From(layoutVersion)).write(layoutVersion);
+        if (numberOfElements > 0) {
+            transformSet.write_raw(transforms.data());
+            elementSet.write_raw(reinterpret_cast<const uint8_t*>(elements.data()));
+        }
+    } catch (HighFive::Exception& err) {
+        RAYX_EXIT << err.what();
+    }
+}
+
+void H5StreamWriter::writeSourceAcceptance(const RAYX::SourceAcceptance& acceptance) {
+    std::vector<double> flux;
+    std::vector<double> rays;
+    for (size_t i = 0; i < acceptance.m_generated.size(); i++) {
+        flux.push_back(acceptance.acceptedFlux(i));
+        rays.push_back(acceptance.acceptedFraction(i));
+    }
+
+    try {
+        HighFive::File& file = m_impl->m_file;
+        file.createAttribute<double>("source_flux_acceptance", HighFive::DataSpace::From(flux)).write(flux);
+        file.createAttribute<double>("source_ray_acceptance", HighFive::DataSpace::From(rays)).write(rays);
+    } catch (HighFive::Exception& err) {
+        RAYX_EXIT << err.what();
+    }
+}
+
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Beamline/Beamline.h"
+#include "Beamline/SourceAcceptance.h"
+#include "Tracer/Tracer.h"
+#include "Writer/Writer.h"
+
+// the version of the `elements` dataset written by H5StreamWriter::writeBeamline. Increment this whenever the layout or the semantics of
+// RAYX::Element change, also if its size stays the same, so that readers ignore the elements of older files.
+constexpr uint32_t H5_ELEMENT_LAYOUT_VERSION = 1;
+
+// How the rays are stored in an .h5 file.
+enum class H5Layout {
+    // a single `rays` dataset of shape (number of events, format.size()), the events are stored row by row.
+    Rows,
+    // a dataset `columns/<component name>` of shape (number of events) for every component of the format, and the index `columns/ray_offsets`:
+    // the events of ray i are [ray_offsets[i], ray_offsets[i + 1]). Components can be read on their own, e.g. only the positions for a
+    // footprint. Every dataset has the StorageType of its component, e.g. the event types are stored as bytes.
+    Columns,
+};
+
+// The compression filter of the datasets.
+// zstd and LZ4 are no built-in filters of HDF5, they require the HDF5 filter plugins (see HDF5_PLUGIN_PATH) for writing and reading.
+// Without the plugin, deflate is used instead.
+enum class H5Codec { Deflate, Zstd, LZ4 };
+
+// Filters which compress the datasets of an H5StreamWriter.
+struct H5Compression {
+    H5Codec m_codec = H5Codec::Deflate;
+    // compression level in [1, 9] for deflate and [1, 22] for zstd, LZ4 ignores it. 0 disables compression.
+    int m_level = 0;
+    // reorders the bytes of the values before compressing, which greatly improves the compression of floating point data.
+    bool m_shuffle = true;
+    // stores the reducible components (positions, directions and fields) as float instead of double. This is lossy!
+    // Only for H5Layout::Columns, as the rows of H5Layout::Rows are always stored as doubles.
+    bool m_reducedPrecision = false;
+};
+
+/**
+ * @brief Writes rays into an .h5 file batch by batch, while they are traced (see BatchCallback).
+ *
+ * Besides the rays (see H5Layout), the file contains the element names as the string dataset `element_names`, and optionally the beamline
+ * metadata written by writeBeamline.
+ * The datasets of the rays are chunked and extendible, so that each batch is appended as it arrives, without materialising the whole
+ * BundleHistory. The chunks can optionally be compressed, see H5Compression.
+ */
+class RAYX_API H5StreamWriter {
+  public:
+    H5StreamWriter(const std::string& filename, const Format& format, int startEventID, H5Layout layout = H5Layout::Rows,
+                   H5Compression compression = {});
+    // writes the buffered events if finish() wasn't called, but can only warn about errors.
+    ~H5StreamWriter();
+
+    H5StreamWriter(const H5StreamWriter&) = delete;
+    H5StreamWriter& operator=(const H5StreamWriter&) = delete;
+
+    // appends the events of `batch`. The ray-ids continue those of the previously appended batches.
+    // Throws std::runtime_error if the events can't be written.
+    void append(const RAYX::BundleHistory& batch);
+
+    // writes all names at once into the string dataset `element_names`.
+    void writeElementNames(const std::vector<std::string>& elementNames);
+
+    // writes the metadata of `beamline`, each as a single dataset: `element_names`, `element_types`, `source_names`, `element_transforms`
+    // of shape (number of elements, 4, 4) with the element-to-world transformations (m_outTrans, column by column as in glm), and
+    // `elements`, the compiled Element array as raw bytes (see H5Beamline), so that readers don't have to re-import the RML file.
+    void writeBeamline(const RAYX::Beamline& beamline);
+
+    // writes the acceptance of culled sources as the attributes `source_flux_acceptance` (the fraction of the intensity of each source, which
+    // the traced rays carry) and `source_ray_acceptance` (the fraction of the rays). Fluxes computed from the rays have to be divided by the
+    // former.
+    void writeSourceAcceptance(const RAYX::SourceAcceptance& acceptance);
+
+    // writes the buffered events and flushes the file, once after the last batch was appended.
+    // Throws std::runtime_error if the events can't be written.
+    void finish();
+
+    uint64_t numberOfRays() const { return m_numberOfRays; }
+    uint64_t numberOfEvents() const { return m_numberOfEvents; }
+
+  private:
+    // writes the buffered events to the end of the datasets.
+    void flush();
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+    Format m_format;
+    FormatConverter m_converter;
+    int m_startEventID;
+    H5Layout m_layout;
+    uint64_t m_numberOfRays = 0;
+    uint64_t m_numberOfEvents = 0;
+    // number of events in the datasets, the others are still buffered.
+    uint64_t m_writtenEvents = 0;
+    bool m_finished = false;
+    // events which are not yet written. For H5Layout::Rows a single buffer of rows, for H5Layout::Columns one buffer per component.
+    std::vector<std::vector<double>> m_buffers;
+    // the type of each dataset of H5Layout::Columns.
+    std::vector<StorageType> m_storage;
+    // ray offsets which are not yet written, see H5Layout::Columns.
+    std::vector<uint64_t> m_rayOffsets;
+};
@@ -2,152 +2,81 @@
 
 #include "H5Writer.h"
 
-#include <highfive/H5DataSpace.hpp>
+#include <highfive/H5Attribute.hpp>
+#include <highfive/H5DataSet.hpp>
 #include <highfive/H5File.hpp>
 #include <string>
 
 #include "Debug/Debug.h"
 #include "Debug/Instrumentor.h"
+#include "H5RayReader.h"
+#include "H5StreamWriter.h"
 #include "Shader/Ray.h"
 
-// count the number of events from `hist`.
-int count(const RAYX::BundleHistory& hist) {
-    int c = 0;
-    for (auto& ray_hist : hist) {
-        c += ray_hist.size();
-    }
-    return c;
-}
-
-// Re-formats `hist` into a bunch of doubles using the format.
-std::vector<double> toDoubles(const RAYX::BundleHistory& hist, const Format& format, int startEventID) {
-    std::vector<double> output;
-    output.reserve(count(hist) * format.size());
-
-    for (uint32_t ray_id = 0; ray_id < hist.size(); ray_id++) {
-        const RAYX::RayHistory& ray_hist = hist[ray_id];
-        for (uint32_t event_id = 0; event_id < ray_hist.size(); event_id++) {
-            const RAYX::Ray& event = ray_hist[event_id];
-            for (uint32_t i = 0; i < format.size(); i++) {
-                double next = format[i].get_double(ray_id, event_id + startEventID, event);
-                output.push_back(next);
-            }
-        }
-    }
-    return output;
-}
-
 void writeH5(const RAYX::BundleHistory& hist, const std::string& filename, const Format& format, std::vector<std::string> elementNames,
              int startEventID) {
-    HighFive::File file(filename, HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate);
-
-    auto doubles = toDoubles(hist, format, startEventID);
-
+    H5StreamWriter writer(filename, format, startEventID);
     try {
-        // write data
-        auto dataspace = HighFive::DataSpace({doubles.size() / format.size(), format.size()});
-        auto dataset = file.createDataSet<double>("rays", dataspace);
-        auto ptr = (double*)doubles.data();
-        dataset.write_raw(ptr);
-
-        // write element names
-        for (size_t i = 0; i < elementNames.size(); i++) {
-            std::string& name = elementNames[i];
-            dataspace = HighFive::DataSpace({name.size()});
-            dataset = file.createDataSet<char>(std::to_string(i), dataspace);
-            auto ptr = name.c_str();
-            dataset.write_raw(ptr);
-        }
-    } catch (HighFive::Exception& err) {
-        RAYX_EXIT << err.what();
+        writer.append(hist);
+        writer.writeElementNames(elementNames);
+        writer.finish();
+    } catch (const std::exception& err) {
+        RAYX_EXIT << "could not write " << filename << ": " << err.what();
     }
 }
 
-RAYX::BundleHistory fromDoubles(const std::vector<double>& doubles, const Format& format) {
+RAYX::BundleHistory raysFromH5(const std::string& filename, const Format& format, std::unique_ptr<uint32_t> startEventID) {
     RAYX_PROFILE_FUNCTION_STDOUT();
-    const size_t formatSize = format.size();
-    const size_t numRays = doubles.size() / formatSize;
-
-    if (doubles.size() % formatSize != 0) {
-        throw std::invalid_argument("Size of doubles does not match expected size based on format");
-    }
-
-    RAYX::BundleHistory bundleHist;
-    bundleHist.reserve(numRays / 2);  // Estimate: assume at least 2 events per ray on average
-
-    RAYX::RayHistory rayHist;
-    rayHist.reserve(8);  // Estimate: assume 8 events per ray on average
 
-    const double startEventID = doubles[1];
-    const double* data = doubles.data();
-
-    for (size_t i = 0; i < numRays; ++i) {
-        const double* rayData = data + i * formatSize;
-
-        double eventId = rayData[1];
-
-        if (eventId == startEventID && !rayHist.empty()) {
-            bundleHist.push_back(std::move(rayHist));
-            rayHist.clear();
-            rayHist.reserve(8);
-        }
-
-        const auto ray = RAYX::Ray{
-            .m_position = {rayData[2], rayData[3], rayData[4]},   // origin
-            .m_eventType = rayData[5],                            // eventType
-            .m_direction = {rayData[6], rayData[7], rayData[8]},  // direction
-            .m_energy = rayData[9],                               // energy
-            .m_field =
-                {
-                    // electric field
-                    {rayData[10], rayData[11]},
-                    {rayData[12], rayData[13]},
-                    {rayData[14], rayData[15]},
-                },
-            .m_pathLength = rayData[16],   // pathLength
-            .m_order = rayData[17],        // order
-            .m_lastElement = rayData[18],  // lastElement
-            .m_sourceID = rayData[19]      // sourceID
-        };
-
-        rayHist.push_back(ray);
+    H5RayReader reader(filename, format);
+    if (startEventID) {
+        *startEventID = static_cast<uint32_t>(reader.startEventID());
     }
-
-    if (!rayHist.empty()) {
-        bundleHist.push_back(std::move(rayHist));
+    auto rays = reader.readAll();
+    if (rays.empty()) {
+        RAYX_WARN << "No rays found in " << filename;
     }
-
-    return bundleHist;
+    RAYX_VERB << "Loaded " << rays.size() << " rays from " << filename;
+    return rays;
 }
 
-RAYX::BundleHistory raysFromH5(const std::string& filename, const Format& format, std::unique_ptr<uint32_t> startEventID) {
-    RAYX_PROFILE_FUNCTION_STDOUT();
-    RAYX::BundleHistory rays;
-
+H5Beamline beamlineFromH5(const std::string& filename) {
+    H5Beamline beamline;
     try {
         HighFive::File file(filename, HighFive::File::ReadOnly);
-
-        std::vector<double> doubles;
-
-        // read data
-        auto dataset = file.getDataSet("rays");
-        auto dims = dataset.getSpace().getDimensions();
-        doubles.resize(dims[0] * dims[1]);
-        dataset.read(doubles.data());
-        if (doubles.size() == 0) {
-            RAYX_WARN << "No rays found in " << filename;
-            return rays;
-        }
-        if (startEventID) {
-            *startEventID = static_cast<uint32_t>(doubles[1]);
+        const auto readStrings = [&file](const std::string& name, std::vector<std::string>& strings) {
+            if (file.exist(name)) file.getDataSet(name).read(strings);
+        };
+        readStrings("element_names", beamline.m_elementNames);
+        readStrings("element_types", beamline.m_elementTypes);
+        readStrings("source_names", beamline.m_sourceNames);
+
+        // older files store every element name as a dataset of chars: "0", "1", ...
+        for (size_t i = 0; !file.exist("element_names") && file.exist(std::to_string(i)); i++) {
+            std::vector<char> name;
+            file.getDataSet(std::to_string(i)).read(name);
+            beamline.m_elementNames.emplace_back(name.begin(), name.end());
         }
-        rays = fromDoubles(doubles, format);
-        RAYX_VERB << "Loaded " << rays.size() << " rays from " << filename;
 
+        if (file.exist("elements")) {
+            auto dataset = file.getDataSet("elements");
+            uint64_t elementSize = 0;
+            dataset.getAttribute("element_size").read(elementSize);
+            // files without a layout version predate it.
+            uint32_t layoutVersion = 0;
+            if (dataset.hasAttribute("element_layout_version")) dataset.getAttribute("element_layout_version").read(layoutVersion);
+            const size_t bytes = dataset.getElementCount();
+            if (layoutVersion != H5_ELEMENT_LAYOUT_VERSION || elementSize != sizeof(RAYX::Element) || bytes % sizeof(RAYX::Element) != 0) {
+                RAYX_WARN << "The elements in " << filename << " were written with a different Element layout, ignoring them";
+            } else if (bytes > 0) {
+                beamline.m_elements.resize(bytes / sizeof(RAYX::Element));
+                dataset.read(reinterpret_cast<uint8_t*>(beamline.m_elements.data()));
+            }
+        }
     } catch (HighFive::Exception& err) {
         RAYX_EXIT << err.what();
     }
-    return rays;
+    return beamline;
 }
 
 #endif
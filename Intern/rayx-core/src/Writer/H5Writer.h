@@ -4,10 +4,26 @@
 #include <string>
 #include <vector>
 
+#include "Element/Element.h"
 #include "Shader/Ray.h"
 #include "Tracer/Tracer.h"
 #include "Writer/Writer.h"
 
 RAYX_API void writeH5(const RAYX::BundleHistory&, const std::string& filename, const Format& format, std::vector<std::string> elementNames,
                       int startEventID);
+// reads all rays, in both layouts of H5StreamWriter. For H5Layout::Columns, only the components of `format` are read.
+// See H5RayReader to read a file chunk by chunk, or only some of its events.
 RAYX_API RAYX::BundleHistory raysFromH5(const std::string& filename, const Format& format, std::unique_ptr<uint32_t> startEventID = nullptr);
+
+// the beamline metadata of an .h5 file, see H5StreamWriter::writeBeamline.
+struct H5Beamline {
+    std::vector<std::string> m_elementNames;
+    std::vector<std::string> m_elementTypes;
+    std::vector<std::string> m_sourceNames;
+    // the compiled elements, e.g. m_outTrans converts element-local hitpoints to world coordinates.
+    // Empty if the file has none, or if it was written by a build with a different Element layout (see H5_ELEMENT_LAYOUT_VERSION).
+    std::vector<RAYX::Element> m_elements;
+};
+
+// reads the beamline metadata. Files without it yield empty vectors, files written by writeH5 only contain the element names.
+RAYX_API H5Beamline beamlineFromH5(const std::string& filename);
@@ -0,0 +1,56 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RAYX_MAPPED_FILE_MMAP
+#endif
+
+MappedFile::MappedFile(const std::string& filename, FileAccess access) {
+#ifdef RAYX_MAPPED_FILE_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+    m_ok = true;
+    // an empty file can't be mapped, but is a valid empty view.
+    if (st.st_size > 0) {
+        void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            if (access == FileAccess::Sequential) {
+                madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+            } else if (access == FileAccess::Random) {
+                madvise(mapping, st.st_size, MADV_RANDOM);
+            }
+            m_data = static_cast<const char*>(mapping);
+            m_size = static_cast<size_t>(st.st_size);
+            m_mapped = true;
+        } else {
+            m_ok = false;
+        }
+    }
+    close(fd);
+    if (m_ok) return;
+#endif
+
+    std::ifstream f(filename, std::ios::binary);
+    if (!f) return;
+    m_buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    m_ok = true;
+}
+
+MappedFile::~MappedFile() {
+#ifdef RAYX_MAPPED_FILE_MMAP
+    if (m_mapped) munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
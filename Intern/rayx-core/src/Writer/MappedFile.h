@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Core.h"
+
+// how a MappedFile is going to be read, so that the mapping is paged in accordingly (see madvise).
+enum class FileAccess {
+    Normal,
+    // front to back, e.g. by a parser: pages are read ahead aggressively, and may be dropped once they were read.
+    Sequential,
+    // scattered, e.g. by an index: no read-ahead.
+    Random,
+};
+
+/**
+ * @brief A read-only view of the bytes of a file.
+ * Where possible, the file is memory-mapped, so that it is paged in lazily while it is parsed. Otherwise it is read into memory.
+ */
+class RAYX_API MappedFile {
+  public:
+    // opens `filename`. On failure, the file is empty and ok() returns false.
+    explicit MappedFile(const std::string& filename, FileAccess access = FileAccess::Normal);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return m_ok; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    bool m_ok = false;
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    // whether m_data is a mapping, which has to be unmapped.
+    bool m_mapped = false;
+    // the contents of the file, if it could not be mapped.
+    std::vector<char> m_buffer;
+};
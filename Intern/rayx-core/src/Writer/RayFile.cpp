@@ -0,0 +1,158 @@
+#include "RayFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Debug/Debug.h"
+#include "Debug/Instrumentor.h"
+
+namespace {
+
+// increment this whenever the file layout changes.
+constexpr uint32_t RAY_FILE_VERSION = 1;
+constexpr char RAY_FILE_MAGIC[8] = {'R', 'A', 'Y', 'X', 'R', 'A', 'Y', '\0'};
+// the events start at a multiple of this, so that they are properly aligned in a mapping.
+constexpr uint64_t RAY_FILE_EVENT_ALIGNMENT = 64;
+
+constexpr uint64_t eventsOffset() {
+    return (sizeof(RayFileHeader) + RAY_FILE_EVENT_ALIGNMENT - 1) / RAY_FILE_EVENT_ALIGNMENT * RAY_FILE_EVENT_ALIGNMENT;
+}
+
+template <typename T>
+void writeArray(std::ofstream& file, const std::vector<T>& values) {
+    file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+}  // unnamed namespace
+
+// writer:
+
+RayFileWriter::RayFileWriter(const std::string& filename, int startEventID, uint32_t numberOfElements)
+    : m_filename(filename), m_file(filename, std::ios::binary | std::ios::trunc), m_header{}, m_elementEvents(numberOfElements) {
+    if (!m_file) {
+        RAYX_EXIT << "could not open " << filename;
+    }
+
+    std::memcpy(m_header.m_magic, RAY_FILE_MAGIC, sizeof(RAY_FILE_MAGIC));
+    m_header.m_version = RAY_FILE_VERSION;
+    m_header.m_raySize = sizeof(RAYX::Ray);
+    m_header.m_startEventID = startEventID;
+    m_header.m_numberOfElements = numberOfElements;
+    m_header.m_eventsOffset = eventsOffset();
+
+    // the header is written again once the sizes are known.
+    const std::vector<char> header(m_header.m_eventsOffset, 0);
+    writeArray(m_file, header);
+}
+
+void RayFileWriter::append(const RAYX::BundleHistory& batch) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    for (const auto& ray_hist : batch) {
+        writeArray(m_file, ray_hist);
+
+        const uint64_t first = m_rayOffsets.back();
+        for (size_t i = 0; i < ray_hist.size(); i++) {
+            const int element = static_cast<int>(ray_hist[i].m_lastElement);
+            if (element >= 0 && element < static_cast<int>(m_elementEvents.size())) m_elementEvents[element].push_back(first + i);
+        }
+        m_rayOffsets.push_back(first + ray_hist.size());
+    }
+
+    // append() runs on the writer thread of AsyncBatchWriter, so it throws instead of exiting.
+    if (!m_file) {
+        throw std::runtime_error("could not write " + m_filename);
+    }
+}
+
+void RayFileWriter::finish() {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+
+    m_header.m_numberOfRays = numberOfRays();
+    m_header.m_numberOfEvents = numberOfEvents();
+    m_header.m_rayOffsetsOffset = m_header.m_eventsOffset + m_header.m_numberOfEvents * sizeof(RAYX::Ray);
+    writeArray(m_file, m_rayOffsets);
+
+    if (!m_elementEvents.empty()) {
+        m_header.m_elementIndexOffset = m_header.m_rayOffsetsOffset + m_rayOffsets.size() * sizeof(uint64_t);
+        std::vector<uint64_t> elementOffsets = {0};
+        for (const auto& events : m_elementEvents) elementOffsets.push_back(elementOffsets.back() + events.size());
+        writeArray(m_file, elementOffsets);
+        for (const auto& events : m_elementEvents) writeArray(m_file, events);
+    }
+
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_file.close();
+    if (!m_file) {
+        RAYX_EXIT << "could not write " << m_filename;
+    }
+}
+
+// reader:
+
+RayFileReader::RayFileReader(const std::string& filename, FileAccess access) : m_file(filename, access), m_header{} {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+    if (!m_file.ok()) {
+        RAYX_EXIT << "could not open " << filename;
+    }
+
+    const char* data = m_file.data();
+    const uint64_t size = m_file.size();
+    if (size < sizeof(RayFileHeader)) {
+        RAYX_EXIT << filename << " is no .rays file";
+    }
+    std::memcpy(&m_header, data, sizeof(m_header));
+
+    const auto& h = m_header;
+    if (std::memcmp(h.m_magic, RAY_FILE_MAGIC, sizeof(RAY_FILE_MAGIC)) != 0) {
+        RAYX_EXIT << filename << " is no .rays file";
+    }
+    if (h.m_version != RAY_FILE_VERSION || h.m_raySize != sizeof(RAYX::Ray)) {
+        RAYX_EXIT << filename << " was written by an incompatible version of RAYX";
+    }
+
+    const uint64_t rayOffsetsEnd = h.m_rayOffsetsOffset + (h.m_numberOfRays + 1) * sizeof(uint64_t);
+    if (h.m_eventsOffset != eventsOffset() || h.m_rayOffsetsOffset != h.m_eventsOffset + h.m_numberOfEvents * sizeof(RAYX::Ray) ||
+        rayOffsetsEnd > size) {
+        RAYX_EXIT << filename << " is corrupted";
+    }
+    m_events = {reinterpret_cast<const RAYX::Ray*>(data + h.m_eventsOffset), h.m_numberOfEvents};
+    m_rayOffsets = {reinterpret_cast<const uint64_t*>(data + h.m_rayOffsetsOffset), h.m_numberOfRays + 1};
+    if (m_rayOffsets.front() != 0 || m_rayOffsets.back() != h.m_numberOfEvents) {
+        RAYX_EXIT << filename << " is corrupted";
+    }
+
+    if (hasElementIndex()) {
+        const uint64_t offsetsEnd = h.m_elementIndexOffset + (h.m_numberOfElements + 1) * sizeof(uint64_t);
+        if (h.m_elementIndexOffset != rayOffsetsEnd || offsetsEnd > size) {
+            RAYX_EXIT << filename << " is corrupted";
+        }
+        m_elementOffsets = {reinterpret_cast<const uint64_t*>(data + h.m_elementIndexOffset), h.m_numberOfElements + 1};
+        if (offsetsEnd + m_elementOffsets.back() * sizeof(uint64_t) > size) {
+            RAYX_EXIT << filename << " is corrupted";
+        }
+        m_elementEventIndices = {reinterpret_cast<const uint64_t*>(data + offsetsEnd), m_elementOffsets.back()};
+    }
+}
+
+std::span<const RAYX::Ray> RayFileReader::rayEvents(uint64_t rayId) const {
+    return m_events.subspan(m_rayOffsets[rayId], m_rayOffsets[rayId + 1] - m_rayOffsets[rayId]);
+}
+
+std::span<const uint64_t> RayFileReader::elementEvents(uint32_t elementId) const {
+    if (!hasElementIndex()) {
+        RAYX_EXIT << "elementEvents: the .rays file has no element index";
+    }
+    return m_elementEventIndices.subspan(m_elementOffsets[elementId], m_elementOffsets[elementId + 1] - m_elementOffsets[elementId]);
+}
+
+RAYX::BundleHistory RayFileReader::toBundleHistory() const {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+    RAYX::BundleHistory out(numberOfRays());
+    for (uint64_t i = 0; i < numberOfRays(); i++) {
+        auto events = rayEvents(i);
+        out[i].assign(events.begin(), events.end());
+    }
+    return out;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Tracer/Tracer.h"
+
+/**
+ * The native ray format (.rays): the events of all rays, stored as they are in memory, so that a file can be mapped and used in place.
+ *
+ * Layout, all offsets in bytes from the start of the file:
+ * - a RayFileHeader.
+ * - the events of all rays, a packed array of RAYX::Ray. The events of a ray are contiguous, the rays follow each other.
+ * - the ray offsets, numberOfRays + 1 uint64_t: the events of ray i are [rayOffsets[i], rayOffsets[i + 1]).
+ * - optionally the element index, numberOfElements + 1 uint64_t offsets followed by event indices:
+ *   the events whose m_lastElement is k are eventIndices[elementOffsets[k]] to eventIndices[elementOffsets[k + 1] - 1], in ascending order.
+ *
+ * The file is written in the byte order of the host, and can only be read on a host with the same byte order and Ray layout.
+ */
+struct RayFileHeader {
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_raySize;  ///< sizeof(RAYX::Ray) of the writer.
+    int32_t m_startEventID;
+    uint32_t m_numberOfElements;  ///< number of elements in the element index, or 0 if the file has none.
+    uint64_t m_numberOfRays;
+    uint64_t m_numberOfEvents;
+    uint64_t m_eventsOffset;
+    uint64_t m_rayOffsetsOffset;
+    uint64_t m_elementIndexOffset;  ///< 0 if the file has no element index.
+};
+
+/**
+ * @brief Writes a .rays file batch by batch, while the rays are traced (see BatchCallback).
+ * The events are appended to the file immediately, the ray offsets, the element index and the header are written by finish().
+ * Until then, the file is incomplete and rejected by RayFileReader.
+ */
+class RAYX_API RayFileWriter {
+  public:
+    // if `numberOfElements` > 0, the file gets an element index for the elements [0, numberOfElements).
+    RayFileWriter(const std::string& filename, int startEventID, uint32_t numberOfElements = 0);
+
+    RayFileWriter(const RayFileWriter&) = delete;
+    RayFileWriter& operator=(const RayFileWriter&) = delete;
+
+    // throws std::runtime_error if the events can't be written.
+    void append(const RAYX::BundleHistory& batch);
+
+    // completes the file, once after the last batch was appended. Exits if the file can't be written.
+    void finish();
+
+    uint64_t numberOfRays() const { return m_rayOffsets.size() - 1; }
+    uint64_t numberOfEvents() const { return m_rayOffsets.back(); }
+
+  private:
+    std::string m_filename;
+    std::ofstream m_file;
+    RayFileHeader m_header;
+    std::vector<uint64_t> m_rayOffsets = {0};
+    // the event indices of every element of the index.
+    std::vector<std::vector<uint64_t>> m_elementEvents;
+};
+
+/**
+ * @brief A .rays file mapped into memory. All accessors return views into the mapping, nothing is copied.
+ */
+class RAYX_API RayFileReader {
+  public:
+    // exits if the file can't be opened or is no valid .rays file. `access` is how the events are going to be read.
+    explicit RayFileReader(const std::string& filename, FileAccess access = FileAccess::Normal);
+
+    uint64_t numberOfRays() const { return m_header.m_numberOfRays; }
+    uint64_t numberOfEvents() const { return m_header.m_numberOfEvents; }
+    int startEventID() const { return m_header.m_startEventID; }
+    bool hasElementIndex() const { return m_header.m_elementIndexOffset != 0; }
+    uint32_t numberOfElements() const { return m_header.m_numberOfElements; }
+
+    // the events of all rays.
+    std::span<const RAYX::Ray> events() const { return m_events; }
+    // the events of ray `rayId`.
+    std::span<const RAYX::Ray> rayEvents(uint64_t rayId) const;
+    // the indices into events() of all events at element `elementId`. Requires an element index.
+    std::span<const uint64_t> elementEvents(uint32_t elementId) const;
+
+    // copies all rays into a BundleHistory.
+    RAYX::BundleHistory toBundleHistory() const;
+
+  private:
+    MappedFile m_file;
+    RayFileHeader m_header;
+    std::span<const RAYX::Ray> m_events;
+    std::span<const uint64_t> m_rayOffsets;
+    std::span<const uint64_t> m_elementOffsets;
+    std::span<const uint64_t> m_elementEventIndices;
+};
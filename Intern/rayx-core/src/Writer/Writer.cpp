@@ -1,5 +1,7 @@
 #include "Writer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "Debug/Debug.h"
@@ -37,3 +39,67 @@ Format formatFromString(const std::string& s) {
 
     return output;
 }
+
+FormatConverter::FormatConverter(const Format& format) : m_columns(format.size()) {
+    for (size_t i = 0; i < format.size(); i++) {
+        const int offset = format[i].offset;
+        m_offsets.push_back(offset);
+        if (offset == FORMAT_RAY_ID) {
+            m_rayIdColumns.push_back(i);
+        } else if (offset == FORMAT_EVENT_ID) {
+            m_eventIdColumns.push_back(i);
+        } else if (!m_runs.empty() && m_runs.back().m_column + m_runs.back().m_length == i &&
+                   m_runs.back().m_offset + m_runs.back().m_length * sizeof(double) == size_t(offset)) {
+            // continues the previous run.
+            m_runs.back().m_length++;
+        } else {
+            m_runs.push_back(Run{.m_column = i, .m_offset = size_t(offset), .m_length = 1});
+        }
+    }
+}
+
+void FormatConverter::toRows(std::span<const RAYX::Ray> events, uint32_t rayId, uint32_t firstEventID, double* out) const {
+    for (size_t e = 0; e < events.size(); e++) {
+        double* row = out + e * m_columns;
+        const char* event = reinterpret_cast<const char*>(&events[e]);
+        for (const auto& run : m_runs) {
+            std::memcpy(row + run.m_column, event + run.m_offset, run.m_length * sizeof(double));
+        }
+        for (size_t column : m_rayIdColumns) row[column] = double(rayId);
+        for (size_t column : m_eventIdColumns) row[column] = double(firstEventID + e);
+    }
+}
+
+void FormatConverter::fromRows(const double* rows, std::span<RAYX::Ray> events) const {
+    for (size_t e = 0; e < events.size(); e++) {
+        const double* row = rows + e * m_columns;
+        char* event = reinterpret_cast<char*>(&events[e]);
+        for (const auto& run : m_runs) {
+            std::memcpy(event + run.m_offset, row + run.m_column, run.m_length * sizeof(double));
+        }
+    }
+}
+
+void FormatConverter::fromColumn(size_t column, const double* values, std::span<RAYX::Ray> events) const {
+    const int offset = m_offsets[column];
+    if (offset < 0) return;
+    char* first = reinterpret_cast<char*>(events.data()) + offset;
+    for (size_t e = 0; e < events.size(); e++) std::memcpy(first + e * sizeof(RAYX::Ray), values + e, sizeof(double));
+}
+
+int FormatConverter::findColumn(int offset) const {
+    auto it = std::find(m_offsets.begin(), m_offsets.end(), offset);
+    return it == m_offsets.end() ? -1 : static_cast<int>(it - m_offsets.begin());
+}
+
+void FormatConverter::toColumn(std::span<const RAYX::Ray> events, size_t column, uint32_t rayId, uint32_t firstEventID, double* out) const {
+    const int offset = m_offsets[column];
+    if (offset == FORMAT_RAY_ID) {
+        std::fill(out, out + events.size(), double(rayId));
+    } else if (offset == FORMAT_EVENT_ID) {
+        for (size_t e = 0; e < events.size(); e++) out[e] = double(firstEventID + e);
+    } else {
+        const char* first = reinterpret_cast<const char*>(events.data()) + offset;
+        for (size_t e = 0; e < events.size(); e++) std::memcpy(out + e, first + e * sizeof(RAYX::Ray), sizeof(double));
+    }
+}
@@ -1,9 +1,20 @@
 #pragma once
 
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 #include "Shader/Ray.h"
 
+// the offsets of the components, which aren't stored in a ray.
+constexpr int FORMAT_RAY_ID = -1;
+constexpr int FORMAT_EVENT_ID = -2;
+
+// The type in which a component is stored in a file, see H5Layout::Columns.
+enum class StorageType { Float64, Float32, Int32, UInt32, UInt8 };
+
 // When writing a Ray to CSV / H5, one needs to specify a way in which to format the ray.
 // A format consists of multiple components - each component corresponds to a single double of data.
 // Example: "Ray-ID|Event-ID". This simple format has two components.
@@ -11,8 +22,21 @@
 struct FormatComponent {
     // The name of the component, example: "X-position".
     const char* name;
-    // A function pointer expressing how to access this component given an actual RAYX::Ray.
-    double (*get_double)(uint32_t ray_id, uint32_t event_id, RAYX::Ray ray);
+    // The byte offset of the double within RAYX::Ray, or FORMAT_RAY_ID / FORMAT_EVENT_ID.
+    int offset;
+    // The smallest type which stores every value of this component exactly, e.g. the event type fits into a byte.
+    StorageType storage;
+    // Whether this component may be stored as Float32 when reduced precision is requested (positions, directions and fields).
+    bool reducible;
+
+    // Reads this component of a single event. Use FormatConverter to convert many events.
+    double get_double(uint32_t ray_id, uint32_t event_id, const RAYX::Ray& ray) const {
+        if (offset == FORMAT_RAY_ID) return static_cast<double>(ray_id);
+        if (offset == FORMAT_EVENT_ID) return static_cast<double>(event_id);
+        double value;
+        std::memcpy(&value, reinterpret_cast<const char*>(&ray) + offset, sizeof(double));
+        return value;
+    }
 };
 
 // Again, a format is simply a list of components!
@@ -29,87 +53,176 @@ Format RAYX_API formatFromString(const std::string&);
 static Format FULL_FORMAT = {
     FormatComponent{
         .name = "Ray-ID",
-        .get_double = [](uint32_t ray_id, uint32_t, RAYX::Ray) { return (double)ray_id; },
+        .offset = FORMAT_RAY_ID,
+        .storage = StorageType::UInt32,
+        .reducible = false,
     },
     FormatComponent{
         .name = "Event-ID",
-        .get_double = [](uint32_t, uint32_t event_id, RAYX::Ray) { return (double)event_id; },
+        .offset = FORMAT_EVENT_ID,
+        .storage = StorageType::UInt32,
+        .reducible = false,
     },
     FormatComponent{
         .name = "X-position",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_position.x; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_position)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "Y-position",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_position.y; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_position) + sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "Z-position",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_position.z; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_position) + 2 * sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "Event-type",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_eventType; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_eventType)),
+        .storage = StorageType::UInt8,
+        .reducible = false,
     },
     FormatComponent{
         .name = "X-direction",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_direction.x; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_direction)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "Y-direction",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_direction.y; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_direction) + sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "Z-direction",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_direction.z; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_direction) + 2 * sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "Energy",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_energy; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_energy)),
+        .storage = StorageType::Float64,
+        .reducible = false,
     },
     FormatComponent{
         .name = "ElectricField-x-real",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_field.x.real(); },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_field)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "ElectricField-x-imag",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_field.x.imag(); },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_field) + sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "ElectricField-y-real",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_field.y.real(); },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_field) + 2 * sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "ElectricField-y-imag",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_field.y.imag(); },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_field) + 3 * sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "ElectricField-z-real",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_field.z.real(); },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_field) + 4 * sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "ElectricField-z-imag",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_field.z.imag(); },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_field) + 5 * sizeof(double)),
+        .storage = StorageType::Float64,
+        .reducible = true,
     },
     FormatComponent{
         .name = "pathLength",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_pathLength; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_pathLength)),
+        .storage = StorageType::Float64,
+        .reducible = false,
     },
     FormatComponent{
         .name = "order",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_order; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_order)),
+        .storage = StorageType::Int32,
+        .reducible = false,
     },
     FormatComponent{
         .name = "lastElement",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_lastElement; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_lastElement)),
+        .storage = StorageType::Int32,
+        .reducible = false,
     },
     FormatComponent{
         .name = "lightSourceIndex",
-        .get_double = [](uint32_t, uint32_t, RAYX::Ray ray) { return ray.m_sourceID; },
+        .offset = static_cast<int>(offsetof(RAYX::Ray, m_sourceID)),
+        .storage = StorageType::Int32,
+        .reducible = false,
     },
 };
 
+// the components are read from rays by their byte offsets, and the complex fields are arrays of (real, imaginary).
+static_assert(std::is_standard_layout_v<RAYX::Ray>);
+static_assert(sizeof(RAYX::complex::Complex) == 2 * sizeof(double));
+
+/**
+ * @brief A Format resolved once for converting many events: instead of reading every component of every event on its own, the components
+ * are grouped into runs of consecutive doubles in RAYX::Ray, which are copied as a block. FULL_FORMAT is a single run besides the ids.
+ */
+class RAYX_API FormatConverter {
+  public:
+    explicit FormatConverter(const Format& format);
+
+    size_t columns() const { return m_columns; }
+
+    // writes the events of ray `rayId` row by row into `out`, which has space for events.size() * columns() doubles.
+    // the event-ids start at `firstEventID`.
+    void toRows(std::span<const RAYX::Ray> events, uint32_t rayId, uint32_t firstEventID, double* out) const;
+
+    // writes the component `column` of the events of ray `rayId` into `out`, which has space for events.size() doubles.
+    void toColumn(std::span<const RAYX::Ray> events, size_t column, uint32_t rayId, uint32_t firstEventID, double* out) const;
+
+    // the inverse of toRows: sets the components of `events` from `rows`. Ray-ID and Event-ID are not stored in a ray, hence they are ignored.
+    void fromRows(const double* rows, std::span<RAYX::Ray> events) const;
+
+    // the inverse of toColumn.
+    void fromColumn(size_t column, const double* values, std::span<RAYX::Ray> events) const;
+
+    // the first column of the component at `offset` (e.g. FORMAT_RAY_ID), or -1 if the format doesn't contain it.
+    int findColumn(int offset) const;
+
+  private:
+    // a run of `m_length` components, which are consecutive doubles in RAYX::Ray starting at byte `m_offset`.
+    struct Run {
+        size_t m_column;
+        size_t m_offset;
+        size_t m_length;
+    };
+
+    size_t m_columns;
+    std::vector<int> m_offsets;
+    std::vector<Run> m_runs;
+    std::vector<size_t> m_rayIdColumns;
+    std::vector<size_t> m_eventIdColumns;
+};
+
 // These includes allow the user to just import Writer.h and still access
-// both CSVWriter and H5Writer.
+// the CSVWriter, the H5Writer and the native RayFile.
+#include "AsyncBatchWriter.h"
 #include "CSVWriter.h"
+#include "H5RayReader.h"
+#include "H5StreamWriter.h"
 #include "H5Writer.h"
+#include "RayFile.h"
@@ -0,0 +1,289 @@
+#include <chrono>
+
+#include "../setupTests.h"
+#include "Shader/Collision.h"
+#include "Shader/Cubic.h"
+#include "Shader/Utils.h"
+
+// Microbenchmark of the cubic collision: the Horner-based getCubicCollision against the previous implementation (ported from RAY-UI), which
+// evaluated the residual with float round trips through pow(). The previous implementation only lives here, for comparison.
+
+namespace {
+
+// the previous implementation of getCubicCollision, kept for comparison.
+Collision getCubicCollisionLegacy(Ray r, CubicSurface cu) {
+    Collision col;
+    col.found = true;
+    col.hitpoint = glm::dvec3(0, 0, 0);
+    col.normal = glm::dvec3(0, 0, 0);
+
+    // Ray r = rotateForCubic(rin, cu.m_psi, 1000);
+
+    int cs = 1;
+    if (glm::abs(r.m_direction[1]) >= glm::abs(r.m_direction[0]) && glm::abs(r.m_direction[1]) >= glm::abs(r.m_direction[2])) {
+        cs = 2;
+    } else if (glm::abs(r.m_direction[2]) >= glm::abs(r.m_direction[0]) && glm::abs(r.m_direction[2]) >= glm::abs(r.m_direction[1])) {
+        cs = 3;
+    }
+
+    glm::dvec3 pos = cubicPosition(r, cu.m_psi);
+    double x = pos.x;
+    double y = pos.y;
+    double z = pos.z;
+    double x1 = 0;
+    double xx = 0;
+    double y1 = 0;
+    double yy = 0;
+    double z1 = 0;
+    double zz = 0;
+    double counter = 0;
+    double dx = 0;
+
+    glm::dvec3 dir = cubicDirection(r, cu.m_psi);
+    double al = dir.x;
+    double am = dir.y;
+    double an = dir.z;
+
+    if (cs == 1) {
+        double aml = am / al;
+        double anl = an / al;
+
+        do {
+            x1 = xx;
+            y1 = y - aml * (x - xx);
+            z1 = z - anl * (x - xx);
+
+            double func = (2 * ((x1 - xx) * an - al * z1) * cu.m_a23 - (2 * cu.m_a24 + cu.m_b12 * pow(float(xx), 2.0)) * al +
+                           ((x1 - xx) * am - al * y1) * (cu.m_a22 + cu.m_b21 * xx)) *
+                          ((x1 - xx) * am - al * y1);
+            func = func + pow(float(((x1 - xx) * an - al * z1)), 2.0) * cu.m_a33;
+            func = func - ((x1 - xx) * an - al * z1) * (2 * cu.m_a34 + cu.m_b13 * pow(float(xx), 2.0) * al + cu.m_a44 * pow(float(al), 2.0));
+            func = (func -
+                    (2 * ((x1 - xx) * an - al * z1) * cu.m_a13 - (cu.m_a11 * xx + 2 * cu.m_a14) * al + 2 * ((x1 - xx) * am - al * y1) * cu.m_a12) *
+                        al * xx) *
+                   al;
+            func = (func - (pow(float(((x1 - xx) * am - al * y1)), 2.0) * cu.m_b23 +
+                            ((x1 - xx) * am - al * y1) * ((x1 - xx) * an - al * z1) * cu.m_b32 - ((x1 - xx) * an - al * z1) * al * cu.m_b31 * xx) *
+                               ((x1 - xx) * an - al * z1) / pow(float(al), 3));
+
+            double dfunc = (2 * ((x1 - xx) * an - al * z1) * cu.m_a23 - (2 * cu.m_a24 + cu.m_b12 * pow(float(xx), 2)) * al +
+                            ((x1 - xx) * am - al * y1) * (cu.m_a22 + cu.m_b21 * xx)) *
+                           am;
+            dfunc = dfunc - (2 * (cu.m_a12 * am + cu.m_a13 * an) + cu.m_a11 * al) * al * xx;
+            dfunc =
+                dfunc + (2 * ((x1 - xx) * an - al * z1) * cu.m_a13 - (cu.m_a11 * xx + 2 * cu.m_a14) * al + 2 * ((x1 - xx) * am - al * y1) * cu.m_a12);
+            dfunc =
+                dfunc * al + ((cu.m_a22 + cu.m_b21 * xx) * am + 2 * (cu.m_a23 * an + al * cu.m_b12 * xx) - ((x1 - xx) * am - al * y1) * cu.m_b21) *
+                                 ((x1 - xx) * am - al * y1);
+            dfunc = (dfunc + 2 * ((x1 - xx) * an - al * z1) * (cu.m_a33 * an + al * cu.m_b13 * xx) -
+                     (2 * cu.m_a34 + cu.m_b13 * pow(float(xx), 2)) * al * an) *
+                    al;
+            dfunc = (dfunc - ((((x1 - xx) * an - al * z1) * (al * cu.m_b31 + am * cu.m_b32) - al * an * cu.m_b31 * xx +
+                               ((x1 - xx) * am - al * y1) * (2 * am * cu.m_b23 + an * cu.m_b32)) *
+                                  ((x1 - xx) * an - al * z1) +
+                              (pow(float(((x1 - xx) * am - al * y1)), 2) * cu.m_b23 +
+                               ((x1 - xx) * am - al * y1) * ((x1 - xx) * an - al * z1) * cu.m_b32 - ((x1 - xx) * an - al * z1) * al * cu.m_b31 * xx) *
+                                  an));
+            dfunc = dfunc / pow(float(al), 3);
+
+            if (glm::abs(dfunc) < 0.001) {
+                dfunc = 0.001;
+            }
+
+            dx = func / dfunc;
+            xx = xx - dx;
+
+            x = x1;
+            y = y1;
+            z = z1;
+
+            if (counter > 1000) {
+                x = -2 * y1 / 2 / aml;
+                y = y1 + aml * x;
+                z = z1 + anl * x;
+            }
+            counter++;
+        } while (glm::abs(dx) > 0.001);
+
+    } else if (cs == 2) {
+        double alm = al / am;
+        double anm = an / am;
+
+        do {
+            x1 = x - alm * (y - yy);
+            y1 = yy;
+            z1 = z - anm * (y - yy);
+
+            double func = (2 * (((y1 - yy) * an - am * z1) * cu.m_a13 - (cu.m_a12 * yy + cu.m_a14) * am) +
+                           ((y1 - yy) * al - am * x1) * (cu.m_a11 + cu.m_b12 * yy)) *
+                          ((y1 - yy) * al - am * x1);
+            func = func + (((y1 - yy) * an - am * z1) * cu.m_a33 - 2 * (cu.m_a23 * yy + cu.m_a34) * am) * ((y1 - yy) * an - am * z1) +
+                   (2 * cu.m_a24 * yy + cu.m_a44 + cu.m_a22 * pow(float(yy), 2) * pow(float(am), 2));
+            func = func * am +
+                   ((((y1 - yy) * an - am * z1) * cu.m_b32 - am * cu.m_b23 * yy) * am * yy - pow(float((y1 - yy) * al - am * x1), 2) * cu.m_b13) *
+                       ((y1 - yy) * an - am * z1);
+            func = func - (pow(float(((y1 - yy) * an - am * z1)), 2) * cu.m_b31 + pow(float(am), 2) * cu.m_b21 * pow(float(yy), 2)) *
+                              ((y1 - yy) * al - am * x1);
+            func = func / pow(float(am), 3);
+
+            double dfunc = (pow(float((y1 - yy) * an - am * z1), 2) * cu.m_b31 + pow(float(am), 2) * cu.m_b21 * pow(float(yy), 2) * al +
+                            2 * (((y1 - yy) * an - am * z1) * an * cu.m_b31 - pow(float(am), 2)) * cu.m_b21 * yy) *
+                           ((y1 - yy) * al - am * x1);
+            dfunc =
+                dfunc -
+                ((((y1 - yy) * an - am * z1) * cu.m_b32 - am * cu.m_b23 * yy) * am * yy - pow(float((y1 - yy) * al - am * x1), 2) * cu.m_b13) * an;
+            dfunc = dfunc + (2 * ((y1 - yy) * al - am * x1) * al * cu.m_b13 - (am * cu.m_b23 + an * cu.m_b32) * am * yy +
+                             (((y1 - yy) * an - am * z1) * cu.m_b32 - am * cu.m_b23 * yy) * am) *
+                                ((y1 - yy) * an - am * z1);
+            dfunc = dfunc - (((cu.m_a11 + cu.m_b12 * yy) * al + 2 * (cu.m_a12 * am + cu.m_a13 * an) - ((y1 - yy) * al - am * x1) * cu.m_b12) *
+                                 ((y1 - yy) * al - am * x1) -
+                             2 * (cu.m_a22 * pow(float(am), 2) * yy + cu.m_a23 * pow(float(am), 2) * z1 - cu.m_a23 * am * an * y1 +
+                                  2 * cu.m_a23 * am * an * yy + cu.m_a24 * pow(float(am), 2) + cu.m_a33 * am * an * z1 -
+                                  cu.m_a33 * pow(float(an), 2) * y1 + cu.m_a33 * pow(float(an), 2) * yy + cu.m_a34 * am * an) +
+                             (2 * (((y1 - yy) * an - am * z1) * cu.m_a13 - (cu.m_a12 * yy + cu.m_a14) * am) +
+                              ((y1 - yy) * al - am * x1) * (cu.m_a11 + cu.m_b12 * yy)) *
+                                 al) *
+                                am;
+            dfunc = dfunc / pow(float(am), 3);
+
+            if (glm::abs(dfunc) < 0.001) {
+                dfunc = 0.001;
+            }
+
+            dx = func / dfunc;
+            yy = yy - dx;
+
+            x = x1;
+            y = y1;
+            z = z1;
+
+            if (counter > 1000) {
+                x = x1;
+                y = 0;
+                z = z1;
+            }
+            counter++;
+        } while (glm::abs(dx) > 0.001);
+    } else {
+        double aln = al / an;
+        double amn = am / an;
+
+        do {
+            x1 = x - aln * (z - zz);
+            y1 = y - amn * (z - zz);
+            z1 = zz;
+
+            double func = ((2 * (((z1 - zz) * am - an * y1) * cu.m_a12 - (cu.m_a13 * zz + cu.m_a14) * an) + ((z1 - zz) * al - an * x1) * cu.m_a11) *
+                               ((z1 - zz) * al - an * x1) +
+                           (((z1 - zz) * am - an * y1) * cu.m_a22 - 2 * (cu.m_a23 * zz + cu.m_a24) * an) * ((z1 - zz) * am - an * y1) +
+                           (2 * cu.m_a34 * zz + cu.m_a44 + cu.m_a33 * pow(float(zz), 2)) * pow(float(an), 2)) *
+                          an;
+            func = func - ((((z1 - zz) * am - an * y1) * cu.m_b12 - an * cu.m_b13 * zz) * pow(float(((z1 - zz) * al - an * x1)), 2) -
+                           (((z1 - zz) * am - an * y1) * cu.m_b23 - an * cu.m_b32 * zz) * ((z1 - zz) * am - an * y1) * an * zz +
+                           (pow(float(((z1 - zz) * am - an * y1)), 2) * cu.m_b21 + pow(float(an), 2) * cu.m_b31 * pow(float(zz), 2)) *
+                               ((z1 - zz) * al - an * x1));
+            func = func / pow(float(an), 3);
+
+            double dfunc = (((z1 - zz) * am - an * y1) * cu.m_a22 - 2 * (cu.m_a23 * zz + cu.m_a24) * an) * am +
+                           (2 * (cu.m_a12 * am + cu.m_a13 * an) + cu.m_a11 * al) * ((z1 - zz) * al - an * x1);
+            dfunc = dfunc + ((z1 - zz) * am - an * y1) * (cu.m_a22 * am + 2 * cu.m_a23 * an) - 2 * (cu.m_a33 * zz + cu.m_a34) * pow(float(an), 2);
+            dfunc = (dfunc +
+                     (2 * (((z1 - zz) * am - an * y1) * cu.m_a12 - (cu.m_a13 * zz + cu.m_a14) * an) + ((z1 - zz) * al - an * x1) * cu.m_a11) * al) *
+                    an;
+            dfunc = dfunc - (2 *
+                                 (((z1 - zz) * am - an * y1) * am * cu.m_b21 - pow(float(an), 2) * cu.m_b31 * zz +
+                                  (((z1 - zz) * am - an * y1) * cu.m_b12 - an * cu.m_b13 * zz) * al) *
+                                 ((z1 - zz) * al - an * x1) +
+                             (pow(float(((z1 - zz) * am - an * y1)), 2) * cu.m_b21 + pow(float(an), 2) * cu.m_b31 * pow(float(zz), 2)) * al +
+                             pow(float(((z1 - zz) * al - an * x1)), 2) * (am * cu.m_b12 + an * cu.m_b13) -
+                             ((z1 - zz) * am - an * y1) * (am * cu.m_b23 + an * cu.m_b32) * an * zz +
+                             (((z1 - zz) * am - an * y1) * cu.m_b23 - an * cu.m_b32 * zz) * (am * z1 - 2 * am * zz - an * y1) * an);
+            dfunc = (-dfunc) / pow(float(an), 3);
+
+            if (glm::abs(dfunc) < 0.001) {
+                dfunc = 0.001;
+            }
+
+            dx = func / dfunc;
+            zz = zz - dx;
+
+            x = x1;
+            y = y1;
+            z = z1;
+
+            if (counter > 1000) {
+                x = x1 + aln * z;
+                y = y1 + amn * z;
+                z = -2 * y1 / 2 / amn;
+            }
+            counter++;
+        } while (glm::abs(dx) > 0.001);
+        // r.m_position = glm::dvec3(a, b, c);
+    }
+
+    // intersection point is in the negative direction (behind the position when the direction is followed forwards), set weight to 0
+    // if ((x - r.m_position.x) / r.m_direction.x < 0 || (y - r.m_position.y) / r.m_direction.y < 0 || (z - r.m_position.z) / r.m_direction.z < 0) {
+    //    col.found = false;
+    //}
+
+    double fx = 2 * cu.m_a14 + 2 * cu.m_a11 * x + 2 * cu.m_a12 * y + 2 * cu.m_a13 * z;
+    double fy = 2 * cu.m_a24 + 2 * cu.m_a12 * x + 2 * cu.m_a22 * y + 2 * cu.m_a23 * z;
+    double fz = 2 * cu.m_a34 + 2 * cu.m_a13 * x + 2 * cu.m_a23 * y + 2 * cu.m_a33 * z;
+
+    col.normal = normalize(glm::dvec3(fx, fy * glm::cos(-cu.m_psi) - fz * glm::sin(-cu.m_psi), fz * glm::cos(-cu.m_psi) + fy * glm::sin(-cu.m_psi)));
+    col.hitpoint = glm::dvec3(x, y * glm::cos(-cu.m_psi) - z * glm::sin(-cu.m_psi), z * glm::cos(-cu.m_psi) + y * glm::sin(-cu.m_psi));
+    return col;
+}
+
+template <typename F>
+double timeCollisions(const std::vector<Ray>& rays, const CubicSurface& cu, F collide, std::vector<Collision>& out) {
+    constexpr int repetitions = 20;
+    out.resize(rays.size());
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) {
+        for (size_t j = 0; j < rays.size(); j++) {
+            out[j] = collide(rays[j], cu);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repetitions;
+}
+
+}  // namespace
+
+// Not part of the regular test run, use --gtest_also_run_disabled_tests --gtest_filter=*benchCubicCollision
+TEST_F(TestSuite, DISABLED_benchCubicCollision) {
+    for (auto filename : {"cubicElement", "Cubic_Experts_Matrix"}) {
+        auto beamline = loadBeamline(filename);
+        auto element = beamline.m_DesignElements[0].compile();
+        ASSERT_EQ(element.m_surface.m_type, STYPE_CUBIC);
+        auto cu = deserializeCubic(element.m_surface);
+
+        std::vector<Ray> rays = beamline.getInputRays();
+        for (auto& r : rays) {
+            r = rayMatrixMult(r, element.m_inTrans);
+        }
+
+        std::vector<Collision> legacy, horner;
+        double legacyTime = timeCollisions(rays, cu, getCubicCollisionLegacy, legacy);
+        double hornerTime = timeCollisions(rays, cu, getCubicCollision, horner);
+
+        // the previous implementation stopped at a step size of 1e-3, and for some rays it diverged far away from the element.
+        double maxDeviation = 0.0;
+        int diverged = 0;
+        for (size_t i = 0; i < rays.size(); i++) {
+            CHECK(horner[i].found);
+            double deviation = glm::length(horner[i].hitpoint - legacy[i].hitpoint);
+            if (deviation > 1.0) {
+                diverged++;
+            } else {
+                maxDeviation = std::max(maxDeviation, deviation);
+            }
+        }
+        CHECK(maxDeviation < 2e-3);
+
+        RAYX_LOG << filename << ": " << rays.size() << " rays, previous: " << legacyTime << "s, horner: " << hornerTime
+                 << "s, speedup: " << legacyTime / hornerTime << ", max hitpoint deviation: " << maxDeviation
+                 << ", diverged previously: " << diverged;
+    }
+}
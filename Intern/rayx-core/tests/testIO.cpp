@@ -1,3 +1,7 @@
+#include <algorithm>
+
+#include "Data/Strings.h"
+#include "Writer/Writer.h"
 #include "setupTests.h"
 
 // Prepare test data
@@ -37,3 +41,390 @@ TEST_F(TestSuite, TestWriteFileFromVector) {
         ASSERT_EQ(testData[i], readData[i]);
     }
 }
+
+TEST_F(TestSuite, FormatConverter) {
+    auto hist = traceRML("PlaneMirror");
+    const uint32_t startEventID = 3;
+
+    // the offsets of the components point to the named members.
+    const auto& ray = hist[0][0];
+    const auto named = formatFromString("Ray-ID|Event-ID|X-position|Event-type|ElectricField-y-imag|lightSourceIndex");
+    CHECK_EQ(named[0].get_double(5, 7, ray), 5.0, 0.0);
+    CHECK_EQ(named[1].get_double(5, 7, ray), 7.0, 0.0);
+    CHECK_EQ(named[2].get_double(5, 7, ray), ray.m_position.x, 0.0);
+    CHECK_EQ(named[3].get_double(5, 7, ray), ray.m_eventType, 0.0);
+    CHECK_EQ(named[4].get_double(5, 7, ray), ray.m_field.y.imag(), 0.0);
+    CHECK_EQ(named[5].get_double(5, 7, ray), ray.m_sourceID, 0.0);
+
+    // a full format, and a partial one whose components aren't consecutive in a Ray.
+    for (const auto& format : {FULL_FORMAT, formatFromString("Energy|Event-ID|X-position|Y-position|lastElement|Ray-ID|ElectricField-y-imag")}) {
+        FormatConverter converter(format);
+        CHECK_EQ(converter.columns(), format.size());
+
+        for (size_t ray_id = 0; ray_id < hist.size(); ray_id++) {
+            const auto& events = hist[ray_id];
+            std::vector<double> rows(events.size() * format.size());
+            std::vector<double> column(events.size());
+            converter.toRows(events, static_cast<uint32_t>(ray_id), startEventID, rows.data());
+
+            for (size_t i = 0; i < format.size(); i++) {
+                converter.toColumn(events, i, static_cast<uint32_t>(ray_id), startEventID, column.data());
+                for (size_t e = 0; e < events.size(); e++) {
+                    const double expected = format[i].get_double(static_cast<uint32_t>(ray_id), static_cast<uint32_t>(e) + startEventID, events[e]);
+                    CHECK_EQ(rows[e * format.size() + i], expected, 0.0);
+                    CHECK_EQ(column[e], expected, 0.0);
+                }
+            }
+        }
+    }
+}
+
+// reads the cells of a CSV file, without its header.
+std::vector<std::vector<std::string>> readCSVCells(const std::string& filename) {
+    std::ifstream file(filename);
+    std::vector<std::vector<std::string>> cells;
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string cell;
+        cells.emplace_back();
+        while (std::getline(ss, cell, ',')) cells.back().push_back(cell);
+    }
+    return cells;
+}
+
+TEST_F(TestSuite, CSVStyles) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/CSVStyles.csv").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    std::vector<double> expected;
+    for (size_t ray_id = 0; ray_id < hist.size(); ray_id++) {
+        for (size_t event_id = 0; event_id < hist[ray_id].size(); event_id++) {
+            for (const auto& component : FULL_FORMAT) {
+                expected.push_back(component.get_double(static_cast<uint32_t>(ray_id), static_cast<uint32_t>(event_id), hist[ray_id][event_id]));
+            }
+        }
+    }
+
+    // fixed-width cells form a grid, and keep the digits of the old stringstream formatting.
+    writeCSV(hist, filename, FULL_FORMAT, 0, CSVStyle::FixedWidth);
+    size_t i = 0;
+    for (const auto& row : readCSVCells(filename)) {
+        CHECK_EQ(row.size(), FULL_FORMAT.size());
+        for (const auto& cell : row) {
+            CHECK_EQ(cell.size(), 22);
+            std::stringstream ss;
+            ss.setf(std::ios::fixed);
+            ss.precision(23);
+            ss << expected[i++];
+            CHECK(ss.str().starts_with(cell.substr(0, cell.find(' '))));
+        }
+    }
+    CHECK_EQ(i, expected.size());
+
+    // compact cells read back to exactly the written doubles.
+    writeCSV(hist, filename, FULL_FORMAT, 0, CSVStyle::Compact);
+    i = 0;
+    for (const auto& row : readCSVCells(filename)) {
+        CHECK_EQ(row.size(), FULL_FORMAT.size());
+        for (const auto& cell : row) CHECK_EQ(std::stod(cell), expected[i++], 0.0);
+    }
+    CHECK_EQ(i, expected.size());
+}
+
+TEST_F(TestSuite, loadCSV) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/loadCSV.csv").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    writeCSV(hist, filename, FULL_FORMAT, 0, CSVStyle::Compact);
+    auto loaded = loadCSV(filename);
+    CHECK_EQ(loaded.size(), hist.size());
+    for (size_t i = 0; i < loaded.size(); i++) {
+        CHECK_EQ(loaded[i].size(), hist[i].size());
+        for (size_t j = 0; j < loaded[i].size(); j++) CHECK_EQ(loaded[i][j], hist[i][j], 0.0);
+    }
+
+    writeCSV(hist, filename, FULL_FORMAT, 0, CSVStyle::FixedWidth);
+    loaded = loadCSV(filename);
+    CHECK_EQ(loaded.size(), hist.size());
+    for (size_t i = 0; i < loaded.size(); i++) {
+        CHECK_EQ(loaded[i].size(), hist[i].size());
+        for (size_t j = 0; j < loaded[i].size(); j++) CHECK_EQ(loaded[i][j], hist[i][j], 1e-11);
+    }
+}
+
+TEST_F(TestSuite, CSVStreamWriter) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/CSVStreamWriter.csv").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    // appending the rays batch by batch continues the ray-ids.
+    {
+        CSVStreamWriter writer(filename, FULL_FORMAT, 0, CSVStyle::Compact);
+        const auto half = hist.begin() + hist.size() / 2;
+        writer.append(RAYX::BundleHistory(hist.begin(), half));
+        writer.append(RAYX::BundleHistory(half, hist.end()));
+        writer.finish();
+        CHECK_EQ(writer.numberOfRays(), hist.size());
+    }
+
+    auto loaded = loadCSV(filename);
+    CHECK_EQ(loaded.size(), hist.size());
+    for (size_t i = 0; i < loaded.size(); i++) {
+        CHECK_EQ(loaded[i].size(), hist[i].size());
+        for (size_t j = 0; j < loaded[i].size(); j++) CHECK_EQ(loaded[i][j], hist[i][j], 0.0);
+    }
+}
+
+TEST_F(TestSuite, RayFile) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/RayFile.rays").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    const uint32_t numElements = 2;
+    {
+        RayFileWriter writer(filename, 0, numElements);
+        const auto half = hist.begin() + hist.size() / 2;
+        writer.append(RAYX::BundleHistory(hist.begin(), half));
+        writer.append(RAYX::BundleHistory(half, hist.end()));
+        writer.finish();
+    }
+
+    RayFileReader reader(filename);
+    CHECK_EQ(reader.numberOfRays(), hist.size());
+    CHECK(reader.hasElementIndex());
+    CHECK_EQ(reader.numberOfElements(), numElements);
+
+    std::vector<std::vector<uint64_t>> elementEvents(numElements);
+    uint64_t event = 0;
+    for (size_t i = 0; i < hist.size(); i++) {
+        auto events = reader.rayEvents(i);
+        CHECK_EQ(events.size(), hist[i].size());
+        for (size_t j = 0; j < events.size(); j++) {
+            CHECK_EQ(events[j], hist[i][j], 0.0);
+            const int element = static_cast<int>(hist[i][j].m_lastElement);
+            if (element >= 0 && element < static_cast<int>(numElements)) elementEvents[element].push_back(event);
+            event++;
+        }
+    }
+    CHECK_EQ(reader.numberOfEvents(), event);
+
+    for (uint32_t k = 0; k < numElements; k++) {
+        auto indices = reader.elementEvents(k);
+        CHECK(std::equal(indices.begin(), indices.end(), elementEvents[k].begin(), elementEvents[k].end()));
+    }
+}
+
+TEST_F(TestSuite, AsyncBatchWriter) {
+    auto hist = traceRML("PlaneMirror");
+
+    // the batches are written in order, while the next ones are pushed.
+    RAYX::BundleHistory written;
+    {
+        AsyncBatchWriter writer(
+            [&](RAYX::BundleHistory batch) {
+                written.insert(written.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+            },
+            1);
+        for (size_t i = 0; i < hist.size(); i += 100) {
+            writer.push(RAYX::BundleHistory(hist.begin() + i, hist.begin() + std::min(i + 100, hist.size())));
+        }
+        writer.finish();
+    }
+
+    CHECK_EQ(written.size(), hist.size());
+    for (size_t i = 0; i < written.size(); i++) {
+        CHECK_EQ(written[i].size(), hist[i].size());
+        for (size_t j = 0; j < written[i].size(); j++) CHECK_EQ(written[i][j], hist[i][j], 0.0);
+    }
+
+    // an error of the writer thread is rethrown by finish(), the batches after it are dropped.
+    size_t calls = 0;
+    bool rethrown = false;
+    {
+        AsyncBatchWriter writer(
+            [&](RAYX::BundleHistory) {
+                calls++;
+                throw std::runtime_error("write failed");
+            },
+            1);
+        for (int i = 0; i < 4; i++) writer.push(RAYX::BundleHistory(1));
+        try {
+            writer.finish();
+        } catch (const std::runtime_error&) {
+            rethrown = true;
+        }
+    }
+    CHECK(rethrown);
+    CHECK_EQ(calls, 1);
+}
+
+#ifndef NO_H5
+TEST_F(TestSuite, H5StreamWriter) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/H5StreamWriter.h5").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    // appending the rays batch by batch and compressed yields the same rays.
+    {
+        H5StreamWriter writer(filename, FULL_FORMAT, 0, H5Layout::Rows, H5Compression{.m_level = 6});
+        const auto half = hist.begin() + hist.size() / 2;
+        writer.append(RAYX::BundleHistory(hist.begin(), half));
+        writer.append(RAYX::BundleHistory(half, hist.end()));
+        writer.finish();
+        CHECK_EQ(writer.numberOfRays(), hist.size());
+    }
+
+    auto read = raysFromH5(filename, FULL_FORMAT);
+    CHECK_EQ(read.size(), hist.size());
+    for (size_t i = 0; i < read.size(); i++) {
+        CHECK_EQ(read[i].size(), hist[i].size());
+        for (size_t j = 0; j < read[i].size(); j++) CHECK_EQ(read[i][j], hist[i][j], 0.0);
+    }
+}
+
+TEST_F(TestSuite, H5StreamWriterColumns) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/H5StreamWriterColumns.h5").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    {
+        H5StreamWriter writer(filename, FULL_FORMAT, 0, H5Layout::Columns);
+        const auto half = hist.begin() + hist.size() / 2;
+        writer.append(RAYX::BundleHistory(hist.begin(), half));
+        writer.append(RAYX::BundleHistory(half, hist.end()));
+        writer.finish();
+    }
+
+    auto read = raysFromH5(filename, FULL_FORMAT);
+    CHECK_EQ(read.size(), hist.size());
+    for (size_t i = 0; i < read.size(); i++) {
+        CHECK_EQ(read[i].size(), hist[i].size());
+        for (size_t j = 0; j < read[i].size(); j++) CHECK_EQ(read[i][j], hist[i][j], 0.0);
+    }
+
+    // a partial read only fills the requested components.
+    auto partial = raysFromH5(filename, formatFromString("X-position|Z-position"));
+    CHECK_EQ(partial.size(), hist.size());
+    for (size_t i = 0; i < partial.size(); i++) {
+        CHECK_EQ(partial[i].size(), hist[i].size());
+        for (size_t j = 0; j < partial[i].size(); j++) {
+            CHECK_EQ(partial[i][j].m_position.x, hist[i][j].m_position.x, 0.0);
+            CHECK_EQ(partial[i][j].m_position.z, hist[i][j].m_position.z, 0.0);
+            CHECK_EQ(partial[i][j].m_position.y, 0.0, 0.0);
+            CHECK_EQ(partial[i][j].m_energy, 0.0, 0.0);
+        }
+    }
+}
+
+TEST_F(TestSuite, H5StreamWriterReducedPrecision) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/H5StreamWriterReducedPrecision.h5").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    {
+        H5StreamWriter writer(filename, FULL_FORMAT, 0, H5Layout::Columns, H5Compression{.m_level = 6, .m_reducedPrecision = true});
+        writer.append(hist);
+    }
+
+    // the integral components are stored exactly, the reducible ones as floats.
+    auto read = raysFromH5(filename, FULL_FORMAT);
+    CHECK_EQ(read.size(), hist.size());
+    for (size_t i = 0; i < read.size(); i++) {
+        CHECK_EQ(read[i].size(), hist[i].size());
+        for (size_t j = 0; j < read[i].size(); j++) {
+            const auto& r = read[i][j];
+            const auto& h = hist[i][j];
+            CHECK_EQ(r.m_eventType, h.m_eventType, 0.0);
+            CHECK_EQ(r.m_lastElement, h.m_lastElement, 0.0);
+            CHECK_EQ(r.m_sourceID, h.m_sourceID, 0.0);
+            CHECK_EQ(r.m_order, h.m_order, 0.0);
+            CHECK_EQ(r.m_energy, h.m_energy, 0.0);
+            CHECK_EQ(r.m_pathLength, h.m_pathLength, 0.0);
+            CHECK_EQ(r.m_position, glm::dvec3(glm::vec3(h.m_position)), 0.0);
+            CHECK_EQ(r.m_direction, glm::dvec3(glm::vec3(h.m_direction)), 0.0);
+        }
+    }
+}
+
+TEST_F(TestSuite, H5RayReader) {
+    auto hist = traceRML("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/H5RayReader.h5").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    const H5RayFilter filter{.m_firstRay = 10, .m_endRay = 500, .m_eventType = static_cast<int>(RAYX::ETYPE_JUST_HIT_ELEM), .m_lastEventOnly = true};
+    std::vector<uint64_t> expectedIds;
+    std::vector<RAYX::Ray> expected;
+    for (uint64_t i = filter.m_firstRay; i < std::min<uint64_t>(filter.m_endRay, hist.size()); i++) {
+        for (auto it = hist[i].rbegin(); it != hist[i].rend(); it++) {
+            if (it->m_eventType == RAYX::ETYPE_JUST_HIT_ELEM) {
+                expectedIds.push_back(i);
+                expected.push_back(*it);
+                break;
+            }
+        }
+    }
+
+    for (auto layout : {H5Layout::Rows, H5Layout::Columns}) {
+        {
+            H5StreamWriter writer(filename, FULL_FORMAT, 0, layout);
+            writer.append(hist);
+        }
+
+        // small chunks, so that rays continue in the next chunk.
+        H5RayReader reader(filename, FULL_FORMAT, 7);
+        CHECK_EQ(reader.readAll().size(), hist.size());
+
+        std::vector<uint64_t> ids;
+        std::vector<RAYX::Ray> events;
+        reader.read(filter, [&](const H5RayBatch& batch) {
+            CHECK_EQ(batch.m_rayIds.size(), batch.m_rays.size());
+            ids.insert(ids.end(), batch.m_rayIds.begin(), batch.m_rayIds.end());
+            for (const auto& ray : batch.m_rays) {
+                CHECK_EQ(ray.size(), 1);
+                events.push_back(ray[0]);
+            }
+        });
+
+        CHECK(ids == expectedIds);
+        CHECK_EQ(events.size(), expected.size());
+        for (size_t i = 0; i < events.size(); i++) CHECK_EQ(events[i], expected[i], 0.0);
+    }
+}
+
+TEST_F(TestSuite, H5Beamline) {
+    auto beamline = loadBeamline("PlaneMirror");
+    std::string filename = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/H5Beamline.h5").string();
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+
+    {
+        H5StreamWriter writer(filename, FULL_FORMAT, 0);
+        writer.writeBeamline(beamline);
+    }
+
+    auto read = beamlineFromH5(filename);
+    CHECK_EQ(read.m_elementNames.size(), beamline.m_DesignElements.size());
+    CHECK_EQ(read.m_elementTypes.size(), beamline.m_DesignElements.size());
+    CHECK_EQ(read.m_elements.size(), beamline.m_DesignElements.size());
+    for (size_t i = 0; i < read.m_elements.size(); i++) {
+        CHECK(read.m_elementNames[i] == beamline.m_DesignElements[i].getName());
+        CHECK(read.m_elementTypes[i] == RAYX::ElementStringMap[beamline.m_DesignElements[i].getType()]);
+        const auto element = beamline.m_DesignElements[i].compile();
+        CHECK_EQ(read.m_elements[i].m_inTrans, element.m_inTrans, 0.0);
+        CHECK_EQ(read.m_elements[i].m_outTrans, element.m_outTrans, 0.0);
+    }
+    CHECK_EQ(read.m_sourceNames.size(), beamline.m_DesignSources.size());
+    for (size_t i = 0; i < read.m_sourceNames.size(); i++) {
+        CHECK(read.m_sourceNames[i] == beamline.m_DesignSources[i].getName());
+    }
+
+    // writeH5 only writes the element names.
+    writeH5({}, filename, FULL_FORMAT, {"first", "second"}, 0);
+    read = beamlineFromH5(filename);
+    CHECK(read.m_elementNames == std::vector<std::string>({"first", "second"}));
+    CHECK(read.m_elements.empty());
+}
+#endif
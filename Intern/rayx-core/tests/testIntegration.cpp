@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <chrono>
+
+#include "Tracer/RayOrder.h"
 #include "setupTests.h"
 
 // in this module tests mostly compare rayx's output with RAY-UI.
@@ -18,7 +22,9 @@ TEST_F(TestSuite, PlaneMirrorDef) {
 TEST_F(TestSuite, PlaneMirrorMis) { compareLastAgainstRayUI("PlaneMirrorMis"); }
 TEST_F(TestSuite, SphereMirrorDefault) { compareLastAgainstRayUI("SphereMirrorDefault", 1e-10); }
 TEST_F(TestSuite, SphereGrating) { compareLastAgainstRayUI("SphereGrating", 1e-12, Sequential::Yes); }
-TEST_F(TestSuite, ToroidGrating) { compareLastAgainstRayUI("ToroidGrating", 1e-12, Sequential::Yes); }
+// The RAY-UI references of the toroid tests stem from a Newton iteration which stops once its step drops below 1e-4, so their hitpoints are
+// off by up to that step. rayx converges to 1e-11, which moves the rays on the image plane by up to 1.2e-5 here (and 2.4e-6 in toroid).
+TEST_F(TestSuite, ToroidGrating) { compareLastAgainstRayUI("ToroidGrating", 1e-4, Sequential::Yes); }
 
 // In these tests the ray would hit the ImagePlane before the PlaneGrating, if we trace dynamically.
 // This prevents comparing the results to Ray-UI, and hence we do sequential tracing here to allow for such a comparison.
@@ -38,9 +44,9 @@ TEST_F(TestSuite, ReflectionZonePlateAzim200) { compareLastAgainstRayUI("Reflect
 TEST_F(TestSuite, ReflectionZonePlateDefault) { compareLastAgainstRayUI("ReflectionZonePlateDefault"); }
 TEST_F(TestSuite, ReflectionZonePlateDefault200) { compareLastAgainstRayUI("ReflectionZonePlateDefault200", 1e-7); }
 
-// TODO re-enable this test:
-// It seems to be caused by imprecision in the current toroid collision being larger than the COLLISION_EPSILON.
-// TEST_F(TestSuite, ReflectionZonePlateDefault200Toroid) { compareLastAgainstRayUI("ReflectionZonePlateDefault200Toroid", 1e-7); }
+// The short radii of this toroid (40 and 20) amplify the error of the RAY-UI hitpoints (see ToroidGrating above), the rays on the image plane
+// move by up to 4.1e-3. Traced dynamically, many rays hit the strongly curved RZP a second time, which RAY-UI doesn't trace.
+TEST_F(TestSuite, ReflectionZonePlateDefault200Toroid) { compareLastAgainstRayUI("ReflectionZonePlateDefault200Toroid", 5e-3, Sequential::Yes); }
 
 TEST_F(TestSuite, ReflectionZonePlateMis) { compareLastAgainstRayUI("ReflectionZonePlateMis", 1e-7); }
 
@@ -80,3 +86,108 @@ TEST_F(TestSuite, RZP_misalignment) { compareLastAgainstRayUI("RZP_misalignment"
 
 TEST_F(TestSuite, RZP_plane) { compareLastAgainstRayUI("test-rzp-1-plane", 1e-10); }
 TEST_F(TestSuite, RZP_spherical) { compareLastAgainstRayUI("test-rzp-1-spherical", 1e-10); }
+
+// source-acceptance culling must only drop rays that miss the first element in sequential tracing.
+TEST_F(TestSuite, cullSourceRays) {
+    auto beamline = loadBeamline("SphereGrating");
+    auto countFirstHits = [](const BundleHistory& hist) {
+        size_t count = 0;
+        for (const auto& ray_hist : hist) {
+            if (!ray_hist.empty() && ray_hist[0].m_eventType == ETYPE_JUST_HIT_ELEM && ray_hist[0].m_lastElement == 0) count++;
+        }
+        return count;
+    };
+
+    // small batches, so that the rejected rays lie in between and after the batches.
+    const uint64_t batchSize = 1000;
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto full = tracer->trace(beamline, Sequential::Yes, batchSize, 1, beamline.m_DesignElements.size() + 2);
+    CHECK(!tracer->sourceAcceptance().has_value());
+
+    beamline.m_cullSourceRays = true;
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto culled = tracer->trace(beamline, Sequential::Yes, batchSize, 1, beamline.m_DesignElements.size() + 2);
+
+    const auto& acceptance = tracer->sourceAcceptance();
+    CHECK(acceptance.has_value());
+    CHECK_EQ(acceptance->numberOfRays(), full.size());
+    CHECK_EQ(countFirstHits(culled), acceptance->m_rayIds.size());
+    CHECK_EQ(countFirstHits(culled), countFirstHits(full));
+    CHECK_IN(acceptance->acceptedFlux(0), 0.0, 1.0);
+
+    // the accepted rays keep their ray-ids and random numbers, and the rejected rays have no events, exactly as without culling.
+    CHECK_EQ(culled.size(), full.size());
+    for (size_t i = 0; i < culled.size(); i++) {
+        CHECK_EQ(culled[i].size(), full[i].size());
+        for (size_t j = 0; j < culled[i].size(); j++) CHECK_EQ(culled[i][j], full[i][j], 0.0);
+    }
+}
+
+TEST_F(TestSuite, sortRays) {
+    auto beamline = loadBeamline("slit1_seeded");
+
+    // the Morton order is a permutation of the rays.
+    auto rays = beamline.getInputRays();
+    auto order = mortonOrder(rays);
+    std::vector<int> sortedOrder = order;
+    std::sort(sortedOrder.begin(), sortedOrder.end());
+    for (size_t i = 0; i < sortedOrder.size(); i++) CHECK_EQ(sortedOrder[i], static_cast<int>(i));
+
+    // sorting only changes which thread traces a ray, hence the results are identical.
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto unsorted = tracer->trace(beamline, Sequential::No, DEFAULT_BATCH_SIZE, 1, beamline.m_DesignElements.size() + 2);
+
+    beamline.m_sortRays = true;
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto sorted = tracer->trace(beamline, Sequential::No, DEFAULT_BATCH_SIZE, 1, beamline.m_DesignElements.size() + 2);
+
+    CHECK_EQ(sorted.size(), unsorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        CHECK_EQ(sorted[i].size(), unsorted[i].size());
+        for (size_t j = 0; j < sorted[i].size(); j++) CHECK_EQ(sorted[i][j], unsorted[i][j], 0.0);
+    }
+}
+
+TEST_F(TestSuite, traceRayPackets) {
+    // planes and curved elements, and a slit which draws random numbers for the diffraction.
+    for (auto filename : {"pm_ell_ip_200mirrormis", "slit1_seeded"}) {
+        for (auto sequential : {Sequential::No, Sequential::Yes}) {
+            auto beamline = loadBeamline(filename);
+            RAYX::fixSeed(RAYX::FIXED_SEED);
+            auto single = tracer->trace(beamline, sequential, DEFAULT_BATCH_SIZE, 1, beamline.m_DesignElements.size() + 2);
+
+            // packets only change how the collisions are computed, hence the results are identical.
+            beamline.m_traceRayPackets = true;
+            RAYX::fixSeed(RAYX::FIXED_SEED);
+            auto packets = tracer->trace(beamline, sequential, DEFAULT_BATCH_SIZE, 1, beamline.m_DesignElements.size() + 2);
+
+            CHECK_EQ(packets.size(), single.size());
+            for (size_t i = 0; i < packets.size(); i++) {
+                CHECK_EQ(packets[i].size(), single[i].size());
+                for (size_t j = 0; j < packets[i].size(); j++) CHECK_EQ(packets[i][j], single[i][j], 0.0);
+            }
+        }
+    }
+}
+
+// Measures the speedup of packet tracing. Not part of the regular test run, use --gtest_also_run_disabled_tests --gtest_filter=*benchRayPackets
+TEST_F(TestSuite, DISABLED_benchRayPackets) {
+    constexpr int repetitions = 20;
+    for (auto filename : {"PlaneMirror", "pm_ell_ip_200mirrormis"}) {
+        auto beamline = loadBeamline(filename);
+        auto timeTrace = [&] {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; i++) {
+                tracer->trace(beamline, Sequential::No, DEFAULT_BATCH_SIZE, 1, beamline.m_DesignElements.size() + 2);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return elapsed.count() / repetitions;
+        };
+
+        beamline.m_traceRayPackets = false;
+        const double single = timeTrace();
+        beamline.m_traceRayPackets = true;
+        const double packets = timeTrace();
+        RAYX_LOG << filename << ": single rays " << single << "s, packets " << packets << "s, speedup " << single / packets;
+    }
+}
@@ -1,10 +1,17 @@
+#include <cmath>
 #include <numeric>
 
 #include "Beamline/Objects/DipoleSource.h"
+#include "Element/DiffractionTables.h"
+#include "Material/FresnelTableBuilder.h"
 #include "Shader/ApplySlopeError.h"
 #include "Shader/Approx.h"
+#include "Shader/Collision.h"
+#include "Shader/Diffraction.h"
+#include "Shader/FresnelTable.h"
 #include "Shader/LineDensity.h"
 #include "Shader/Rand.h"
+#include "Shader/RayPacket.h"
 #include "Shader/Refrac.h"
 #include "Shader/SphericalCoords.h"
 #include "Shader/Utils.h"
@@ -1407,3 +1414,447 @@ TEST_F(TestSuite, testSphericalCoords) {
         CHECK_EQ(dir, dir2, 1e-11);
     }
 }
+
+TEST_F(TestSuite, testToroidCollision) {
+    const double longRad = 10470.4917;
+    const double shortRad = 315.723959;
+
+    // vertical rays hit the concave toroid exactly at y = R - sqrt(rx(x)^2 - z^2).
+    ToroidSurface concave{.m_longRadius = longRad, .m_shortRadius = shortRad, .m_toroidType = TOROID_TYPE_CONCAVE};
+    for (double x : {-100.0, -10.0, 0.0, 25.0, 200.0}) {
+        for (double z : {-500.0, -50.0, 0.0, 80.0, 700.0}) {
+            Ray r{.m_position = glm::dvec3(x, 100, z), .m_direction = glm::dvec3(0, -1, 0)};
+            Collision col = getToroidCollision(r, concave, false);
+            CHECK(col.found);
+
+            double rx = longRad - shortRad + sqrt(shortRad * shortRad - x * x);
+            CHECK_EQ(col.hitpoint, glm::dvec3(x, longRad - sqrt(rx * rx - z * z), z), 1e-9);
+        }
+    }
+
+    // grazing rays (2 and 10 degrees), as in typical beamlines, coming from a source 10m upstream. They have to hit the toroid near its vertex
+    // (where they were aimed at), and not its far side.
+    for (auto toroidType : {TOROID_TYPE_CONCAVE, TOROID_TYPE_CONVEX}) {
+        ToroidSurface toroid{.m_longRadius = longRad, .m_shortRadius = shortRad, .m_toroidType = toroidType};
+        double rho = toroidType == TOROID_TYPE_CONVEX ? -shortRad : shortRad;
+        for (double degrees : {2.0, 10.0}) {
+            for (double x : {-20.0, 0.0, 15.0}) {
+                for (double z : {-300.0, 0.0, 250.0}) {
+                    const double angle = degrees * PI / 180.0;
+                    glm::dvec3 dir(0, -sin(angle), cos(angle));
+                    double rx = longRad - rho + glm::sign(rho) * sqrt(rho * rho - x * x);
+                    glm::dvec3 target(x, longRad - sqrt(rx * rx - z * z), z);
+                    Ray r{.m_position = target - 10000.0 * dir, .m_direction = dir};
+                    Collision col = getToroidCollision(r, toroid, false);
+                    CHECK(col.found);
+                    CHECK_EQ(col.hitpoint, target, 1e-9);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(TestSuite, testCubicCollision) {
+    // cubicPosition and cubicDirection only keep the y and z components, hence all rays lie in the x = 0 plane.
+
+    // sphere x^2 + y^2 + z^2 - 2Ry = 0 around (0, R, 0): vertical rays hit it at y = R - sqrt(R^2 - z^2).
+    const double radius = 1000.0;
+    CubicSurface sphere{.m_a11 = 1, .m_a22 = 1, .m_a24 = -radius, .m_a33 = 1};
+    for (double z : {-300.0, -20.0, 0.0, 45.0, 600.0}) {
+        Ray r{.m_position = glm::dvec3(0, -100, z), .m_direction = glm::dvec3(0, 1, 0)};
+        Collision col = getCubicCollision(r, sphere);
+        CHECK(col.found);
+
+        glm::dvec3 hit(0, radius - sqrt(radius * radius - z * z), z);
+        CHECK_EQ(col.hitpoint, hit, 1e-9);
+        CHECK_EQ(col.normal, glm::normalize(hit - glm::dvec3(0, radius, 0)), 1e-9);
+    }
+
+    // -2y + z^2 / R + b23 y^2 z = 0, a parabola bent by a cubic term: y = (z^2 / R) / (1 + sqrt(1 - b23 z^3 / R)).
+    const double parabolaRadius = 10000.0;
+    const double b23 = 1e-6;
+    CubicSurface cubic{.m_a24 = -1, .m_a33 = 1 / parabolaRadius, .m_b23 = b23};
+    auto surfaceHeight = [&](double z) { return (z * z / parabolaRadius) / (1 + sqrt(1 - b23 * z * z * z / parabolaRadius)); };
+
+    for (double z : {-300.0, 0.0, 250.0}) {
+        glm::dvec3 target(0, surfaceHeight(z), z);
+
+        // vertical rays.
+        Ray vertical{.m_position = target + glm::dvec3(0, 50, 0), .m_direction = glm::dvec3(0, -1, 0)};
+        Collision col = getCubicCollision(vertical, cubic);
+        CHECK(col.found);
+        CHECK_EQ(col.hitpoint, target, 1e-9);
+
+        // grazing rays (2 degrees) coming from a source 10m upstream, along which the surface function is a full cubic polynomial.
+        const double angle = 2.0 * PI / 180.0;
+        glm::dvec3 dir(0, -sin(angle), cos(angle));
+        Ray grazing{.m_position = target - 10000.0 * dir, .m_direction = dir};
+        col = getCubicCollision(grazing, cubic);
+        CHECK(col.found);
+        CHECK_EQ(col.hitpoint, target, 1e-9);
+    }
+}
+
+TEST_F(TestSuite, testRefractiveIndexLookupGrid) {
+    std::array<bool, 92> relevant{};
+    relevant[static_cast<int>(Material::Cu) - 1] = true;
+    relevant[static_cast<int>(Material::Au) - 1] = true;
+    auto grid = loadMaterialTables(relevant, MaterialLookup::Grid);
+    auto binary = loadMaterialTables(relevant, MaterialLookup::BinarySearch);
+
+    // the grid only accelerates the lookup, it has to find exactly the same entries.
+    for (auto material : {Material::Cu, Material::Au}) {
+        for (double logEnergy = -4.0; logEnergy <= 12.0; logEnergy += 0.0137) {
+            double energy = std::exp(logEnergy);
+
+            inv.mat = grid.materialTable;
+            inv.matIdx = grid.indexTable;
+            auto a = getRefractiveIndex(energy, static_cast<int>(material), inv);
+
+            inv.mat = binary.materialTable;
+            inv.matIdx = binary.indexTable;
+            auto b = getRefractiveIndex(energy, static_cast<int>(material), inv);
+
+            CHECK_EQ(a, b, 0.0);
+        }
+    }
+
+    updateCpuTracerMaterialTables({Material::Cu});
+}
+
+TEST_F(TestSuite, testRefractiveIndexLookupGridDenseCells) {
+    // the entries of si.nff and sc.nff are unevenly spread in log(E): up to 18 (Si) and 16 (Sc) entries fall into a single grid cell.
+    std::array<bool, 92> relevant{};
+    relevant[static_cast<int>(Material::Si) - 1] = true;
+    relevant[static_cast<int>(Material::Sc) - 1] = true;
+    auto grid = loadMaterialTables(relevant, MaterialLookup::Grid);
+    auto binary = loadMaterialTables(relevant, MaterialLookup::BinarySearch);
+
+    for (auto material : {Material::Si, Material::Sc}) {
+        const int m = static_cast<int>(material);
+        inv.mat = binary.materialTable;
+        inv.matIdx = binary.indexTable;
+        const int count = getNffEntryCount(m, inv);
+        std::vector<double> energies;
+        for (int i = 0; i < count; i++) {
+            energies.push_back(getNffEntry(i, m, inv).m_energy);
+        }
+
+        // si.nff isn't sorted at its K-edge (1839 eV is followed by 1838.9 eV). In between, the binary search result depends on its probes.
+        auto unsorted = [&](double energy) {
+            for (int i = 0; i + 1 < count; i++) {
+                if (energies[i + 1] < energies[i] && energies[i + 1] <= energy && energy <= energies[i]) return true;
+            }
+            return false;
+        };
+
+        // every entry, its neighbouring doubles, and the midpoint to the next entry.
+        for (int i = 0; i < count; i++) {
+            const double e = energies[i];
+            const double next = i + 1 < count ? energies[i + 1] : 2 * e;
+            for (double energy : {std::nextafter(e, 0.0), e, std::nextafter(e, next), 0.5 * (e + next)}) {
+                if (unsorted(energy)) continue;
+
+                inv.mat = grid.materialTable;
+                inv.matIdx = grid.indexTable;
+                int a = findEntryIndex(energy, 1, m, count, inv);
+
+                inv.mat = binary.materialTable;
+                inv.matIdx = binary.indexTable;
+                int b = findEntryIndex(energy, 1, m, count, inv);
+
+                CHECK_EQ(a, b);
+            }
+        }
+    }
+
+    updateCpuTracerMaterialTables({Material::Cu});
+}
+
+TEST_F(TestSuite, testElementRecord) {
+    for (auto filename : {"toroid", "Ellipsoid", "cubicElement"}) {
+        auto beamline = loadBeamline(filename);
+        auto element = beamline.m_DesignElements[0].compile();
+        auto record = makeElementRecord(element);
+
+        // the affine 3x4 transformations agree with the full 4x4 matrices.
+        glm::dvec3 p(1.5, -20.0, 300.0);
+        CHECK_EQ(record.m_inTrans * glm::dvec4(p, 1), glm::dvec3(element.m_inTrans * glm::dvec4(p, 1)), 1e-12);
+        CHECK_EQ(record.m_outTrans * glm::dvec4(p, 1), glm::dvec3(element.m_outTrans * glm::dvec4(p, 1)), 1e-12);
+
+        // the shader reads the behaviour and material from the record only.
+        CHECK_EQ(record.m_behaviour.m_type, element.m_behaviour.m_type);
+        for (int i = 0; i < 16; i++) {
+            CHECK_EQ(record.m_behaviour.m_private_serialization_params[i], element.m_behaviour.m_private_serialization_params[i]);
+        }
+        CHECK_EQ(record.m_material, int(element.m_material));
+
+        // the pre-decoded element yields exactly the same collisions.
+        auto rays = beamline.getInputRays();
+        for (const auto& ray : rays) {
+            Ray r = rayMatrixMult(ray, element.m_inTrans);
+            Ray rr = rayMatrixMult(ray, record.m_inTrans);
+            auto a = findCollisionInElementCoords(r, element.m_surface, element.m_cutout, false);
+            auto b = findCollisionInElementCoords(rr, record.m_surface, record.m_cutout, false);
+            CHECK_EQ(a.found, b.found);
+            if (a.found) {
+                CHECK_EQ(a.hitpoint, b.hitpoint, 1e-9);
+                CHECK_EQ(a.normal, b.normal, 1e-9);
+            }
+        }
+    }
+}
+
+TEST_F(TestSuite, testFresnelTable) {
+    auto element = loadBeamline("PlaneMirror").m_DesignElements[0].compile();
+    element.m_material = static_cast<double>(Material::Au);
+    std::vector<Element> elements = {element};
+
+    std::array<bool, 92> relevant{};
+    relevant[static_cast<int>(Material::Au) - 1] = true;
+    auto tables = loadMaterialTables(relevant);
+    inv.mat = tables.materialTable;
+    inv.matIdx = tables.indexTable;
+
+    auto raysWithEnergies = [](double lo, double hi) {
+        std::vector<Ray> rays(2);
+        rays[0].m_energy = lo;
+        rays[1].m_energy = hi;
+        return rays;
+    };
+
+    const glm::dvec3 normal(0, 1, 0);
+    auto checkAgainstExact = [&](double energy) {
+        const auto iorI = getRefractiveIndex(energy, -1, inv);
+        const auto iorT = getRefractiveIndex(energy, static_cast<int>(Material::Au), inv);
+        // from grazing to normal incidence, including the critical angle.
+        for (double grazing = 1e-4; grazing <= PI / 2; grazing *= 1.05) {
+            const glm::dvec3 incident(0, -std::sin(grazing), std::cos(grazing));
+            ComplexFresnelCoeffs cached;
+            CHECK(lookupReflectAmplitude(0, energy, glm::dot(incident, -normal), inv, cached));
+            const auto exact = calcReflectAmplitude(incident, normal, iorI, iorT);
+            CHECK_EQ(cached.s, exact.s, 1e-8);
+            CHECK_EQ(cached.p, exact.p, 1e-8);
+        }
+    };
+
+    // monochromatic: a single node, which is only used for exactly this energy.
+    auto fresnelTables = buildFresnelTables(elements, tables, raysWithEnergies(1000.0, 1000.0));
+    inv.fresnelTables = fresnelTables;
+    checkAgainstExact(1000.0);
+    ComplexFresnelCoeffs out;
+    CHECK(!lookupReflectAmplitude(0, 1000.5, 0.01, inv, out));
+
+    // narrow-band: exact within the band, nothing outside of it.
+    fresnelTables = buildFresnelTables(elements, tables, raysWithEnergies(1000.0, 1002.0));
+    inv.fresnelTables = fresnelTables;
+    for (double energy = 1000.0; energy <= 1002.0; energy += 0.25) checkAgainstExact(energy);
+    CHECK(!lookupReflectAmplitude(0, 999.0, 0.01, inv, out));
+    CHECK(!lookupReflectAmplitude(0, 1002.5, 0.01, inv, out));
+
+    // across the Au M5-edge, where the Palik table steps at 2227.228 eV: the table steps at the same energy instead of smearing the edge.
+    const double edge = 2227.228;
+    CHECK(getRefractiveIndex(std::nextafter(edge, 0.0), static_cast<int>(Material::Au), inv).imag() <
+          getRefractiveIndex(edge, static_cast<int>(Material::Au), inv).imag());
+    fresnelTables = buildFresnelTables(elements, tables, raysWithEnergies(2218.0, 2236.0));
+    inv.fresnelTables = fresnelTables;
+    for (double energy = 2218.0; energy <= 2236.0; energy += 0.25) checkAgainstExact(energy);
+    checkAgainstExact(std::nextafter(edge, 0.0));
+    checkAgainstExact(edge);
+
+    // broad-band: no tables at all.
+    fresnelTables = buildFresnelTables(elements, tables, raysWithEnergies(100.0, 1000.0));
+    CHECK_EQ(fresnelTables.size(), 1);
+    CHECK_EQ(fresnelTables[0], -1.0);
+
+    inv.fresnelTables = {};
+    updateCpuTracerMaterialTables({Material::Cu});
+}
+
+TEST_F(TestSuite, testDiffractionTables) {
+    // slit1 has a rectangular, slit2 an elliptical opening.
+    std::vector<Element> elements;
+    for (auto filename : {"slit1_seeded", "slit2_seeded"}) {
+        for (const auto& e : loadBeamline(filename).m_DesignElements) elements.push_back(e.compile());
+    }
+    auto tables = buildDiffractionTables(elements);
+    inv.diffractionTables = tables;
+
+    int fraunhofer = -1;
+    int airy = -1;
+    for (size_t id = 0; id < elements.size(); id++) {
+        if (int(elements[id].m_behaviour.m_type) != BTYPE_SLIT) {
+            CHECK_EQ(tables[id], -1.0);
+            continue;
+        }
+        auto type = int(deserializeSlit(elements[id].m_behaviour).m_openingCutout.m_type);
+        (type == CTYPE_RECT ? fraunhofer : airy) = int(tables[id]);
+    }
+    CHECK(fraunhofer >= 0 && airy >= 0);
+
+    // inverse CDFs are monotonic.
+    for (int offset : {fraunhofer, airy}) {
+        for (int i = 0; i + 1 < DIFFRACTION_TABLE_SIZE; i++) {
+            CHECK(tables[offset + i] <= tables[offset + i + 1]);
+        }
+    }
+
+    // the tables sample the same distributions as the rejection sampling, compared by the mean diffraction angle.
+    constexpr int n = 200000;
+    const double wl = 1.0;
+    const double size = 0.05;
+    double rejection[2] = {0, 0};
+    double tabulated[2] = {0, 0};
+    inv.ctr = 13;
+    for (int i = 0; i < n; i++) {
+        double a = 0;
+        double b = 0;
+        fraun_diff(size, wl, a, inv);
+        fraun_diff_table(size, wl, b, fraunhofer, inv);
+        rejection[0] += std::abs(a);
+        tabulated[0] += std::abs(b);
+
+        double dphi = 0, dpsi = 0;
+        bessel_diff(size, wl, dphi, dpsi, inv);
+        rejection[1] += std::sqrt(dphi * dphi + dpsi * dpsi);
+        bessel_diff_table(size, wl, dphi, dpsi, airy, inv);
+        tabulated[1] += std::sqrt(dphi * dphi + dpsi * dpsi);
+    }
+    CHECK_EQ(tabulated[0] / rejection[0], 1.0, 0.03);
+    CHECK_EQ(tabulated[1] / rejection[1], 1.0, 0.03);
+
+    inv.diffractionTables = {};
+}
+
+TEST_F(TestSuite, testFastFresnel) {
+    using namespace complex;
+
+    // a dielectric, total reflection, metals in the visible, and coatings in the soft and hard x-ray range.
+    const auto iors = std::vector<Complex>{
+        {1.5, 0.0}, {0.7, 0.0}, {0.05, 5.0}, {0.97, 0.01}, {0.99999, 1e-6}, {0.9999998, 1e-9},
+    };
+    const auto iorI = Complex(1.0, 0.0);
+    const auto normalVec = glm::dvec3(0, 1, 0);
+    const auto incidentElectricField = ElectricField({0.3, 0.1}, {1, 0}, {0.5, -0.7});
+
+    for (const auto iorT : iors) {
+        for (double grazing = 1e-5; grazing < PI / 2; grazing *= 1.1) {
+            const auto incidentVec = glm::dvec3(0, -std::sin(grazing), std::cos(grazing));
+            const auto reflectVec = glm::reflect(incidentVec, normalVec);
+            const auto cosIncidence = glm::dot(incidentVec, -normalVec);
+            const auto incidentAngle = Complex(angleBetweenUnitVectors(incidentVec, -normalVec), 0);
+            const auto refractAngle = calcRefractAngle(incidentAngle, iorI, iorT);
+
+            // close to the critical angle, cos(asin(x)) loses up to half of the digits, which the closed form keeps.
+            const auto reflectAmplitude = calcReflectAmplitude(incidentAngle, refractAngle, iorI, iorT);
+            const auto fastReflectAmplitude = fast::calcReflectAmplitude(cosIncidence, iorI, iorT);
+            CHECK_EQ(fastReflectAmplitude.s, reflectAmplitude.s, 1e-7);
+            CHECK_EQ(fastReflectAmplitude.p, reflectAmplitude.p, 1e-7);
+
+            const auto refractAmplitude = calcRefractAmplitude(incidentAngle, refractAngle, iorI, iorT);
+            const auto fastRefractAmplitude = fast::calcRefractAmplitude(cosIncidence, iorI, iorT);
+            CHECK_EQ(fastRefractAmplitude.s, refractAmplitude.s, 1e-7);
+            CHECK_EQ(fastRefractAmplitude.p, refractAmplitude.p, 1e-7);
+
+            const auto matrix = calcPolaririzationMatrix(incidentVec, reflectVec, normalVec, reflectAmplitude);
+            CHECK_EQ(fast::interceptReflect(incidentElectricField, incidentVec, reflectVec, normalVec, reflectAmplitude),
+                     matrix * incidentElectricField, 1e-12);
+        }
+    }
+
+    // normal incidence
+    const auto reflectAmplitude = fast::calcReflectAmplitude(1.0, iorI, Complex(1.5, 0));
+    CHECK_EQ(reflectAmplitude.s, Complex(-0.2, 0));
+    CHECK_EQ(fast::interceptReflect(incidentElectricField, -normalVec, normalVec, normalVec, reflectAmplitude),
+             calcReflectPolarizationMatrixAtNormalIncidence(reflectAmplitude) * incidentElectricField);
+}
+
+TEST_F(TestSuite, testRefracRotation) {
+    // skipping the rotation for planes refracts exactly as the rotation computed from the collision normal.
+    auto planeGrating = makeElementRecord(loadBeamline("PlaneGratingDeviationDefault").m_DesignElements[0].compile());
+    CHECK(planeGrating.m_hasConstantNormal);
+    auto sphereGrating = makeElementRecord(loadBeamline("SphereGrating").m_DesignElements[0].compile());
+    CHECK(!sphereGrating.m_hasConstantNormal);
+
+    Ray r;
+    r.m_direction = glm::normalize(glm::dvec3(0.01, -0.3, 1.0));
+    for (auto normal : {glm::dvec3(0, 1, 0), glm::dvec3(0, -1, 0)}) {
+        auto a = refrac2D(r, normal, 0.01, 0.002, inv);
+        auto b = refrac2DPlane(r, 0.01, 0.002, inv);
+        CHECK_EQ(a.m_direction, b.m_direction, 0.0);
+    }
+
+    // for curved elements, both overloads agree.
+    for (auto normal : {glm::normalize(glm::dvec3(0.1, 1, -0.05)), glm::normalize(glm::dvec3(-0.02, 0.9, 0.3))}) {
+        auto a = refrac2D(r, normal, 0.01, 0.002, inv);
+        auto b = refrac2D(r, refracRotation(normal), 0.01, 0.002, inv);
+        CHECK_EQ(a.m_direction, b.m_direction, 0.0);
+    }
+}
+
+TEST_F(TestSuite, testFindCollisionPacket) {
+    // the plane mirror, the image plane and the sphere are collided in SIMD lanes, the plane with slope error and the toroid are not.
+    auto beamline = loadBeamline("PlaneMirrorMis");
+    std::vector<ElementRecord> records;
+    for (const auto& e : beamline.m_DesignElements) records.push_back(makeElementRecord(e.compile()));
+    auto sloped = beamline.m_DesignElements[0].compile();
+    sloped.m_slopeError.m_sag = 0.5;
+    records.push_back(makeElementRecord(sloped));
+    records.push_back(makeElementRecord(loadBeamline("SphereMirrorDefault").m_DesignElements[0].compile()));
+    records.push_back(makeElementRecord(loadBeamline("toroid").m_DesignElements[0].compile()));
+    CHECK(isPacketElement(records[0]) && isPacketElement(records[1]) && isPacketElement(records[3]));
+    CHECK(!isPacketElement(records[2]) && !isPacketElement(records[4]));
+
+    const auto pushConstants = inv.pushConstants;
+    inv.elementRecords = records;
+
+    // every lane finds the same collision and draws the same random numbers as findCollision.
+    auto checkPacket = [&](const Ray* rays, const bool* active) {
+        LaneState lanes[RAY_PACKET_SIZE];
+        Collision cols[RAY_PACKET_SIZE];
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            storeLane(inv, lanes[i]);
+            lanes[i].ctr = 7 + i;
+        }
+        InvState packetInv = inv;
+        findCollisionPacket(rays, active, packetInv, lanes, cols);
+
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            if (!active[i]) continue;
+            inv.ctr = 7 + i;
+            auto expected = findCollision(rays[i], inv);
+            CHECK_EQ(lanes[i].ctr, inv.ctr);
+            CHECK_EQ(cols[i].found, expected.found);
+            if (expected.found) {
+                CHECK_EQ(cols[i].elementIndex, expected.elementIndex);
+                CHECK_EQ(cols[i].hitpoint, expected.hitpoint, 1e-12);
+                CHECK_EQ(cols[i].normal, expected.normal, 1e-12);
+            }
+        }
+    };
+
+    auto rays = beamline.getInputRays();
+    CHECK(rays.size() >= static_cast<size_t>(2 * RAY_PACKET_SIZE));
+    bool allActive[RAY_PACKET_SIZE];
+    bool someActive[RAY_PACKET_SIZE];
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        allActive[i] = true;
+        someActive[i] = i % 3 != 1;
+    }
+
+    for (double sequential : {0.0, 1.0}) {
+        inv.pushConstants.sequential = sequential;
+        for (size_t first = 0; first + RAY_PACKET_SIZE <= rays.size(); first += RAY_PACKET_SIZE) {
+            checkPacket(rays.data() + first, allActive);
+            checkPacket(rays.data() + first, someActive);
+        }
+
+        // rays which continue at different elements.
+        std::vector<Ray> diverged(rays.begin(), rays.begin() + RAY_PACKET_SIZE);
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) diverged[i].m_lastElement = i % 5 - 1;
+        checkPacket(diverged.data(), allActive);
+    }
+
+    inv.pushConstants = pushConstants;
+    inv.elementRecords = {};
+}
@@ -1,5 +1,9 @@
+#include <chrono>
 #include <fstream>
 
+#include "Beamline/SourceAcceptance.h"
+#include "Beamline/SourceCache.h"
+#include "Beamline/SourceSampling.h"
 #include "setupTests.h"
 
 void checkEnergyDistribution(const std::vector<Ray>& rays, double photonEnergy, double energySpread) {
@@ -210,3 +214,153 @@ TEST_F(TestSuite, testLightsourceGetters) {
         CHECK_EQ(widthResult, values.sourceWidth);
     }
 }
+
+TEST_F(TestSuite, testSourceCache) {
+    auto beamline = loadBeamline("PointSourceHardEdge");
+    auto dir = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/sourceCache");
+    std::filesystem::remove_all(dir);
+
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto uncached = beamline.getInputRays();
+    auto uncachedNext = RAYX::randomDouble();
+
+    beamline.m_sourceCacheDirectory = dir;
+    for (int i = 0; i < 2; i++) {  // the first iteration fills the cache, the second one reads from it.
+        RAYX::fixSeed(RAYX::FIXED_SEED);
+        auto cached = beamline.getInputRays();
+        CHECK_EQ(RAYX::randomDouble(), uncachedNext);
+        CHECK_EQ(cached.size(), uncached.size());
+        for (size_t j = 0; j < cached.size(); j++) {
+            CHECK_EQ(cached[j], uncached[j]);
+        }
+    }
+    CHECK(!std::filesystem::is_empty(dir));
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(TestSuite, testSourceCacheKeyHashesDatFile) {
+    auto beamline = loadBeamline("PointSourceHardEdge");
+    auto dat = canonicalizeRepositoryPath("Intern/rayx-core/tests/output/sourceCacheKey.DAT");
+    std::filesystem::create_directories(dat.parent_path());
+
+    DesignSource src = beamline.m_DesignSources[0];
+    src.setEnergyDistributionType(EnergyDistributionType::File);
+    src.setEnergyDistributionFile(dat.string());
+
+    auto keyFor = [&](const std::string& contents) {
+        std::ofstream(dat) << contents;
+        RAYX::fixSeed(RAYX::FIXED_SEED);
+        return RAYX::SourceCache::key(src, 0);
+    };
+
+    // the path stays the same, only the contents change.
+    const auto a = keyFor("100 1\n");
+    CHECK(keyFor("100 1\n") == a);
+    CHECK(keyFor("200 1\n") != a);
+    std::filesystem::remove(dat);
+}
+
+TEST_F(TestSuite, testMultipleSourcesInputRays) {
+    auto beamline = loadBeamline("twoSourcesTest");
+    const auto n0 = static_cast<size_t>(beamline.m_DesignSources[0].getNumberOfRays());
+    const auto n1 = static_cast<size_t>(beamline.m_DesignSources[1].getNumberOfRays());
+
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto a = beamline.getInputRays();
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    auto b = beamline.getInputRays();
+
+    // the sources are generated concurrently, but each into its own slice and from its own RNG.
+    CHECK_EQ(a.size(), n0 + n1);
+    for (size_t i = 0; i < a.size(); i++) {
+        CHECK_EQ(a[i].m_sourceID, i < n0 ? 0.0 : 1.0);
+        CHECK_EQ(a[i], b[i]);
+    }
+}
+
+TEST_F(TestSuite, testImportanceSampledSource) {
+    auto beamline = loadBeamline("Ellipsoid");
+    auto first = beamline.m_DesignElements[0].compile();
+
+    auto plain = beamline.getInputRays();
+    beamline.m_importanceSampleSources = true;
+    auto weighted = beamline.getInputRays();
+
+    // all rays of a source carry the same weight, which is the probability of the sampled directions.
+    const double weight = intensity(weighted[0].m_field) / intensity(plain[0].m_field);
+    CHECK_IN(weight, 0.0, 1.0);
+    for (const auto& r : weighted) {
+        CHECK_EQ(intensity(r.m_field), intensity(weighted[0].m_field), 1e-12);
+    }
+
+    // restricting the directions must not lose rays which would have hit the first element.
+    auto plainAcceptance = RAYX::cullSourceRays(plain, first, 1);
+    auto weightedAcceptance = RAYX::cullSourceRays(weighted, first, 1);
+    CHECK(weightedAcceptance.acceptedFraction(0) >= plainAcceptance.acceptedFraction(0) - 0.05);
+}
+
+// the divergence window must contain all directions under which the first element is hit, hence the flux on the first element has to be the same
+// with and without importance sampling.
+TEST_F(TestSuite, testImportanceSamplingKeepsFlux) {
+    auto beamline = loadBeamline("Ellipsoid");
+    auto first = beamline.m_DesignElements[0].compile();
+    auto& source = beamline.m_DesignSources[0];
+    source.setNumberOfRays(20000);
+    // a misaligned source, whose rays don't start at its position.
+    source.setMisalignment({.m_translationXerror = 0.5, .m_translationYerror = -0.3, .m_rotationXerror = Rad(1e-3), .m_rotationYerror = Rad(-2e-3)});
+
+    auto plain = beamline.getInputRays();
+    beamline.m_importanceSampleSources = true;
+    auto weighted = beamline.getInputRays();
+    const double n = static_cast<double>(plain.size());
+    const double plainIntensity = intensity(plain[0].m_field);
+
+    const auto plainAcceptance = RAYX::cullSourceRays(plain, first, 1);
+    const auto weightedAcceptance = RAYX::cullSourceRays(weighted, first, 1);
+    const double plainFlux = plainAcceptance.m_acceptedIntensity[0] / (n * plainIntensity);
+    const double weightedFlux = weightedAcceptance.m_acceptedIntensity[0] / (n * plainIntensity);
+
+    // the weighted estimate has a smaller variance, hence 5 sigma of the plain estimate (at least 5 rays).
+    const double sigma = std::sqrt(plainFlux * (1.0 - plainFlux) / n);
+    CHECK(plainFlux > 0.0);
+    CHECK_EQ(weightedFlux, plainFlux, 5.0 * sigma + 5.0 / n);
+}
+
+
+// Compares drawing normal samples one by one with drawing the raw samples first and transforming them in chunks (see SourceSampling.h).
+// Not part of the regular test run, use --gtest_also_run_disabled_tests --gtest_filter=*benchSourceSampling
+TEST_F(TestSuite, DISABLED_benchSourceSampling) {
+    constexpr size_t n = 1 << 22;
+    auto time = [](auto&& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+
+    std::vector<double> single(n);
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    const double singleTime = time([&] {
+        for (auto& z : single) z = RAYX::randomNormal(0.0, 1.0);
+    });
+
+    std::vector<double> batched(n);
+    std::vector<double> u1(RAYX::SOURCE_SAMPLING_CHUNK_SIZE);
+    std::vector<double> u2(RAYX::SOURCE_SAMPLING_CHUNK_SIZE);
+    RAYX::fixSeed(RAYX::FIXED_SEED);
+    const double batchedTime = time([&] {
+        for (size_t i = 0; i < n; i += RAYX::SOURCE_SAMPLING_CHUNK_SIZE) {
+            const size_t count = std::min(RAYX::SOURCE_SAMPLING_CHUNK_SIZE, n - i);
+            for (size_t j = 0; j < count; j++) RAYX::randomNormalUniforms(u1[j], u2[j]);
+            RAYX::boxMuller(u1.data(), u2.data(), batched.data() + i, nullptr, count, 0.0, 1.0);
+        }
+    });
+
+    // with the scalar math of this build, the kernels yield the same samples.
+    for (size_t i = 0; i < n; i++) CHECK_EQ(batched[i], single[i], 0.0);
+    RAYX_LOG << "normal samples: single " << n / singleTime << "/s, batched " << n / batchedTime << "/s, speedup " << singleTime / batchedTime;
+
+    auto beamline = loadBeamline("PointSourceHardEdge");
+    const double sourceTime = time([&] { beamline.getInputRays(); });
+    RAYX_LOG << "PointSourceHardEdge: " << beamline.m_DesignSources[0].getNumberOfRays() / sourceTime << " rays/s";
+}
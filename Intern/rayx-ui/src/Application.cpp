@@ -1,6 +1,7 @@
 #include "Application.h"
 
 #include <chrono>
+#include <filesystem>
 #include <future>
 
 #include "CanonicalizePath.h"
@@ -20,6 +21,7 @@
 #include "UserInput.h"
 #include "Writer/CSVWriter.h"
 #include "Writer/H5Writer.h"
+#include "Writer/RayFile.h"
 
 bool isSceneWindowHovered = false;  // TODO: remove this global variable (doing this will require a refactor of the way we use glfw)
 
@@ -209,12 +211,8 @@ void Application::run() {
                                 m_buildElementsNeeded = true;
                             }
                         } else {
-                            for (auto ray : m_rays) {
-                                size_t id = static_cast<size_t>(ray.back().m_lastElement);
-                                if (id > m_Beamline->m_DesignElements.size()) {
-                                    m_UIParams.showH5NotExistPopup = true;
-                                    break;
-                                }
+                            if (m_rays.maxLastElement() > m_Beamline->m_DesignElements.size()) {
+                                m_UIParams.showH5NotExistPopup = true;
                             }
                             if (m_UIParams.showH5NotExistPopup) {
                                 RAYX_VERB << "H5 file not compatible with RML file";
@@ -333,15 +331,32 @@ void Application::run() {
 
 void Application::loadRays(const std::filesystem::path& rmlPath, const size_t numElements) {
     RAYX_PROFILE_FUNCTION_STDOUT();
+    const std::string basePath = rmlPath.string().substr(0, rmlPath.string().size() - 4);
 #ifndef NO_H5
-    std::string rayFilePath = rmlPath.string().substr(0, rmlPath.string().size() - 4) + ".h5";
-    m_rays = raysFromH5(rayFilePath, FULL_FORMAT, std::make_unique<uint32_t>(m_UIParams.rayInfo.startEventID));
+    std::string rayFilePath = basePath + ".h5";
+#else
+    std::string rayFilePath = basePath + ".csv";
+#endif
 
+    // prefer the native output, which is mapped instead of parsed, unless it is older than the other output.
+    std::string nativeRayFilePath = basePath + ".rays";
+    const bool native = std::filesystem::exists(nativeRayFilePath) &&
+                        (!std::filesystem::exists(rayFilePath) ||
+                         std::filesystem::last_write_time(nativeRayFilePath) >= std::filesystem::last_write_time(rayFilePath));
+    if (native) {
+        // the rays are read in place: the element index yields the events of each element, and the ray cache copies only the sampled rays.
+        m_rays.assign(std::make_unique<RayFileReader>(nativeRayFilePath, FileAccess::Random));
+    } else {
+#ifndef NO_H5
+        // the rays are read chunk by chunk: to count their events, to sort them by element and to copy the sampled rays of the ray cache.
+        auto h5File = std::make_unique<H5RayReader>(rayFilePath, FULL_FORMAT);
+        m_UIParams.rayInfo.startEventID = static_cast<uint32_t>(h5File->startEventID());
+        m_rays.assign(std::move(h5File));
 #else
-    std::string rayFilePath = rmlPath.string().substr(0, rmlPath.string().size() - 4) + ".csv";
-    m_rays = loadCSV(rayFilePath);
+        m_rays.assign(loadCSV(rayFilePath));
 #endif
-    sortRaysByElement(m_rays, m_sortedRays, numElements);
+    }
+    m_rays.sortByElement(m_sortedRays, numElements);
 }
 
 void Application::loadBeamline(const std::filesystem::path& rmlPath) {
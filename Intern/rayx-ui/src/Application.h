@@ -74,7 +74,7 @@ class Application {
 
     std::filesystem::path m_RMLPath;                   ///< Path to the RML file
     std::unique_ptr<RAYX::Beamline> m_Beamline;        ///< Beamline
-    RAYX::BundleHistory m_rays;                        ///< All rays
+    LoadedRays m_rays;                                 ///< All rays
     std::vector<std::vector<RAYX::Ray>> m_sortedRays;  ///< Rays sorted by element
     bool m_buildElementsNeeded = true;
     bool m_buildTextureNeeded = true;
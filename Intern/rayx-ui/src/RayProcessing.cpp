@@ -7,6 +7,7 @@
 #include <cmath>  // for std::pow and std::log
 #include <numeric>
 #include <unordered_set>
+#include <utility>
 
 #include "Application.h"
 #include "Colors.h"
@@ -48,6 +49,146 @@ void displayFilterSlider(size_t& amountOfRays, size_t maxAmountOfRays, bool& dis
     }
 }
 
+void LoadedRays::assign(RAYX::BundleHistory rays) {
+    clear();
+    m_history = std::move(rays);
+}
+
+void LoadedRays::assign(std::unique_ptr<RayFileReader> rayFile) {
+    clear();
+    m_rayFile = std::move(rayFile);
+}
+
+#ifndef NO_H5
+void LoadedRays::assign(std::unique_ptr<H5RayReader> h5File) {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+    clear();
+    h5File->read({}, [&](const H5RayBatch& batch) {
+        for (size_t i = 0; i < batch.m_rays.size(); i++) {
+            m_h5RayIds.push_back(batch.m_rayIds[i]);
+            m_h5EventCounts.push_back(static_cast<uint32_t>(batch.m_rays[i].size()));
+            m_h5MaxLastElement = std::max(m_h5MaxLastElement, static_cast<size_t>(batch.m_rays[i].back().m_lastElement));
+        }
+    });
+    m_h5File = std::move(h5File);
+}
+#endif
+
+void LoadedRays::clear() {
+    m_history.clear();
+    m_rayFile.reset();
+#ifndef NO_H5
+    m_h5File.reset();
+    m_h5RayIds.clear();
+    m_h5EventCounts.clear();
+    m_h5MaxLastElement = 0;
+#endif
+}
+
+size_t LoadedRays::size() const {
+    if (m_rayFile) return m_rayFile->numberOfRays();
+#ifndef NO_H5
+    if (m_h5File) return m_h5RayIds.size();
+#endif
+    return m_history.size();
+}
+
+size_t LoadedRays::eventCount(size_t ray) const {
+    if (m_rayFile) return m_rayFile->rayEvents(ray).size();
+#ifndef NO_H5
+    if (m_h5File) return m_h5EventCounts[ray];
+#endif
+    return m_history[ray].size();
+}
+
+size_t LoadedRays::maxLastElement() const {
+#ifndef NO_H5
+    if (m_h5File) return m_h5MaxLastElement;
+#endif
+    size_t maxElement = 0;
+    for (size_t i = 0; i < size(); i++) {
+        const auto events = m_rayFile ? m_rayFile->rayEvents(i) : std::span<const RAYX::Ray>(m_history[i]);
+        if (!events.empty()) maxElement = std::max(maxElement, static_cast<size_t>(events.back().m_lastElement));
+    }
+    return maxElement;
+}
+
+RAYX::BundleHistory LoadedRays::collect(const std::vector<size_t>& rays) const {
+    RAYX_PROFILE_FUNCTION_STDOUT();
+    RAYX::BundleHistory collected(rays.size());
+#ifndef NO_H5
+    if (m_h5File) {
+        if (rays.empty()) return collected;
+        // the requested rays in order of the file, which are read in a single pass over the range of their ray-ids.
+        std::vector<size_t> order(rays.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rays[a] < rays[b]; });
+        const H5RayFilter filter{.m_firstRay = m_h5RayIds[rays[order.front()]], .m_endRay = m_h5RayIds[rays[order.back()]] + 1};
+
+        size_t next = 0;
+        m_h5File->read(filter, [&](const H5RayBatch& batch) {
+            for (size_t i = 0; i < batch.m_rays.size(); i++) {
+                while (next < order.size() && m_h5RayIds[rays[order[next]]] == batch.m_rayIds[i]) collected[order[next++]] = batch.m_rays[i];
+            }
+        });
+        return collected;
+    }
+#endif
+    for (size_t i = 0; i < rays.size(); i++) {
+        if (m_rayFile) {
+            const auto events = m_rayFile->rayEvents(rays[i]);
+            collected[i].assign(events.begin(), events.end());
+        } else {
+            collected[i] = m_history[rays[i]];
+        }
+    }
+    return collected;
+}
+
+void LoadedRays::sortByElement(std::vector<std::vector<RAYX::Ray>>& sortedRays, size_t numElements) const {
+#ifndef NO_H5
+    if (m_h5File) {
+        RAYX_PROFILE_FUNCTION_STDOUT();
+        sortedRays.clear();
+        sortedRays.resize(numElements);
+        m_h5File->read({}, [&](const H5RayBatch& batch) {
+            for (const auto& ray : batch.m_rays) {
+                for (const auto& event : ray) {
+                    if (event.m_lastElement >= numElements) continue;
+                    sortedRays[static_cast<size_t>(event.m_lastElement)].push_back(event);
+                }
+            }
+        });
+        return;
+    }
+#endif
+    if (!m_rayFile) {
+        sortRaysByElement(m_history, sortedRays, numElements);
+        return;
+    }
+
+    RAYX_PROFILE_FUNCTION_STDOUT();
+    sortedRays.clear();
+    sortedRays.resize(numElements);
+    if (!m_rayFile->hasElementIndex()) {
+        for (uint64_t i = 0; i < m_rayFile->numberOfRays(); i++) {
+            for (const auto& ray : m_rayFile->rayEvents(i)) {
+                if (ray.m_lastElement >= numElements) continue;
+                sortedRays[static_cast<size_t>(ray.m_lastElement)].push_back(ray);
+            }
+        }
+        return;
+    }
+
+    // the element index lists the events of every element in ascending order, i.e. in the order of the rays.
+    const auto events = m_rayFile->events();
+    for (uint32_t element = 0; element < std::min<size_t>(numElements, m_rayFile->numberOfElements()); element++) {
+        const auto indices = m_rayFile->elementEvents(element);
+        sortedRays[element].reserve(indices.size());
+        for (const uint64_t index : indices) sortedRays[element].push_back(events[index]);
+    }
+}
+
 size_t getMaxEvents(const RAYX::BundleHistory& bundleHist) {
     size_t maxEvents = 0;
     for (const auto& ray : bundleHist) {
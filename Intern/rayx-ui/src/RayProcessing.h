@@ -1,10 +1,53 @@
 #pragma once
 #include <functional>
+#include <memory>
+#include <span>
 #include <vector>
 
 #include "RenderObject.h"
+#include "Writer/H5RayReader.h"
+#include "Writer/RayFile.h"
 #define MAX_RAYS 1000
 
+/**
+ * @brief The rays loaded into the UI.
+ * The rays of a .rays file are read in place from the mapped file, and sorted by element with its element index. The rays of an .h5 file are
+ * read chunk by chunk whenever they are needed, only the number of events of every ray is kept. All other rays are held in a BundleHistory.
+ * Rays are numbered in the order of the file; for .h5 files, rays without events are skipped.
+ */
+class LoadedRays {
+  public:
+    void assign(RAYX::BundleHistory rays);
+    void assign(std::unique_ptr<RayFileReader> rayFile);
+#ifndef NO_H5
+    // reads the file once, to count the events of every ray.
+    void assign(std::unique_ptr<H5RayReader> h5File);
+#endif
+    void clear();
+
+    size_t size() const;
+    size_t eventCount(size_t ray) const;
+    // the largest element-id of the last events of the rays.
+    size_t maxLastElement() const;
+
+    // copies the events of the rays `rays`, in that order.
+    RAYX::BundleHistory collect(const std::vector<size_t>& rays) const;
+
+    // collects the events of every element in [0, numElements), in the order of the rays.
+    void sortByElement(std::vector<std::vector<RAYX::Ray>>& sortedRays, size_t numElements) const;
+
+  private:
+    RAYX::BundleHistory m_history;
+    std::unique_ptr<RayFileReader> m_rayFile;
+#ifndef NO_H5
+    std::unique_ptr<H5RayReader> m_h5File;
+    // for .h5 files: the ray-id, the number of events and the element of the last event of every ray.
+    std::vector<uint64_t> m_h5RayIds;
+    std::vector<uint32_t> m_h5EventCounts;
+    size_t m_h5MaxLastElement = 0;
+#endif
+};
+
 // Definition of the RayFilterFunction type
 using RayFilterFunction = std::function<std::vector<size_t>(const RAYX::BundleHistory&, size_t)>;
 
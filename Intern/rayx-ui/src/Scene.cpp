@@ -14,19 +14,18 @@
 
 Scene::Scene(Device& device) : m_Device(device) {}
 
-void Scene::buildRayCache(UIRayInfo& rayInfo, const RAYX::BundleHistory& rays) {
+void Scene::buildRayCache(UIRayInfo& rayInfo, const LoadedRays& rays) {
     RAYX_PROFILE_FUNCTION_STDOUT();
     rayInfo.maxAmountOfRays = (int)rays.size();
+    m_rayCache.clear();
+    std::vector<size_t> indices(rays.size());
+    std::iota(indices.begin(), indices.end(), 0);  // Filling indices with 0, 1, 2, ..., n-1
     if (rayInfo.renderAllRays) {
-        m_rayCache = rays;
+        m_rayCache = rays.collect(indices);
         return;
-    } else {
-        m_rayCache.clear();
     }
-    const size_t m = getMaxEvents(rays);
-
-    std::vector<size_t> indices(rays.size());
-    std::iota(indices.begin(), indices.end(), 0);  // Filling indices with 0, 1, 2, ..., n-1
+    size_t m = 0;
+    for (size_t i = 0; i < rays.size(); i++) m = std::max(m, rays.eventCount(i));
 
     // Randomly shuffling the indices
     std::random_device rd;
@@ -40,7 +39,7 @@ void Scene::buildRayCache(UIRayInfo& rayInfo, const RAYX::BundleHistory& rays) {
         size_t count = 0;
         for (size_t rayIdx : indices) {
             if (count >= MAX_RAYS) break;
-            if (rays[rayIdx].size() > eventIdx) {
+            if (rays.eventCount(rayIdx) > eventIdx) {
                 selectedIndices.insert(rayIdx);
                 count++;
             }
@@ -49,9 +48,7 @@ void Scene::buildRayCache(UIRayInfo& rayInfo, const RAYX::BundleHistory& rays) {
 
     // Now selectedIndices contains unique indices of rays
     // Creating rayCache object from selected indices
-    for (size_t idx : selectedIndices) {
-        m_rayCache.push_back(rays[idx]);
-    }
+    m_rayCache = rays.collect(std::vector<size_t>(selectedIndices.begin(), selectedIndices.end()));
 
     rayInfo.maxAmountOfRays = m_rayCache.size();
 }
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "Beamline/Beamline.h"
+#include "RayProcessing.h"
 #include "RenderObject.h"
 #include "Tracer/DeviceTracer.h"
 #include "UserInterface/Settings.h"
@@ -23,7 +24,7 @@ class Scene {
         std::vector<uint32_t> indices;
     };
 
-    void buildRayCache(UIRayInfo& rayInfo, const RAYX::BundleHistory& rays);
+    void buildRayCache(UIRayInfo& rayInfo, const LoadedRays& rays);
     void buildRaysRObject(const RAYX::Beamline& beamline, UIRayInfo& rayInfo, std::shared_ptr<DescriptorSetLayout> setLayout,
                           std::shared_ptr<DescriptorPool> descriptorPool);
 
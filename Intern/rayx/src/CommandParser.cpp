@@ -48,6 +48,27 @@ void CommandParser::analyzeCommands() const {
     if (m_args.m_isFixSeed && m_args.m_seed < -1) {
         RAYX_EXIT << "Unsupported seed <= 0";
     }
+
+    if (m_args.m_cullSource && !m_args.m_sequential) {
+        RAYX_WARN << "Source ray culling (-a) only applies to sequential tracing (-S), ignoring it.";
+    }
+
+    if (m_args.m_codec != "gzip" && m_args.m_codec != "zstd" && m_args.m_codec != "lz4") {
+        RAYX_EXIT << "Unsupported compression codec \"" << m_args.m_codec << "\", expected gzip, zstd or lz4";
+    }
+    const int maxCompression = m_args.m_codec == "zstd" ? 22 : 9;
+    if (m_args.m_compression < 0 || m_args.m_compression > maxCompression) {
+        RAYX_EXIT << "Unsupported compression level " << m_args.m_compression << ", expected 1-" << maxCompression
+                  << " (or 0 to disable compression)";
+    }
+
+    if (m_args.m_reducedPrecision && !m_args.m_columnar) {
+        RAYX_WARN << "Reduced precision (-r) only applies to the columnar .h5 output (-L), ignoring it.";
+    }
+
+    if (m_args.m_rayPackets && m_args.m_gpuFlag) {
+        RAYX_WARN << "Packet tracing (-P) only applies to tracing on the CPU (-x), ignoring it.";
+    }
 }
 
 CommandParser::~CommandParser() = default;
@@ -43,6 +43,19 @@ class CommandParser {
         int m_setThreads = 1;                          // -T (dipolesource)
         int m_maxEvents = -1;                          // -m (max events)
         int m_startEventID = 0;                        // -e (start event id)
+        std::string m_sourceCache = "";                // -C (source ray cache directory)
+        bool m_cullSource = false;                     // -a (reject source rays missing the first element)
+        bool m_importanceSampling = false;             // -I (importance sample source divergence)
+        bool m_fresnelCache = false;                   // -R (tabulate mirror refractive indices for narrow-band beams)
+        bool m_diffractionTables = false;              // -D (sample slit diffraction from precomputed tables)
+        bool m_rayPackets = false;                     // -P (trace packets of rays in SIMD lanes on the CPU)
+        bool m_sortRays = false;                       // -O (trace the rays of each batch in Morton order)
+        int m_compression = 0;                         // -z (compression level of the .h5 output)
+        std::string m_codec = "gzip";                  // -Z (compression codec of the .h5 output)
+        bool m_reducedPrecision = false;               // -r (store positions, directions and fields as float in the .h5 output)
+        bool m_columnar = false;                       // -L (columnar layout of the .h5 output)
+        bool m_compactCSV = false;                     // -k (variable-width cells in the .csv output)
+        bool m_raysFlag = false;                       // -n (native .rays output)
     } m_args;
 
     static inline void getVersion() {
@@ -92,5 +105,28 @@ class CommandParser {
           &(m_args.m_setThreads)}},  // TODO: understandable description
         {'m', {OptionType::INT, "maxEvents", "Maximum number of events per ray", &(m_args.m_maxEvents)}},
         {'e', {OptionType::INT, "startEventID", "Start event ID", &(m_args.m_startEventID)}},
+        {'C', {OptionType::STRING, "sourceCache", "Cache generated source rays in this directory", &(m_args.m_sourceCache)}},
+        {'a', {OptionType::BOOL, "cullSource", "Reject source rays missing the first element (only with -S)", &(m_args.m_cullSource)}},
+        {'I',
+         {OptionType::BOOL, "importanceSampling", "Sample source directions towards the first element only, using ray weights",
+          &(m_args.m_importanceSampling)}},
+        {'R',
+         {OptionType::BOOL, "fresnelCache", "Tabulate the refractive indices of the mirrors (only for monochromatic or narrow-band beams)",
+          &(m_args.m_fresnelCache)}},
+        {'D',
+         {OptionType::BOOL, "diffractionTables", "Sample slit diffraction from precomputed tables instead of by rejection sampling",
+          &(m_args.m_diffractionTables)}},
+        {'P', {OptionType::BOOL, "packets", "Trace packets of rays in SIMD lanes (only on the CPU)", &(m_args.m_rayPackets)}},
+        {'O', {OptionType::BOOL, "sortRays", "Trace similar rays together by sorting each batch in Morton order", &(m_args.m_sortRays)}},
+        {'z', {OptionType::INT, "compress", "Compress the .h5 output with this level (gzip: 1-9, zstd: 1-22)", &(m_args.m_compression)}},
+        {'Z', {OptionType::STRING, "codec", "Compression codec of the .h5 output: gzip, zstd or lz4 (see -z)", &(m_args.m_codec)}},
+        {'r',
+         {OptionType::BOOL, "reducedPrecision", "Store positions, directions and fields as float in the columnar .h5 output (only with -L)",
+          &(m_args.m_reducedPrecision)}},
+        {'L', {OptionType::BOOL, "columnar", "Write the .h5 output column by column, one dataset per format component", &(m_args.m_columnar)}},
+        {'k',
+         {OptionType::BOOL, "compactCsv", "Write the shortest exact numbers into the .csv output, instead of fixed-width cells",
+          &(m_args.m_compactCSV)}},
+        {'n', {OptionType::BOOL, "rays", "Output stored as native .rays file, which can be memory-mapped (ignores --format)", &(m_args.m_raysFlag)}},
     };
 };
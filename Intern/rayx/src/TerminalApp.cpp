@@ -1,6 +1,7 @@
 #include "TerminalApp.h"
 
 #include <filesystem>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
 
@@ -55,6 +56,15 @@ void TerminalApp::tracePath(const std::filesystem::path& path) {
         std::cout << "Tracing File: " << path << std::endl;
         // Load RML file
         m_Beamline = std::make_unique<RAYX::Beamline>(RAYX::importBeamline(path));
+        if (!m_CommandParser->m_args.m_sourceCache.empty()) {
+            m_Beamline->m_sourceCacheDirectory = m_CommandParser->m_args.m_sourceCache;
+        }
+        m_Beamline->m_cullSourceRays = m_CommandParser->m_args.m_cullSource;
+        m_Beamline->m_importanceSampleSources = m_CommandParser->m_args.m_importanceSampling;
+        m_Beamline->m_cacheFresnelCoefficients = m_CommandParser->m_args.m_fresnelCache;
+        m_Beamline->m_tabulateDiffraction = m_CommandParser->m_args.m_diffractionTables;
+        m_Beamline->m_traceRayPackets = m_CommandParser->m_args.m_rayPackets;
+        m_Beamline->m_sortRays = m_CommandParser->m_args.m_sortRays;
 
         // calculate max batch size
         uint64_t max_batch_size = RAYX::DEFAULT_BATCH_SIZE;
@@ -71,13 +81,11 @@ void TerminalApp::tracePath(const std::filesystem::path& path) {
             RAYX_LOG << "startEventID must be < maxEvents. Setting to maxEvents-1.";
             m_CommandParser->m_args.m_startEventID = maxEvents - 1;
         }
-        auto rays = m_Tracer->trace(*m_Beamline, seq, max_batch_size, m_CommandParser->m_args.m_setThreads, maxEvents,
-                                    m_CommandParser->m_args.m_startEventID);
 
-        // check max EventID
+        // check max EventID, batch by batch
         uint32_t maxEventID = 0;
         bool notEnoughEvents = false;
-        {
+        auto checkEvents = [&](const RAYX::BundleHistory& rays) {
             RAYX_PROFILE_SCOPE_STDOUT("maxEventID");
             for (auto& ray : rays) {
                 if (ray.size() > (maxEventID)) {
@@ -90,7 +98,25 @@ void TerminalApp::tracePath(const std::filesystem::path& path) {
                     }
                 }
             }
-        }
+        };
+
+        // Trace and export Rays to external data.
+        // The batches are checked and written on a separate thread, while the tracer continues with the next batches.
+        auto file = exportRays(path.string(), [&](const RAYX::BatchCallback& onBatch) {
+            AsyncBatchWriter writer([&](RAYX::BundleHistory batch) {
+                checkEvents(batch);
+                onBatch(std::move(batch));
+            });
+            m_Tracer->trace(*m_Beamline, seq, max_batch_size, m_CommandParser->m_args.m_setThreads, maxEvents, m_CommandParser->m_args.m_startEventID,
+                            [&](RAYX::BundleHistory batch) { writer.push(std::move(batch)); });
+            // errors of the writer thread are rethrown here.
+            try {
+                writer.finish();
+            } catch (const std::exception& err) {
+                RAYX_EXIT << "could not export the rays: " << err.what();
+            }
+        });
+
         if (notEnoughEvents) {
             RAYX_LOG << "Not enough events (" << maxEvents << ")! Consider increasing maxEvents.";
         }
@@ -101,9 +127,6 @@ void TerminalApp::tracePath(const std::filesystem::path& path) {
                      << maxEventID << " to increase performance.";
         }
 
-        // Export Rays to external data.
-        auto file = exportRays(rays, path.string(), m_CommandParser->m_args.m_startEventID);
-
         // Plot
         if (m_CommandParser->m_args.m_plotFlag) {
             if (!file.ends_with(".h5")) {
@@ -184,9 +207,10 @@ void TerminalApp::run() {
     tracePath(m_CommandParser->m_args.m_providedFile);
 }
 
-std::string TerminalApp::exportRays(const RAYX::BundleHistory& hist, std::string path, int startEventID) {
+std::string TerminalApp::exportRays(std::string path, const std::function<void(const RAYX::BatchCallback&)>& trace) {
     RAYX_PROFILE_FUNCTION_STDOUT();
     bool csv = m_CommandParser->m_args.m_csvFlag;
+    int startEventID = m_CommandParser->m_args.m_startEventID;
 
     // strip .rml
     if (path.ends_with(".rml")) {
@@ -199,35 +223,47 @@ std::string TerminalApp::exportRays(const RAYX::BundleHistory& hist, std::string
 
     if (csv) {
         path += ".csv";
-        writeCSV(hist, path, fmt, startEventID);
+        // the batches arrive in ray order, hence they are formatted and appended one by one.
+        CSVStreamWriter writer(path, fmt, startEventID, m_CommandParser->m_args.m_compactCSV ? CSVStyle::Compact : CSVStyle::FixedWidth);
+        trace([&](const RAYX::BundleHistory& batch) { writer.append(batch); });
+        try {
+            writer.finish();
+        } catch (const std::exception& err) {
+            RAYX_EXIT << "could not export the rays: " << err.what();
+        }
+    } else if (m_CommandParser->m_args.m_raysFlag) {
+        path += ".rays";
+        // the .rays output stores the whole rays, and indexes their events by element.
+        RayFileWriter writer(path, startEventID, static_cast<uint32_t>(m_Beamline->m_DesignElements.size()));
+        trace([&](const RAYX::BundleHistory& batch) { writer.append(batch); });
+        writer.finish();
     } else {
 #ifdef NO_H5
         RAYX_EXIT << "writeH5 called during NO_H5 (HDF5 disabled during build))";
 #else
         path += ".h5";
-        writeH5(hist, path, fmt, getBeamlineOpticalElementsNames(), startEventID);
+        // the .h5 output is written batch by batch while tracing.
+        const auto layout = m_CommandParser->m_args.m_columnar ? H5Layout::Columns : H5Layout::Rows;
+        const auto& args = m_CommandParser->m_args;
+        const H5Compression compression{
+            .m_codec = args.m_codec == "zstd" ? H5Codec::Zstd : (args.m_codec == "lz4" ? H5Codec::LZ4 : H5Codec::Deflate),
+            .m_level = args.m_compression,
+            .m_reducedPrecision = args.m_reducedPrecision,
+        };
+        H5StreamWriter writer(path, fmt, startEventID, layout, compression);
+        trace([&](const RAYX::BundleHistory& batch) { writer.append(batch); });
+        writer.writeBeamline(*m_Beamline);
+        if (const auto& acceptance = m_Tracer->sourceAcceptance()) writer.writeSourceAcceptance(*acceptance);
+        try {
+            writer.finish();
+        } catch (const std::exception& err) {
+            RAYX_EXIT << "could not export the rays: " << err.what();
+        }
 #endif
     }
     return path;
 }
 
-/**
- * @brief Get all beamline optical elemet names
- *
- * @return std::vector<std::string> list of names
- */
-std::vector<std::string> TerminalApp::getBeamlineOpticalElementsNames() {
-    std::vector<std::string> names;
-    names.reserve(m_Beamline->m_DesignElements.size());
-
-    for (const auto& designElement : m_Beamline->m_DesignElements) {
-        names.push_back("name!");
-        // TODO find the actual names!
-    }
-
-    return names;
-}
-
 /**
  * @brief Get all beamline light sources names
  *
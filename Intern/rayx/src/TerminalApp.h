@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <filesystem>
+#include <functional>
 
 #include "CommandParser.h"
 #include "RAY-Core.h"
@@ -29,9 +30,9 @@ class TerminalApp {
     /// if `path` is a directory, it will call `tracePath(child)` for all
     /// children of that directory.
     void tracePath(const std::filesystem::path& path);
+    // calls `trace`, which passes each traced batch to the given callback, and exports the rays.
     // returns the output filename (either .csv or .h5)
-    std::string exportRays(const RAYX::BundleHistory&, std::string, int startEventID);
-    std::vector<std::string> getBeamlineOpticalElementsNames();
+    std::string exportRays(std::string, const std::function<void(const RAYX::BatchCallback&)>& trace);
     std::vector<std::string> getBeamlineLightSourcesNames();
 
     std::string providedFile;
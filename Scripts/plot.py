@@ -10,29 +10,62 @@ import sys
 
 W_JUST_HIT_ELEM = 1
 
+# the columns of the "rays" dataset, see FULL_FORMAT in Writer.h.
+FULL_FORMAT = ['Ray-ID', 'Event-ID', 'X-position', 'Y-position', 'Z-position', 'Event-type', 'X-direction', 'Y-direction', 'Z-direction', 'Energy',
+               'ElectricField-x-real', 'ElectricField-x-imag', 'ElectricField-y-real', 'ElectricField-y-imag', 'ElectricField-z-real',
+               'ElectricField-z-imag', 'pathLength', 'order', 'lastElement', 'lightSourceIndex']
+
+NEEDED_COLUMNS = ['X-position', 'Y-position', 'Z-position', 'Event-type', 'ElectricField-x-real', 'ElectricField-x-imag', 'ElectricField-y-real',
+                  'ElectricField-y-imag', 'ElectricField-z-real', 'ElectricField-z-imag', 'lastElement']
+
+# the number of events which are read at once.
+CHUNK_EVENTS = 1 << 20
+
+def selectEvents(df):
+    """
+    Keep the events which hit an element, with their positions and intensities
+    """
+    df = df[df["Event-type"] == W_JUST_HIT_ELEM]
+    # the intensity of a ray, which also carries its statistical weight (e.g. from importance sampling of the source).
+    intensity = sum(df["ElectricField-" + c] ** 2 for c in ["x-real", "x-imag", "y-real", "y-imag", "z-real", "z-imag"])
+    return df[["X-position", "Y-position", "Z-position", "lastElement"]].assign(intensity=intensity)
+
 def importOutput(filename: str):
     """
     Import output h5 format and clean data
     """
     # file will be closed when we exit from WITH scope
     with h5py.File(filename, 'r') as h5f:
-        keys = []
-        for x in h5f.keys():
-            if x == "rays": continue
-            keys.append(int(x))
-        keys = sorted(keys)
-
         names = []
-        for x in keys:
-            x = "".join([chr(y) for y in h5f[str(x)]])
-            names.append(x)
-
-        dataset = h5f["rays"]
-        df = pd.DataFrame(dataset, columns=['Ray-ID', 'Event-ID', 'X-position', 'Y-position', 'Z-position', 'Event-type', 'X-direction', 'Y-direction', 'Z-direction', 'Energy',
-                                             'Stokes0', 'Stokes1', 'Stokes2', 'Stokes3', 'pathLength', 'order',
-                                             'lastElement', 'lightSourceIndex'])
-    df = df[df["Event-type"] == W_JUST_HIT_ELEM]
-    df = df[["X-position", "Y-position", "Z-position", "lastElement"]]
+        if "element_names" in h5f:
+            for x in h5f["element_names"][:]:
+                names.append(x.decode() if isinstance(x, bytes) else x)
+        else:
+            # older files store every name as a dataset of chars: "0", "1", ...
+            keys = []
+            for x in h5f.keys():
+                if not x.isdigit(): continue
+                keys.append(int(x))
+            keys = sorted(keys)
+
+            for x in keys:
+                x = "".join([chr(y) for y in h5f[str(x)]])
+                names.append(x)
+
+        # the file is read chunk by chunk, and only the events which are plotted are kept, so that files larger than the memory can be plotted.
+        chunks = []
+        if "columns" in h5f:
+            # columnar layout: only the needed components are read.
+            group = h5f["columns"]
+            n = group["Event-type"].shape[0]
+            for i in range(0, n, CHUNK_EVENTS):
+                chunks.append(selectEvents(pd.DataFrame({c: group[c][i:i + CHUNK_EVENTS] for c in NEEDED_COLUMNS})))
+        else:
+            dataset = h5f["rays"]
+            indices = [FULL_FORMAT.index(c) for c in NEEDED_COLUMNS]
+            for i in range(0, dataset.shape[0], CHUNK_EVENTS):
+                chunks.append(selectEvents(pd.DataFrame(dataset[i:i + CHUNK_EVENTS][:, indices], columns=NEEDED_COLUMNS)))
+    df = pd.concat(chunks) if chunks else selectEvents(pd.DataFrame(columns=NEEDED_COLUMNS))
     return df, names
 
 BAR = None
@@ -55,7 +88,7 @@ def plot(filename: str):
         # this `relevance` tests which axis is more important.
         relevance = lambda v: v.max() - v.min()
         Y = relevance(d["Y-position"]) > relevance(d["Z-position"])
-        h = ax.hist2d(d["X-position"], d["Y-position"] if Y else d["Z-position"], bins=200)
+        h = ax.hist2d(d["X-position"], d["Y-position"] if Y else d["Z-position"], bins=200, weights=d["intensity"])
         if BAR:
             # this overwrites the old colorbar axes, instead of taking new space away from `ax`
             BAR = plt.colorbar(h[3], cax=BAR.ax)